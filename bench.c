@@ -198,10 +198,16 @@ static double bench_fftw_2d_c2r(unsigned Nx, unsigned Ny, unsigned iterations, u
     return end_time - start_time;
 }
 
+// With MUFFT_FLAG_HUGE_PAGES, the buffers are backed by huge pages as well as the plan.
+static void *bench_alloc(size_t size, unsigned flags)
+{
+    return (flags & MUFFT_FLAG_HUGE_PAGES) != 0 ? mufft_alloc_huge(size) : mufft_alloc(size);
+}
+
 static double bench_fft_1d(unsigned N, unsigned iterations, unsigned flags)
 {
-    cfloat *input = mufft_alloc(N * sizeof(cfloat));
-    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    cfloat *input = bench_alloc(N * sizeof(cfloat), flags);
+    cfloat *output = bench_alloc(N * sizeof(cfloat), flags);
 
     srand(0);
     for (unsigned i = 0; i < N; i++)
@@ -379,8 +385,8 @@ static double bench_fft_1d_real_half(unsigned N, unsigned iterations, unsigned f
 
 static double bench_fft_2d(unsigned Nx, unsigned Ny, unsigned iterations, unsigned flags)
 {
-    cfloat *input = mufft_alloc(Nx * Ny * sizeof(cfloat));
-    cfloat *output = mufft_alloc(Nx * Ny * sizeof(cfloat));
+    cfloat *input = bench_alloc((size_t)Nx * Ny * sizeof(cfloat), flags);
+    cfloat *output = bench_alloc((size_t)Nx * Ny * sizeof(cfloat), flags);
 
     srand(0);
     for (unsigned i = 0; i < Nx * Ny; i++)
@@ -463,6 +469,47 @@ static double bench_fft_2d_c2r(unsigned Nx, unsigned Ny, unsigned iterations, un
     return end_time - start_time;
 }
 
+static double bench_fft_plan_1d(unsigned N, unsigned iterations, unsigned flags)
+{
+    double start_time = mufft_get_time();
+    for (unsigned i = 0; i < iterations; i++)
+    {
+        mufft_plan_1d *muplan = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, flags);
+        mufft_free_plan_1d(muplan);
+    }
+    double end_time = mufft_get_time();
+
+    return end_time - start_time;
+}
+
+static double bench_fft_plan_1d_real(unsigned N, unsigned iterations, unsigned flags)
+{
+    double start_time = mufft_get_time();
+    for (unsigned i = 0; i < iterations; i++)
+    {
+        mufft_plan_1d *muplan_r2c = mufft_create_plan_1d_r2c(N, flags);
+        mufft_plan_1d *muplan_c2r = mufft_create_plan_1d_c2r(N, flags);
+        mufft_free_plan_1d(muplan_r2c);
+        mufft_free_plan_1d(muplan_c2r);
+    }
+    double end_time = mufft_get_time();
+
+    return end_time - start_time;
+}
+
+static double bench_fft_plan_2d(unsigned Nx, unsigned Ny, unsigned iterations, unsigned flags)
+{
+    double start_time = mufft_get_time();
+    for (unsigned i = 0; i < iterations; i++)
+    {
+        mufft_plan_2d *muplan = mufft_create_plan_2d_c2c(Nx, Ny, MUFFT_FORWARD, flags);
+        mufft_free_plan_2d(muplan);
+    }
+    double end_time = mufft_get_time();
+
+    return end_time - start_time;
+}
+
 static void run_benchmark_1d(unsigned N, unsigned iterations)
 {
     double flops = 5.0 * N * log2(N); // Estimation
@@ -520,6 +567,26 @@ static void run_benchmark_1d_real(unsigned N, unsigned iterations)
     fflush(stdout);
 }
 
+// Plans are freed before the next one is created, so every iteration builds its twiddle factors from scratch.
+static void run_benchmark_plan_1d(unsigned N, unsigned iterations)
+{
+    double mufft_time = bench_fft_plan_1d(N, iterations, 0);
+    double mufft_real_time = bench_fft_plan_1d_real(N, iterations, 0);
+    printf("muFFT C2C plan:         %06u %12.3f us creation\n",
+            N, 1000000.0 * mufft_time / iterations);
+    printf("muFFT R2C-C2R plan:     %06u %12.3f us creation\n",
+            N, 1000000.0 * mufft_real_time / iterations);
+    fflush(stdout);
+}
+
+static void run_benchmark_plan_2d(unsigned Nx, unsigned Ny, unsigned iterations)
+{
+    double mufft_time = bench_fft_plan_2d(Nx, Ny, iterations, 0);
+    printf("muFFT plan:             %04u by %04u, %12.3f us creation\n",
+            Nx, Ny, 1000000.0 * mufft_time / iterations);
+    fflush(stdout);
+}
+
 static void run_benchmark_2d(unsigned Nx, unsigned Ny, unsigned iterations)
 {
     double flops = 5.0 * Ny * Nx * log2(Nx) + 5.0 * Nx * Ny * log2(Ny); // Estimation
@@ -583,15 +650,109 @@ static void run_benchmark_2d_c2r(unsigned Nx, unsigned Ny, unsigned iterations)
     fflush(stdout);
 }
 
+// Compares regular pages with huge pages, see MUFFT_FLAG_HUGE_PAGES.
+// The benefit only shows up for transforms well beyond the reach of the TLB, e.g. 2^22 samples.
+static void run_benchmark_huge_pages_1d(unsigned N, unsigned iterations)
+{
+    double flops = 5.0 * N * log2(N) * iterations; // Estimation
+    double mufft_time = bench_fft_1d(N, iterations, 0);
+    double mufft_huge_time = bench_fft_1d(N, iterations, MUFFT_FLAG_HUGE_PAGES);
+
+    printf("muFFT C2C:              %06u %12.3f Mflops %12.3f us iteration\n",
+            N, flops / (1000000.0 * mufft_time), 1000000.0 * mufft_time / iterations);
+    printf("muFFT C2C huge pages:   %06u %12.3f Mflops %12.3f us iteration\n",
+            N, flops / (1000000.0 * mufft_huge_time), 1000000.0 * mufft_huge_time / iterations);
+    fflush(stdout);
+}
+
+static void run_benchmark_huge_pages_2d(unsigned Nx, unsigned Ny, unsigned iterations)
+{
+    double flops = (5.0 * Ny * Nx * log2(Nx) + 5.0 * Nx * Ny * log2(Ny)) * iterations; // Estimation
+    double mufft_time = bench_fft_2d(Nx, Ny, iterations, 0);
+    double mufft_huge_time = bench_fft_2d(Nx, Ny, iterations, MUFFT_FLAG_HUGE_PAGES);
+
+    printf("muFFT:                  %04u by %04u, %12.3f Mflops %12.3f us iteration\n",
+            Nx, Ny, flops / (1000000.0 * mufft_time), 1000000.0 * mufft_time / iterations);
+    printf("muFFT huge pages:       %04u by %04u, %12.3f Mflops %12.3f us iteration\n",
+            Nx, Ny, flops / (1000000.0 * mufft_huge_time), 1000000.0 * mufft_huge_time / iterations);
+    fflush(stdout);
+}
+
+// Moves the span of rows from which vertical steps prefetch their input, see MUFFT_PREFETCH_BYTES.
+// Plans read it when they are created.
+static void set_prefetch_bytes(const char *bytes)
+{
+#ifdef _WIN32
+    _putenv_s("MUFFT_PREFETCH_BYTES", bytes);
+#else
+    setenv("MUFFT_PREFETCH_BYTES", bytes, 1);
+#endif
+}
+
+// Compares plain vertical steps with ones which prefetch their input explicitly.
+// The benefit only shows up once the columns a vertical step reads span far more than the L2 cache, e.g. 2048 by 2048.
+static void run_benchmark_prefetch_2d(unsigned Nx, unsigned Ny, unsigned iterations)
+{
+    double flops = (5.0 * Ny * Nx * log2(Nx) + 5.0 * Nx * Ny * log2(Ny)) * iterations; // Estimation
+    set_prefetch_bytes("18446744073709551615");
+    double mufft_time = bench_fft_2d(Nx, Ny, iterations, 0);
+    set_prefetch_bytes("0");
+    double mufft_prefetch_time = bench_fft_2d(Nx, Ny, iterations, 0);
+
+    printf("muFFT:                  %04u by %04u, %12.3f Mflops %12.3f us iteration\n",
+            Nx, Ny, flops / (1000000.0 * mufft_time), 1000000.0 * mufft_time / iterations);
+    printf("muFFT prefetch:         %04u by %04u, %12.3f Mflops %12.3f us iteration\n",
+            Nx, Ny, flops / (1000000.0 * mufft_prefetch_time), 1000000.0 * mufft_prefetch_time / iterations);
+    fflush(stdout);
+}
+
+static void print_cpu_info(void)
+{
+    mufft_cpu_info info;
+    mufft_get_cpu_info(&info);
+    printf("CPU: %s%s%s, L1 %zu kB, L2 %zu kB, L3 %zu kB, %u B lines, %u logical / %u physical cores\n",
+            (info.flags & MUFFT_CPU_HAS_AVX) ? "AVX " : "",
+            (info.flags & MUFFT_CPU_HAS_SSE3) ? "SSE3 " : "",
+            (info.flags & MUFFT_CPU_HAS_SSE) ? "SSE" : "",
+            info.l1_cache_size / 1024, info.l2_cache_size / 1024, info.l3_cache_size / 1024,
+            info.cache_line_size, info.logical_cores, info.physical_cores);
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc >= 2 && strcmp(argv[1], "huge") == 0)
+    {
+        if (argc == 4)
+        {
+            run_benchmark_huge_pages_1d(strtoul(argv[3], NULL, 0), strtoul(argv[2], NULL, 0));
+            return 0;
+        }
+        else if (argc == 5)
+        {
+            run_benchmark_huge_pages_2d(strtoul(argv[3], NULL, 0), strtoul(argv[4], NULL, 0),
+                    strtoul(argv[2], NULL, 0));
+            return 0;
+        }
+    }
+
+    if (argc == 5 && strcmp(argv[1], "prefetch") == 0)
+    {
+        run_benchmark_prefetch_2d(strtoul(argv[3], NULL, 0), strtoul(argv[4], NULL, 0),
+                strtoul(argv[2], NULL, 0));
+        return 0;
+    }
+
     if (argc == 2 || argc > 4)
     {
-        fprintf(stderr, "Usage: %s [iterations] [Nx] [Ny]\n",
-                argv[0]);
+        fprintf(stderr, "Usage: %s [iterations] [Nx] [Ny]\n"
+                "       %s huge iterations Nx [Ny]\n"
+                "       %s prefetch iterations Nx Ny\n",
+                argv[0], argv[0], argv[0]);
         return 1;
     }
 
+    print_cpu_info();
+
     if (argc == 1)
     {
         printf("\n1D benchmarks ...\n");
@@ -600,6 +761,7 @@ int main(int argc, char *argv[])
             run_benchmark_1d(N, 400000000ull / (N + 16));
             run_benchmark_1d_real(N, 400000000ull / (N + 16));
             run_benchmark_conv(N, 400000000ull / (N + 16));
+            run_benchmark_plan_1d(N, 4000000ull / (N + 16) + 1);
         }
 
         printf("\n2D benchmarks ...\n");
@@ -618,6 +780,7 @@ int main(int argc, char *argv[])
         run_benchmark_1d(Nx, iterations);
         run_benchmark_1d_real(Nx, iterations);
         run_benchmark_conv(Nx, iterations);
+        run_benchmark_plan_1d(Nx, iterations);
     }
     else if (argc == 4)
     {
@@ -627,6 +790,7 @@ int main(int argc, char *argv[])
         run_benchmark_2d(Nx, Ny, iterations);
         run_benchmark_2d_r2c(Nx, Ny, iterations);
         run_benchmark_2d_c2r(Nx, Ny, iterations);
+        run_benchmark_plan_2d(Nx, Ny, iterations);
     }
 
     fftwf_cleanup();
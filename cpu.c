@@ -17,7 +17,15 @@
  */
 
 #include "fft_internal.h"
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 #ifdef _MSC_VER
 #define WIN32_LEAN_AND_MEAN
@@ -28,7 +36,8 @@
 #ifdef MUFFT_HAVE_X86
 
 /// \brief Wrapper routine for x86 CPUID
-static void mufft_x86_cpuid(int func, int flags[4])
+/// Leaves with sub-leaves, like the cache parameters in leaf 4, take the sub-leaf in subfunc.
+static void mufft_x86_cpuid(int func, int subfunc, int flags[4])
 {
     // On 32-bit with PIC we are not allowed to clobber the ebx register.
 #ifdef __x86_64__
@@ -45,11 +54,13 @@ static void mufft_x86_cpuid(int func, int flags[4])
             "cpuid\n"
             "xchg %%" REG_b ", %%" REG_S "\n"
             : "=a"(flags[0]), "=S"(flags[1]), "=c"(flags[2]), "=d"(flags[3])
-            : "a"(func), "c"(0));
+            : "a"(func), "c"(subfunc));
 #elif defined(_MSC_VER)
-    __cpuid(flags, func);
+    __cpuidex(flags, func, subfunc);
 #else
 #warning "Unknown compiler. Cannot check CPUID with inline assembly."
+    (void)func;
+    (void)subfunc;
     memset(flags, 0, 4 * sizeof(int));
 #endif
 }
@@ -75,10 +86,11 @@ static uint64_t mufft_xgetbv_x86(uint32_t idx)
 #endif
 }
 
-unsigned mufft_get_cpu_flags(void)
+/// \brief Detects which SIMD instruction sets the CPU supports with CPUID.
+static unsigned mufft_detect_cpu_flags(void)
 {
     int flags[4];
-    mufft_x86_cpuid(0, flags);
+    mufft_x86_cpuid(0, 0, flags);
 
     unsigned max_flag = flags[0];
     if (max_flag < 1) // Does CPUID not support func = 1? (unlikely ...)
@@ -88,7 +100,7 @@ unsigned mufft_get_cpu_flags(void)
 
     unsigned cpu = 0;
 
-    mufft_x86_cpuid(1, flags);
+    mufft_x86_cpuid(1, 0, flags);
 
     if (flags[3] & (1 << 25))
     {
@@ -113,10 +125,316 @@ unsigned mufft_get_cpu_flags(void)
     return cpu;
 }
 
+/// \brief Records one cache described by a CPUID cache parameter leaf.
+/// Returns false once there are no more caches to enumerate.
+static bool mufft_x86_cache_leaf(mufft_cpu_info *info, int leaf, int index)
+{
+    int regs[4];
+    mufft_x86_cpuid(leaf, index, regs);
+
+    // Type 0 means no more caches, 1 is data, 2 is instruction and 3 is unified.
+    unsigned type = regs[0] & 0x1f;
+    if (type == 0)
+    {
+        return false;
+    }
+
+    unsigned level = (regs[0] >> 5) & 0x7;
+    unsigned line_size = (regs[1] & 0xfff) + 1;
+    unsigned partitions = ((regs[1] >> 12) & 0x3ff) + 1;
+    unsigned ways = ((unsigned)regs[1] >> 22) + 1;
+    unsigned sets = (unsigned)regs[2] + 1;
+    size_t size = (size_t)ways * partitions * line_size * sets;
+
+    if (type != 2)
+    {
+        if (level == 1)
+        {
+            info->l1_cache_size = size;
+            info->cache_line_size = line_size;
+        }
+        else if (level == 2)
+        {
+            info->l2_cache_size = size;
+        }
+        else if (level == 3)
+        {
+            info->l3_cache_size = size;
+        }
+    }
+    return true;
+}
+
+/// \brief Fills in cache sizes with the deterministic cache parameters in CPUID.
+/// Intel CPUs report them in leaf 4, AMD CPUs with topology extensions in leaf 0x8000001d.
+static void mufft_x86_get_caches(mufft_cpu_info *info)
+{
+    int regs[4];
+    mufft_x86_cpuid(0, 0, regs);
+    unsigned max_leaf = regs[0];
+
+    mufft_x86_cpuid(0x80000000, 0, regs);
+    unsigned max_extended_leaf = regs[0];
+
+    int leaf = 0;
+    if (max_leaf >= 4)
+    {
+        leaf = 4;
+    }
+
+    // AMD CPUs leave leaf 4 empty.
+    if (leaf != 0)
+    {
+        mufft_x86_cpuid(leaf, 0, regs);
+        if ((regs[0] & 0x1f) == 0)
+        {
+            leaf = 0;
+        }
+    }
+
+    if (leaf == 0 && max_extended_leaf >= 0x8000001d)
+    {
+        mufft_x86_cpuid(0x80000001, 0, regs);
+        if (regs[2] & (1 << 22))
+        {
+            leaf = 0x8000001d;
+        }
+    }
+
+    if (leaf == 0)
+    {
+        return;
+    }
+
+    // Bound the enumeration in case a hypervisor reports nonsense.
+    for (int index = 0; index < 16 && mufft_x86_cache_leaf(info, leaf, index); index++);
+}
+
 #else
-unsigned mufft_get_cpu_flags(void)
+static unsigned mufft_detect_cpu_flags(void)
 {
     return 0;
 }
 #endif
 
+#ifdef __linux__
+/// \brief Reads the first line of a small sysfs file into buffer.
+static bool mufft_read_sysfs(const char *path, char *buffer, size_t size)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    bool ret = fgets(buffer, size, file) != NULL;
+    fclose(file);
+    return ret;
+}
+
+/// \brief Fills in any cache sizes CPUID did not report from `/sys/devices/system/cpu/cpu0/cache/index*`.
+static void mufft_linux_get_caches(mufft_cpu_info *info)
+{
+    for (unsigned index = 0; index < 16; index++)
+    {
+        char path[128];
+        char buffer[64];
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/level", index);
+        if (!mufft_read_sysfs(path, buffer, sizeof(buffer)))
+        {
+            break;
+        }
+        unsigned level = strtoul(buffer, NULL, 10);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/type", index);
+        if (!mufft_read_sysfs(path, buffer, sizeof(buffer)) || strncmp(buffer, "Instruction", 11) == 0)
+        {
+            continue;
+        }
+
+        // Sizes are given like "48K".
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/size", index);
+        if (!mufft_read_sysfs(path, buffer, sizeof(buffer)))
+        {
+            continue;
+        }
+        char *suffix;
+        size_t size = strtoul(buffer, &suffix, 10);
+        if (*suffix == 'K')
+        {
+            size *= 1024;
+        }
+        else if (*suffix == 'M')
+        {
+            size *= 1024 * 1024;
+        }
+
+        if (level == 1 && info->l1_cache_size == 0)
+        {
+            info->l1_cache_size = size;
+
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/coherency_line_size", index);
+            if (info->cache_line_size == 0 && mufft_read_sysfs(path, buffer, sizeof(buffer)))
+            {
+                info->cache_line_size = strtoul(buffer, NULL, 10);
+            }
+        }
+        else if (level == 2 && info->l2_cache_size == 0)
+        {
+            info->l2_cache_size = size;
+        }
+        else if (level == 3 && info->l3_cache_size == 0)
+        {
+            info->l3_cache_size = size;
+        }
+    }
+}
+
+/// \brief Counts the CPUs in a sysfs CPU list like "0-3,8-11".
+static unsigned mufft_count_cpu_list(const char *list)
+{
+    unsigned count = 0;
+    while (*list >= '0' && *list <= '9')
+    {
+        char *end;
+        unsigned first = strtoul(list, &end, 10);
+        unsigned last = first;
+        if (*end == '-')
+        {
+            last = strtoul(end + 1, &end, 10);
+        }
+        count += last >= first ? last - first + 1 : 0;
+        list = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+/// \brief Fills in core counts from sysfs.
+/// Physical cores are counted assuming every core has as many hardware threads as the first one.
+static void mufft_linux_get_cores(mufft_cpu_info *info)
+{
+    char buffer[256];
+    if (mufft_read_sysfs("/sys/devices/system/cpu/online", buffer, sizeof(buffer)))
+    {
+        info->logical_cores = mufft_count_cpu_list(buffer);
+    }
+#ifdef _SC_NPROCESSORS_ONLN
+    if (info->logical_cores == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        info->logical_cores = cpus > 0 ? (unsigned)cpus : 0;
+    }
+#endif
+
+    if (mufft_read_sysfs("/sys/devices/system/cpu/cpu0/topology/thread_siblings_list", buffer, sizeof(buffer)))
+    {
+        unsigned threads = mufft_count_cpu_list(buffer);
+        if (threads != 0)
+        {
+            info->physical_cores = info->logical_cores / threads;
+        }
+    }
+}
+#endif
+
+/// \brief Limits SIMD instruction sets to the tier named by the `MUFFT_CPU` environment variable, if it is set.
+/// Instruction sets the CPU does not support are never enabled.
+static unsigned mufft_override_cpu_flags(unsigned flags)
+{
+    static const struct
+    {
+        const char *name;
+        unsigned flags;
+    } tiers[] = {
+        { "avx", MUFFT_FLAG_CPU_AVX | MUFFT_FLAG_CPU_SSE3 | MUFFT_FLAG_CPU_SSE },
+        { "sse3", MUFFT_FLAG_CPU_SSE3 | MUFFT_FLAG_CPU_SSE },
+        { "sse", MUFFT_FLAG_CPU_SSE },
+        { "c", 0 },
+    };
+
+    const char *tier = getenv("MUFFT_CPU");
+    if (tier == NULL)
+    {
+        return flags;
+    }
+
+    for (unsigned i = 0; i < ARRAY_SIZE(tiers); i++)
+    {
+        if (strcmp(tier, tiers[i].name) == 0)
+        {
+            return flags & tiers[i].flags;
+        }
+    }
+
+    return flags;
+}
+
+/// \brief Detects the CPU from scratch. This is slow, see \ref mufft_get_cpu_info.
+static void mufft_detect_cpu_info(mufft_cpu_info *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->flags = mufft_override_cpu_flags(mufft_detect_cpu_flags());
+
+#ifdef MUFFT_HAVE_X86
+    mufft_x86_get_caches(info);
+#endif
+
+#if defined(__linux__)
+    if (info->l1_cache_size == 0 || info->l2_cache_size == 0 || info->l3_cache_size == 0)
+    {
+        mufft_linux_get_caches(info);
+    }
+    mufft_linux_get_cores(info);
+#elif defined(_MSC_VER)
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    info->logical_cores = system_info.dwNumberOfProcessors;
+#endif
+}
+
+/// The CPU as detected by the first call to \ref mufft_get_cpu_info. Only valid once cpu_info_valid is set.
+static mufft_cpu_info cpu_info;
+/// Set once cpu_info holds the detected CPU.
+static bool cpu_info_valid;
+/// Lock for cpu_info and cpu_info_valid.
+static volatile long cpu_info_lock;
+
+// CPUID is serializing, and under virtualization every CPUID traps to the hypervisor.
+// Planning needs the CPU flags several times per plan, so the CPU is only detected once.
+// Threads racing for the first call may all detect it, but only the first result is kept,
+// so the lock is never held across detection.
+void mufft_get_cpu_info(mufft_cpu_info *info)
+{
+    spin_lock(&cpu_info_lock);
+    bool valid = cpu_info_valid;
+    if (valid)
+    {
+        *info = cpu_info;
+    }
+    spin_unlock(&cpu_info_lock);
+
+    if (valid)
+    {
+        return;
+    }
+
+    mufft_cpu_info detected;
+    mufft_detect_cpu_info(&detected);
+
+    spin_lock(&cpu_info_lock);
+    if (!cpu_info_valid)
+    {
+        cpu_info = detected;
+        cpu_info_valid = true;
+    }
+    *info = cpu_info;
+    spin_unlock(&cpu_info_lock);
+}
+
+unsigned mufft_get_cpu_flags(void)
+{
+    mufft_cpu_info info;
+    mufft_get_cpu_info(&info);
+    return info.flags;
+}
@@ -23,6 +23,22 @@
 #include <string.h>
 #include <stdint.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#endif
+
+#if defined(__linux__) && defined(_DEFAULT_SOURCE) && defined(SYS_mbind) && defined(SYS_get_mempolicy) && defined(MPOL_F_NODE)
+/// Set if NUMA placement can be requested with mbind() and checked with get_mempolicy().
+#define MUFFT_HAVE_MEMPOLICY
+#endif
+
 /// ABI compatible struct for \ref mufft_step_1d and \ref mufft_step_2d.
 struct mufft_step_base
 {
@@ -32,11 +48,14 @@ struct mufft_step_base
     unsigned twiddle_offset; ///< Offset into twiddle factor table.
 };
 
+/// Every step has a radix of at least 2, so no transform of 32-bit size needs more steps than this.
+#define MUFFT_MAX_STEPS 32
+
 /// Represents a single step of a complete 1D/horizontal FFT.
 struct mufft_step_1d
 {
     mufft_1d_func func; ///< Function pointer to a 1D partial FFT.
-    unsigned radix; ///< Radix of the FFT step. 2, 4 or 8.
+    unsigned radix; ///< Radix of the FFT step. 2, 4 or 8, or 64 for two fused radix-8 steps.
     unsigned p; ///< The current p factor of the FFT. Determines butterfly stride. It is equal to prev_step.p * prev_step.radix. Initial value is 1.
     unsigned twiddle_offset; ///< Offset into twiddle factor table.
 };
@@ -50,39 +69,112 @@ struct mufft_step_2d
     unsigned twiddle_offset; ///< Offset into twiddle factor table.
 };
 
+/// Represents the normalization of a transform, folded into one of the steps of a horizontal transform.
+struct mufft_scale_step
+{
+    mufft_1d_scale_func func; ///< If non-NULL, replaces step mufft_scale_step::index and scales its input. Otherwise, output is scaled in a separate pass.
+    unsigned index; ///< Index of the step which is replaced by mufft_scale_step::func.
+    float scale; ///< Normalization factor. 1.0f if the transform is not normalized.
+};
+
 /// Represents a complete plan for a 1D FFT.
+/// The plan is allocated as one block with its scratch buffer, see \ref alloc_plan_arena.
 struct mufft_plan_1d
 {
-    struct mufft_step_1d *steps; ///< A list of steps to take to complete a full N-tap FFT.
+    struct mufft_step_1d steps[MUFFT_MAX_STEPS]; ///< A list of steps to take to complete a full N-tap FFT.
     unsigned num_steps; ///< Number of steps contained in mufft_plan_1d::steps.
     unsigned N; ///< Size of the 1D transform.
 
-    cfloat *tmp_buffer; ///< A temporary buffer used during intermediate steps of the FFT.
-    cfloat *twiddles; ///< Buffer holding twiddle factors used in the FFT.
+    cfloat *tmp_buffer; ///< A temporary buffer used during intermediate steps of the FFT. Points into the plan's own block.
+    const cfloat *twiddles; ///< Buffer holding twiddle factors used in the FFT.
 
     mufft_r2c_resolve_func r2c_resolve; ///< If non-NULL, a function to turn a N / 2 complex transform into a N-tap real transform.
     mufft_r2c_resolve_func c2r_resolve; ///< If non-NULL, a function to turn a N real inverse transform into a N / 2 complex transform.
-    cfloat *r2c_twiddles; ///< Special twiddle factors used in mufft_plan_1d::r2c_resolve or mufft_plan_1d::c2r_resolve.
+    mufft_resolve_step_func r2c_last_step; ///< If non-NULL, replaces the last step and does the R2C resolve in the same pass. mufft_plan_1d::r2c_resolve is NULL then.
+    mufft_resolve_step_func c2r_first_step; ///< If non-NULL, replaces the first step and does the C2R resolve in the same pass. mufft_plan_1d::c2r_resolve is NULL then.
+    const cfloat *r2c_twiddles; ///< Special twiddle factors used in mufft_plan_1d::r2c_resolve or mufft_plan_1d::c2r_resolve.
+
+    mufft_partial_dft_func partial_dft; ///< If non-NULL, the plan is output pruned. Computes the requested bins after the first mufft_plan_1d::num_steps steps.
+    unsigned first_bin; ///< First output bin of an output pruned plan.
+    unsigned num_bins; ///< Number of output bins of an output pruned plan.
+
+    unsigned input_size; ///< Number of floats read from input.
+    unsigned padded_input_size; ///< If larger than mufft_plan_1d::input_size, input is copied to scratch and zero padded to this many floats before the first step.
+
+    struct mufft_scale_step scale; ///< Normalization of the transform.
+    unsigned output_size; ///< Number of floats written to output.
 };
 
 /// Represents a complete plan for a 2D FFT.
+/// The plan is allocated as one block with its scratch buffer, see \ref alloc_plan_arena.
 struct mufft_plan_2d
 {
-    struct mufft_step_1d *steps_x; ///< A list of steps to take to complete a full horizontal Nx-tap FFT.
+    struct mufft_step_1d steps_x[MUFFT_MAX_STEPS]; ///< A list of steps to take to complete a full horizontal Nx-tap FFT.
     unsigned num_steps_x; ///< Number of steps contained in mufft_plan_2d::steps_x.
-    struct mufft_step_2d *steps_y; ///< Number of steps to take to complete to full vertical Ny-tap FFT.
+    struct mufft_step_2d steps_y[MUFFT_MAX_STEPS]; ///< Number of steps to take to complete to full vertical Ny-tap FFT.
     unsigned num_steps_y; ///< Number of steps contained in mufft_plan_2d::steps_y.
     unsigned Nx; ///< Size of the horizontal transform.
     unsigned Ny; ///< Size of the vertical transform.
 
-    cfloat *tmp_buffer; ///< A temporary buffer used during intermediate steps of the FFT.
-    cfloat *twiddles_x; ///< Buffer holding twiddle factors used in the horizontal FFT.
-    cfloat *twiddles_y; ///< Buffer holding twiddle factors used in the vertical FFT.
+    cfloat *tmp_buffer; ///< A temporary buffer used during intermediate steps of the FFT. Points into the plan's own block.
+    const cfloat *twiddles_x; ///< Buffer holding twiddle factors used in the horizontal FFT.
+    const cfloat *twiddles_y; ///< Buffer holding twiddle factors used in the vertical FFT.
 
     mufft_r2c_resolve_func r2c_resolve; ///< If non-NULL, a function to turn a N / 2 complex transform into a N-tap real transform.
     mufft_r2c_resolve_func c2r_resolve; ///< If non-NULL, a function to turn a N real inverse transform into a N / 2 complex transform.
-    cfloat *r2c_twiddles; ///< Special twiddle factors used in mufft_plan_2d::r2c_resolve or mufft_plan_2d::c2r_resolve.
+    const cfloat *r2c_twiddles; ///< Special twiddle factors used in mufft_plan_2d::r2c_resolve or mufft_plan_2d::c2r_resolve.
     unsigned vertical_nx; ///< Number of columns we should process during vertical transform. Usually mufft_plan_2d::Nx, but might be smaller due to real-to-complex transform.
+    unsigned horizontal_ny; ///< Number of rows we should process during horizontal transform. Usually mufft_plan_2d::Ny, but might be smaller due to vertical zero padding.
+    unsigned vertical_block; ///< Number of columns the vertical transform processes through all steps before moving on to the next tile.
+
+    mufft_transpose_func transpose; ///< If non-NULL, columns are transposed into rows and transformed with mufft_plan_2d::steps_t instead of mufft_plan_2d::steps_y.
+    struct mufft_step_1d steps_t[MUFFT_MAX_STEPS]; ///< A list of steps to take to complete a full Ny-tap FFT over a transposed column.
+    unsigned num_steps_t; ///< Number of steps contained in mufft_plan_2d::steps_t.
+    bool transposed_output; ///< If true, the final transpose is skipped, and output is left as Nx rows of Ny samples.
+
+    unsigned input_pitch; ///< If non-zero, the plan is pitched, and this is the distance in floats between two input rows.
+    unsigned output_pitch; ///< Distance in floats between two output rows of a pitched plan.
+    bool compact; ///< If true, complex rows in caller buffers are only Nx + 1 samples long. See \ref execute_plan_2d_compact for the layout of mufft_plan_2d::tmp_buffer.
+
+    struct mufft_scale_step scale; ///< Normalization of the transform, folded into mufft_plan_2d::steps_x.
+};
+
+/// Represents the transform along one of the strided axes of an N-dimensional FFT.
+struct mufft_axis_nd
+{
+    struct mufft_step_2d steps[MUFFT_MAX_STEPS]; ///< A list of steps to take to complete the transform along this axis.
+    unsigned num_steps; ///< Number of steps contained in mufft_axis_nd::steps.
+    const cfloat *twiddles; ///< Buffer holding twiddle factors used along this axis.
+    unsigned N; ///< Size of the transform along this axis.
+    unsigned stride; ///< Distance in complex samples between two consecutive elements along this axis.
+    unsigned num_outer; ///< Number of independent blocks of N * stride samples along slower axes.
+    unsigned num_lines; ///< Number of groups of columns inside a block. Larger than 1 if real-to-complex rows are not fully transformed.
+    unsigned width; ///< Number of columns in every group.
+    unsigned block; ///< Number of columns which are transformed at a time, so that all passes over them stay in cache.
+};
+
+/// Represents a complete plan for an N-dimensional FFT.
+/// The plan is allocated as one block with its axes and scratch buffer, see \ref alloc_plan_arena.
+struct mufft_plan_nd
+{
+    struct mufft_step_1d steps_x[MUFFT_MAX_STEPS]; ///< A list of steps to take to complete a full horizontal Nx-tap FFT.
+    unsigned num_steps_x; ///< Number of steps contained in mufft_plan_nd::steps_x.
+    const cfloat *twiddles_x; ///< Buffer holding twiddle factors used in the horizontal FFT.
+    unsigned Nx; ///< Size of the horizontal transform.
+
+    unsigned num_axes; ///< Number of axes in mufft_plan_nd::axes. One less than the number of dimensions.
+
+    unsigned num_rows; ///< Total number of rows, i.e. product of all sizes except Nx.
+    unsigned row_stride; ///< Distance in complex samples between two rows. Nx, or 2 * Nx if real-to-complex or complex-to-real.
+    unsigned vertical_nx; ///< Number of columns we should process during strided transforms.
+
+    cfloat *tmp_buffer; ///< A temporary buffer used during intermediate steps of the FFT. Points into the plan's own block.
+
+    mufft_r2c_resolve_func r2c_resolve; ///< If non-NULL, a function to turn a N / 2 complex transform into a N-tap real transform.
+    mufft_r2c_resolve_func c2r_resolve; ///< If non-NULL, a function to turn a N real inverse transform into a N / 2 complex transform.
+    const cfloat *r2c_twiddles; ///< Special twiddle factors used in mufft_plan_nd::r2c_resolve or mufft_plan_nd::c2r_resolve.
+
+    struct mufft_axis_nd axes[]; ///< The strided axes, from fastest to slowest varying.
 };
 
 /// Represents a complete plan for a 1D fast convolution.
@@ -91,48 +183,275 @@ struct mufft_plan_conv
     mufft_plan_1d *plans[2]; ///< 1D FFT plans for first and second inputs.
     mufft_plan_1d *output_plan; ///< 1D FFT plan for inverse FFT.
     size_t block_size; ///< Size required to hold output of mufft_execute_conv_input.
-    void *conv_block; ///< Buffer for the result of multiplying the two buffers in mufft_plan_conv::block.
+    void *conv_block; ///< Points into the plan's own block. Buffer for the result of multiplying the two buffers in mufft_plan_conv::block.
     float normalization; ///< Normalization factor 1 / N.
 
     mufft_convolve_func convolve_func; ///< Function pointer to complex multiply the two buffers in mufft_plan_conv::block.
     unsigned conv_multiply_n; ///< Count passed to mufft_plan_conv::convolve_func. Either N / 2 + 1 or N / 2 depending on the convolution method.
 };
 
-/// \brief Computes the twiddle factor exp(pi * I * direction * k / p)
-static cfloat twiddle(int direction, int k, int p)
+/// Number of hash slots in a \ref mufft_plan_cache. Must be a power of two.
+#define MUFFT_PLAN_CACHE_SLOTS 64
+
+/// Represents a plan owned by a \ref mufft_plan_cache. The plan's arena header points back to it, see \ref mufft_plan_arena_header.
+struct mufft_plan_cache_entry
+{
+    struct mufft_plan_cache_entry *next; ///< Next idle plan in mufft_plan_cache_bucket::idle.
+    void *plan; ///< A \ref mufft_plan_1d or a \ref mufft_plan_2d, depending on mufft_plan_cache_bucket::dimensions.
+    struct mufft_plan_cache_bucket *bucket; ///< The bucket the plan belongs to.
+};
+
+/// Holds all plans of a \ref mufft_plan_cache which were created with the same parameters.
+struct mufft_plan_cache_bucket
+{
+    struct mufft_plan_cache_bucket *next; ///< Next bucket in the same hash slot.
+    struct mufft_plan_cache_entry *idle; ///< Free list of plans which can be handed out.
+    unsigned num_idle; ///< Length of mufft_plan_cache_bucket::idle. Capped at \ref MUFFT_PLAN_CACHE_MAX_IDLE.
+    unsigned num_in_use; ///< Number of plans handed out and not released yet.
+    unsigned slot; ///< Index of the hash slot the bucket is in.
+    unsigned dimensions; ///< 1 or 2.
+    unsigned type; ///< Type of transform. See \ref MUFFT_PLAN_TYPE_C2C.
+    unsigned Nx; ///< Size of the transform, or of the horizontal transform for 2D plans.
+    unsigned Ny; ///< Size of the vertical transform for 2D plans. 1 for 1D plans.
+    int direction; ///< Direction of a complex-to-complex transform. 0 for other types.
+    unsigned flags; ///< Flags the plans were created with.
+};
+
+/// A hash slot of a \ref mufft_plan_cache.
+struct mufft_plan_cache_slot
+{
+    struct mufft_plan_cache_bucket *buckets; ///< All buckets whose parameters hash to this slot.
+    volatile long lock; ///< Lock for the slot and its buckets. Never held while planning or freeing plans.
+};
+
+/// Represents a cache of plans for reuse.
+struct mufft_plan_cache
+{
+    struct mufft_plan_cache_slot slots[MUFFT_PLAN_CACHE_SLOTS]; ///< Buckets hashed by their parameters.
+    mufft_allocator allocator; ///< The global allocator when the cache was created. Backs the cache and its entries and buckets.
+};
+
+static mufft_allocator global_allocator;
+
+/// Node of twiddle factor tables which are shared between all NUMA nodes.
+#define MUFFT_NUMA_NODE_ANY (~0u)
+
+/// \brief Gets the NUMA node the calling thread runs on, or 0 if it cannot be determined.
+static unsigned current_numa_node(void)
+{
+#if defined(__linux__) && defined(SYS_getcpu) && defined(_DEFAULT_SOURCE)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    {
+        return node;
+    }
+#endif
+    return 0;
+}
+
+/// \brief Gets the size of the pages NUMA placement works with.
+static size_t numa_page_size(void)
+{
+#ifdef MUFFT_HAVE_MEMPOLICY
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size > 0)
+    {
+        return (size_t)page_size;
+    }
+#endif
+    return MUFFT_ALIGNMENT;
+}
+
+/// \brief Asks the kernel to place all whole pages of a block on a NUMA node,
+/// and to move pages of the block which were already placed elsewhere.
+/// MPOL_PREFERRED falls back to other nodes when the node runs out of memory instead of failing,
+/// which \ref numa_node_of would then report.
+static void bind_numa_node(void *ptr, size_t size, unsigned node)
+{
+#ifdef MUFFT_HAVE_MEMPOLICY
+    unsigned long mask = 1;
+    // The kernel only looks at the first maxnode - 1 bits of the mask.
+    if (node + 1 >= 8 * sizeof(mask))
+    {
+        return;
+    }
+
+    uintptr_t page_size = numa_page_size();
+    uintptr_t start = ((uintptr_t)ptr + page_size - 1) & ~(page_size - 1);
+    uintptr_t end = ((uintptr_t)ptr + size) & ~(page_size - 1);
+    if (start < end)
+    {
+        mask <<= node;
+        syscall(SYS_mbind, (void*)start, end - start, MPOL_PREFERRED, &mask, 8 * sizeof(mask), MPOL_MF_MOVE);
+    }
+#else
+    (void)ptr;
+    (void)size;
+    (void)node;
+#endif
+}
+
+/// \brief Resets the policy \ref bind_numa_node gave a block before the block goes back to its allocator.
+/// The storage usually comes from a heap, which would hand the pages on to unrelated allocations with the policy still set.
+/// Resetting it also lets the kernel merge the mapping split up by the bind with its neighbours again.
+static void unbind_numa_node(void *ptr, size_t size)
+{
+#ifdef MUFFT_HAVE_MEMPOLICY
+    uintptr_t page_size = numa_page_size();
+    uintptr_t start = ((uintptr_t)ptr + page_size - 1) & ~(page_size - 1);
+    uintptr_t end = ((uintptr_t)ptr + size) & ~(page_size - 1);
+    if (start < end)
+    {
+        syscall(SYS_mbind, (void*)start, end - start, MPOL_DEFAULT, NULL, 0, 0);
+    }
+#else
+    (void)ptr;
+    (void)size;
+#endif
+}
+
+/// \brief Gets the NUMA node the page holding ptr is placed on, or -1 if it cannot be determined.
+static int numa_node_of(const void *ptr)
+{
+#ifdef MUFFT_HAVE_MEMPOLICY
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0, ptr, MPOL_F_NODE | MPOL_F_ADDR) == 0)
+    {
+        return node;
+    }
+#else
+    (void)ptr;
+#endif
+    return -1;
+}
+
+/// Size of the huge pages requested by \ref MUFFT_FLAG_HUGE_PAGES and \ref mufft_alloc_huge.
+#define MUFFT_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/// \brief Allocates storage from allocator, optionally backed by huge pages.
+///
+/// Huge page backed storage is aligned to, and padded out to, whole huge pages,
+/// and the kernel is asked to back it with transparent huge pages.
+/// Storage smaller than a huge page gains nothing from this and is allocated normally.
+/// If the aligned allocation fails, or the system does not support transparent huge pages,
+/// regular pages are used instead. Either way, the storage is freed with allocator as usual.
+/// Unless node is \ref MUFFT_NUMA_NODE_ANY, the storage is bound to that NUMA node with \ref bind_numa_node
+/// before the caller touches it. Such storage must be freed with \ref free_storage.
+/// @param size_ptr The number of bytes needed. Receives the number of bytes allocated, which \ref free_storage needs.
+static void *alloc_storage(const mufft_allocator *allocator, size_t *size_ptr, bool huge, unsigned node)
+{
+    size_t size = *size_ptr;
+    void *ptr = NULL;
+    if (huge && size >= MUFFT_HUGE_PAGE_SIZE)
+    {
+        size_t huge_size = (size + MUFFT_HUGE_PAGE_SIZE - 1) & ~(size_t)(MUFFT_HUGE_PAGE_SIZE - 1);
+        ptr = allocator->alloc(allocator->userdata, huge_size, MUFFT_HUGE_PAGE_SIZE);
+        if (ptr != NULL)
+        {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            madvise(ptr, huge_size, MADV_HUGEPAGE);
+#endif
+            size = huge_size;
+        }
+    }
+
+    if (ptr == NULL)
+    {
+        // Storage bound to a node gets whole pages of its own, so no other allocation has placed them already.
+        size_t alignment = node != MUFFT_NUMA_NODE_ANY ? numa_page_size() : MUFFT_ALIGNMENT;
+        size = (size + alignment - 1) & ~(alignment - 1);
+        ptr = allocator->alloc(allocator->userdata, size, alignment);
+    }
+
+    if (ptr != NULL && node != MUFFT_NUMA_NODE_ANY)
+    {
+        bind_numa_node(ptr, size, node);
+    }
+    *size_ptr = size;
+    return ptr;
+}
+
+/// \brief Frees storage from \ref alloc_storage, which allocated size bytes of it for node.
+static void free_storage(const mufft_allocator *allocator, void *ptr, size_t size, unsigned node)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    if (node != MUFFT_NUMA_NODE_ANY)
+    {
+        unbind_numa_node(ptr, size);
+    }
+    allocator->free(allocator->userdata, ptr);
+}
+
+/// \brief Allocates zeroed out bookkeeping, such as cache records, from allocator. Free it with \ref free_record.
+static void *alloc_record(const mufft_allocator *allocator, size_t size)
+{
+    void *ptr = allocator->alloc(allocator->userdata, size, MUFFT_ALIGNMENT);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/// \brief Frees storage from \ref alloc_record. Can be `NULL` in which case nothing happens.
+static void free_record(const mufft_allocator *allocator, void *ptr)
 {
-    double phase = (M_PI * direction * k) / p;
-    return cfloat_create((float)cos(phase), (float)sin(phase));
+    if (ptr != NULL)
+    {
+        allocator->free(allocator->userdata, ptr);
+    }
 }
 
-/// \brief Builds a table of twiddle factors.
-/// The table is built for a DIT transform with increasing butterfly strides.
-/// The table is suitable for any FFT radix.
+/// \brief Allocates a table of twiddle factors and fills it in with \ref fill_twiddles.
 /// @param N Transform size
 /// @param direction Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+/// @param size Receives the size of the table, see \ref alloc_storage.
 /// @returns Newly allocated twiddle factor table.
-static cfloat *build_twiddles(unsigned N, int direction)
+static cfloat *build_twiddles(const mufft_allocator *allocator, unsigned N, int direction, bool huge, unsigned node,
+        size_t *size)
 {
-    cfloat *twiddles = mufft_alloc(N * sizeof(cfloat));
+    *size = N * sizeof(cfloat);
+    cfloat *twiddles = alloc_storage(allocator, size, huge, node);
     if (twiddles == NULL)
     {
         return NULL;
     }
 
-    cfloat *pt = twiddles;
+    fill_twiddles(twiddles, N, direction);
+    return twiddles;
+}
 
-    for (unsigned p = 1; p < N; p <<= 1)
+/// \brief Allocates a compact table of twiddle factors and fills it in with \ref fill_compact_twiddles.
+/// @param N Transform size
+/// @param direction Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+/// @param size Receives the size of the table, see \ref alloc_storage.
+/// @returns Newly allocated twiddle factor table.
+static cfloat *build_compact_twiddles(const mufft_allocator *allocator, unsigned N, int direction, bool huge, unsigned node,
+        size_t *size)
+{
+    *size = compact_twiddle_level_offset(N) * sizeof(cfloat);
+    cfloat *twiddles = alloc_storage(allocator, size, huge, node);
+    if (twiddles == NULL)
     {
-        for (unsigned k = 0; k < p; k++)
-        {
-            pt[k] = twiddle(direction, k, p);
-        }
-        pt += p == 2 ? 3 : p; // Make sure that twiddles for p == 4 and up are aligned properly for AVX.
+        return NULL;
     }
 
+    fill_compact_twiddles(twiddles, N, direction);
     return twiddles;
 }
 
+/// \brief Checks if a step of a plan reads compact twiddle factor levels, which need kernels that reconstruct them.
+/// Steps read the levels from p up to p * radix / 2.
+static bool step_uses_compact_twiddles(bool compact, unsigned p, unsigned radix)
+{
+    return compact && p * (radix / 2) >= MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL;
+}
+
 /// ABI compatible base struct for \ref fft_step_1d and \ref fft_step_2d.
 struct fft_step_base
 {
@@ -144,8 +463,9 @@ struct fft_step_base
 struct fft_step_1d
 {
     mufft_1d_func func; ///< Function pointer to a 1D partial FFT.
-    unsigned radix; ///< Radix of the FFT step. 2, 4 or 8.
+    unsigned radix; ///< Radix of the FFT step. 2, 4 or 8, or 64 for two fused radix-8 steps.
     unsigned minimum_elements; ///< Minimum transform size for which this function can be used.
+    unsigned maximum_elements; ///< If non-zero, maximum transform size for which this function can be used.
     unsigned fixed_p; ///< Non-zero if this can only be used with a fixed value for mufft_step_base::p.
     unsigned minimum_p; ///< Minimum p-factor for which this can be used. Set to -1u if it can only be used with fft_step_1d::fixed_p.
     unsigned flags; ///< Flags which determine under which conditions this function can be used.
@@ -171,6 +491,16 @@ struct fft_r2c_resolve_step
     unsigned flags; ///< Flags which determine under which conditions this function can be used.
 };
 
+/// Represents an FFT step which has the R2C resolve or C2R resolve folded into it.
+struct fft_resolve_step
+{
+    mufft_resolve_step_func func; ///< Function pointer to the fused step.
+    unsigned radix; ///< Radix of the FFT step.
+    unsigned minimum_elements; ///< Minimum complex transform size for which this function can be used.
+    unsigned minimum_p; ///< Minimum p-factor for which this function can be used.
+    unsigned flags; ///< Flags which determine under which conditions this function can be used.
+};
+
 /// Represents an array complex multiply routine.
 struct fft_convolve_step
 {
@@ -193,6 +523,29 @@ static const struct fft_convolve_step convolve_table[] = {
     STAMP_CPU_CONVOLVE(0, c),
 };
 
+/// Represents a transpose routine.
+struct fft_transpose_step
+{
+    mufft_transpose_func func; ///< Function pointer to a transpose routine.
+    unsigned minimum_elements; ///< Minimum number of rows and columns for which this function can be used.
+    unsigned flags; ///< Flags which determine under which conditions this function can be used.
+};
+
+static const struct fft_transpose_step transpose_table[] = {
+#define STAMP_CPU_TRANSPOSE(arch, ext, min_x) \
+    { .flags = arch, .func = mufft_transpose_ ## ext, .minimum_elements = min_x }
+#ifdef MUFFT_HAVE_AVX
+    STAMP_CPU_TRANSPOSE(MUFFT_FLAG_CPU_AVX, avx, 4),
+#endif
+#ifdef MUFFT_HAVE_SSE3
+    STAMP_CPU_TRANSPOSE(MUFFT_FLAG_CPU_SSE3, sse3, 2),
+#endif
+#ifdef MUFFT_HAVE_SSE
+    STAMP_CPU_TRANSPOSE(MUFFT_FLAG_CPU_SSE, sse, 2),
+#endif
+    STAMP_CPU_TRANSPOSE(0, c, 1),
+};
+
 static const struct fft_r2c_resolve_step fft_r2c_resolve_table[] = {
 #define STAMP_CPU_RESOLVE(arch, ext, min_x) \
     { .flags = arch | MUFFT_FLAG_FULL_R2C, \
@@ -214,6 +567,47 @@ static const struct fft_r2c_resolve_step fft_r2c_resolve_table[] = {
     STAMP_CPU_RESOLVE(0, c, 1),
 };
 
+// R2C steps replace the last step of the plan, where p == N / radix.
+// C2R steps replace the first step, which always has p == 1.
+static const struct fft_resolve_step fft_resolve_step_table[] = {
+#define STAMP_CPU_RESOLVE_STEP(arch, ext, min_x) \
+    { .flags = arch | MUFFT_FLAG_FULL_R2C, \
+        .func = mufft_r2c_full_radix8_last_ ## ext, .radix = 8, .minimum_p = 2 * min_x }, \
+    { .flags = arch | MUFFT_FLAG_FULL_R2C, \
+        .func = mufft_r2c_full_radix4_last_ ## ext, .radix = 4, .minimum_p = 2 * min_x }, \
+    { .flags = arch | MUFFT_FLAG_FULL_R2C, \
+        .func = mufft_r2c_full_radix2_last_ ## ext, .radix = 2, .minimum_p = 2 * min_x }, \
+    { .flags = arch | MUFFT_FLAG_R2C, \
+        .func = mufft_r2c_radix8_last_ ## ext, .radix = 8, .minimum_p = 2 * min_x }, \
+    { .flags = arch | MUFFT_FLAG_R2C, \
+        .func = mufft_r2c_radix4_last_ ## ext, .radix = 4, .minimum_p = 2 * min_x }, \
+    { .flags = arch | MUFFT_FLAG_R2C, \
+        .func = mufft_r2c_radix2_last_ ## ext, .radix = 2, .minimum_p = 2 * min_x }, \
+    { .flags = arch | MUFFT_FLAG_C2R, \
+        .func = mufft_c2r_radix8_p1_ ## ext, .radix = 8, .minimum_elements = 8 * min_x, .minimum_p = 1 }, \
+    { .flags = arch | MUFFT_FLAG_C2R, \
+        .func = mufft_c2r_radix4_p1_ ## ext, .radix = 4, .minimum_elements = 4 * min_x, .minimum_p = 1 }, \
+    { .flags = arch | MUFFT_FLAG_C2R, \
+        .func = mufft_c2r_radix2_p1_ ## ext, .radix = 2, .minimum_elements = 2 * min_x, .minimum_p = 1 }
+
+#ifdef MUFFT_HAVE_AVX
+    STAMP_CPU_RESOLVE_STEP(MUFFT_FLAG_CPU_AVX, avx, 4),
+#endif
+#ifdef MUFFT_HAVE_SSE3
+    STAMP_CPU_RESOLVE_STEP(MUFFT_FLAG_CPU_SSE3, sse3, 2),
+#endif
+#ifdef MUFFT_HAVE_SSE
+    STAMP_CPU_RESOLVE_STEP(MUFFT_FLAG_CPU_SSE, sse, 2),
+#endif
+    STAMP_CPU_RESOLVE_STEP(0, c, 1),
+};
+
+/// Transforms smaller than this stay in L1 between passes anyway, and do not benefit from fused radix-64 passes.
+#define MUFFT_FUSED_MINIMUM_ELEMENTS (4 * 1024)
+/// A fused radix-64 pass reads and writes 64 streams at once. Once both buffers fall out of L2,
+/// that defeats the hardware prefetchers and costs more than the pass it saves.
+#define MUFFT_FUSED_MAXIMUM_ELEMENTS (16 * 1024)
+
 static const struct fft_step_1d fft_1d_table[] = {
 #define STAMP_CPU_1D(arch, ext, min_x) \
     { .flags = arch | MUFFT_FLAG_DIRECTION_FORWARD | MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF, \
@@ -236,12 +630,21 @@ static const struct fft_step_1d fft_1d_table[] = {
         .func = mufft_inverse_radix4_p1_ ## ext, .minimum_elements = 4 * min_x, .radix = 4, .fixed_p = 1, .minimum_p = ~0u }, \
     { .flags = arch | MUFFT_FLAG_DIRECTION_INVERSE, \
         .func = mufft_inverse_radix2_p2_ ## ext, .minimum_elements = 2 * min_x, .radix = 2, .fixed_p = 2, .minimum_p = ~0u }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
+        .func = mufft_radix64_fused_ ## ext, .minimum_elements = MUFFT_FUSED_MINIMUM_ELEMENTS, \
+        .maximum_elements = MUFFT_FUSED_MAXIMUM_ELEMENTS, .radix = 64, .minimum_p = 8 }, \
     { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
         .func = mufft_radix8_generic_ ## ext, .minimum_elements = 8 * min_x, .radix = 8, .minimum_p = 8 }, \
     { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
         .func = mufft_radix4_generic_ ## ext, .minimum_elements = 4 * min_x, .radix = 4, .minimum_p = 4 }, \
     { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
-        .func = mufft_radix2_generic_ ## ext, .minimum_elements = 2 * min_x, .radix = 2, .minimum_p = 4 }
+        .func = mufft_radix2_generic_ ## ext, .minimum_elements = 2 * min_x, .radix = 2, .minimum_p = 4 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_COMPACT_TWIDDLES, \
+        .func = mufft_radix8_compact_ ## ext, .minimum_elements = 8 * min_x, .radix = 8, .minimum_p = 8 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_COMPACT_TWIDDLES, \
+        .func = mufft_radix4_compact_ ## ext, .minimum_elements = 4 * min_x, .radix = 4, .minimum_p = 4 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_COMPACT_TWIDDLES, \
+        .func = mufft_radix2_compact_ ## ext, .minimum_elements = 2 * min_x, .radix = 2, .minimum_p = 4 }
 
 #ifdef MUFFT_HAVE_AVX
     STAMP_CPU_1D(MUFFT_FLAG_CPU_AVX, avx, 4),
@@ -255,17 +658,140 @@ static const struct fft_step_1d fft_1d_table[] = {
     STAMP_CPU_1D(0, c, 1),
 };
 
+// Used as first step when only the first N / p input elements can be non-zero, for p >= 4.
+static const struct fft_step_1d fft_1d_broadcast_table[] = {
+#define STAMP_CPU_1D_BROADCAST(arch, ext, min_x) \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
+        .func = mufft_radix8_broadcast_ ## ext, .minimum_elements = 8 * min_x, .radix = 8, .minimum_p = 8 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
+        .func = mufft_radix4_broadcast_ ## ext, .minimum_elements = 4 * min_x, .radix = 4, .minimum_p = 4 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
+        .func = mufft_radix2_broadcast_ ## ext, .minimum_elements = 2 * min_x, .radix = 2, .minimum_p = 4 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_COMPACT_TWIDDLES, \
+        .func = mufft_radix8_broadcast_compact_ ## ext, .minimum_elements = 8 * min_x, .radix = 8, .minimum_p = 8 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_COMPACT_TWIDDLES, \
+        .func = mufft_radix4_broadcast_compact_ ## ext, .minimum_elements = 4 * min_x, .radix = 4, .minimum_p = 4 }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_COMPACT_TWIDDLES, \
+        .func = mufft_radix2_broadcast_compact_ ## ext, .minimum_elements = 2 * min_x, .radix = 2, .minimum_p = 4 }
+
+#ifdef MUFFT_HAVE_AVX
+    STAMP_CPU_1D_BROADCAST(MUFFT_FLAG_CPU_AVX, avx, 4),
+#endif
+#ifdef MUFFT_HAVE_SSE3
+    STAMP_CPU_1D_BROADCAST(MUFFT_FLAG_CPU_SSE3, sse3, 2),
+#endif
+#ifdef MUFFT_HAVE_SSE
+    STAMP_CPU_1D_BROADCAST(MUFFT_FLAG_CPU_SSE, sse, 2),
+#endif
+    STAMP_CPU_1D_BROADCAST(0, c, 1),
+};
+
+/// Represents a variant of a generic 1D step which multiplies its input by a scale factor.
+struct fft_scale_step
+{
+    mufft_1d_func func; ///< The generic step this can replace.
+    mufft_1d_scale_func scale_func; ///< Function pointer to the scaling variant of fft_scale_step::func.
+};
+
+// The scaling variants have the same requirements as the generic steps they replace.
+static const struct fft_scale_step fft_1d_scale_table[] = {
+#define STAMP_CPU_1D_SCALE(ext) \
+    { .func = mufft_radix8_generic_ ## ext, .scale_func = mufft_radix8_generic_scale_ ## ext }, \
+    { .func = mufft_radix4_generic_ ## ext, .scale_func = mufft_radix4_generic_scale_ ## ext }, \
+    { .func = mufft_radix2_generic_ ## ext, .scale_func = mufft_radix2_generic_scale_ ## ext }
+
+#ifdef MUFFT_HAVE_AVX
+    STAMP_CPU_1D_SCALE(avx),
+#endif
+#ifdef MUFFT_HAVE_SSE3
+    STAMP_CPU_1D_SCALE(sse3),
+#endif
+#ifdef MUFFT_HAVE_SSE
+    STAMP_CPU_1D_SCALE(sse),
+#endif
+    STAMP_CPU_1D_SCALE(c),
+};
+
+/// Represents a variant of a generic 1D step which writes its output with non-temporal stores.
+struct fft_stream_step
+{
+    mufft_1d_func func; ///< The generic step this can replace.
+    mufft_1d_func stream_func; ///< Function pointer to the streaming variant of fft_stream_step::func.
+};
+
+/// Once the output of a transform is this large, it does not stay in cache until the caller reads it anyway,
+/// so the last step writes it with non-temporal stores rather than pulling every output line into cache first.
+/// Hosts with a large last level cache raise the threshold, see \ref stream_minimum_bytes.
+#define MUFFT_STREAM_MINIMUM_BYTES (64 * 1024 * 1024)
+
+// The streaming variants have the same requirements as the generic steps they replace.
+// Plain C has no non-temporal stores, so there are only SIMD variants.
+static const struct fft_stream_step fft_1d_stream_table[] = {
+#define STAMP_CPU_1D_STREAM(ext) \
+    { .func = mufft_radix8_generic_ ## ext, .stream_func = mufft_radix8_generic_stream_ ## ext }, \
+    { .func = mufft_radix4_generic_ ## ext, .stream_func = mufft_radix4_generic_stream_ ## ext }, \
+    { .func = mufft_radix2_generic_ ## ext, .stream_func = mufft_radix2_generic_stream_ ## ext }
+
+#ifdef MUFFT_HAVE_AVX
+    STAMP_CPU_1D_STREAM(avx),
+#endif
+#ifdef MUFFT_HAVE_SSE3
+    STAMP_CPU_1D_STREAM(sse3),
+#endif
+#ifdef MUFFT_HAVE_SSE
+    STAMP_CPU_1D_STREAM(sse),
+#endif
+    { .func = NULL }, // Keeps the table non-empty without SIMD.
+};
+
+/// Represents a variant of a generic vertical step which prefetches its input streams explicitly.
+struct fft_prefetch_step_2d
+{
+    mufft_2d_func func; ///< The generic step this can replace.
+    mufft_2d_func prefetch_func; ///< Function pointer to the prefetching variant of fft_prefetch_step_2d::func.
+};
+
+/// Once the columns a vertical step reads span this many bytes, its generic steps prefetch their input streams explicitly.
+/// Vertical steps read short runs of columns from rows far apart, which the hardware prefetchers do not follow well.
+#define MUFFT_PREFETCH_2D_MINIMUM_BYTES (32 * 1024 * 1024)
+
+// The prefetching variants have the same requirements as the generic steps they replace.
+// Plain C has no prefetch intrinsics, so there are only SIMD variants.
+static const struct fft_prefetch_step_2d fft_2d_prefetch_table[] = {
+#define STAMP_CPU_2D_PREFETCH(ext) \
+    { .func = mufft_radix8_generic_vert_ ## ext, .prefetch_func = mufft_radix8_generic_vert_prefetch_ ## ext }, \
+    { .func = mufft_radix4_generic_vert_ ## ext, .prefetch_func = mufft_radix4_generic_vert_prefetch_ ## ext }, \
+    { .func = mufft_radix2_generic_vert_ ## ext, .prefetch_func = mufft_radix2_generic_vert_prefetch_ ## ext }
+
+#ifdef MUFFT_HAVE_AVX
+    STAMP_CPU_2D_PREFETCH(avx),
+#endif
+#ifdef MUFFT_HAVE_SSE3
+    STAMP_CPU_2D_PREFETCH(sse3),
+#endif
+#ifdef MUFFT_HAVE_SSE
+    STAMP_CPU_2D_PREFETCH(sse),
+#endif
+    { .func = NULL }, // Keeps the table non-empty without SIMD.
+};
+
 static const struct fft_step_2d fft_2d_table[] = {
 #define STAMP_CPU_2D(arch, ext, min_x) \
-    { .flags = arch | MUFFT_FLAG_DIRECTION_FORWARD, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_FORWARD | MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF, \
         .func = mufft_forward_radix8_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 8, .radix = 8, .fixed_p = 1, .minimum_p = ~0u }, \
-    { .flags = arch | MUFFT_FLAG_DIRECTION_FORWARD, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_FORWARD | MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF, \
         .func = mufft_forward_radix4_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 4, .radix = 4, .fixed_p = 1, .minimum_p = ~0u }, \
-    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF, \
         .func = mufft_radix2_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 2, .radix = 2, .fixed_p = 1, .minimum_p = ~0u }, \
-    { .flags = arch | MUFFT_FLAG_DIRECTION_INVERSE, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_FORWARD | MUFFT_FLAG_ZERO_PAD_UPPER_HALF, \
+        .func = mufft_forward_half_radix8_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 8, .radix = 8, .fixed_p = 1, .minimum_p = ~0u }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_FORWARD | MUFFT_FLAG_ZERO_PAD_UPPER_HALF, \
+        .func = mufft_forward_half_radix4_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 4, .radix = 4, .fixed_p = 1, .minimum_p = ~0u }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_ANY | MUFFT_FLAG_ZERO_PAD_UPPER_HALF, \
+        .func = mufft_radix2_half_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 2, .radix = 2, .fixed_p = 1, .minimum_p = ~0u }, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_INVERSE | MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF, \
         .func = mufft_inverse_radix8_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 8, .radix = 8, .fixed_p = 1, .minimum_p = ~0u }, \
-    { .flags = arch | MUFFT_FLAG_DIRECTION_INVERSE, \
+    { .flags = arch | MUFFT_FLAG_DIRECTION_INVERSE | MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF, \
         .func = mufft_inverse_radix4_p1_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 4, .radix = 4, .fixed_p = 1, .minimum_p = ~0u }, \
     { .flags = arch | MUFFT_FLAG_DIRECTION_ANY, \
         .func = mufft_radix8_generic_vert_ ## ext, .minimum_elements_x = min_x, .minimum_elements_y = 8, .radix = 8, .minimum_p = 8 }, \
@@ -287,31 +813,17 @@ static const struct fft_step_2d fft_2d_table[] = {
 };
 
 /// \brief Adds a new FFT step to either \ref mufft_step_1d or \ref mufft_step_2d.
-static bool add_step(struct mufft_step_base **steps, unsigned *num_steps,
-        const struct fft_step_base *step, unsigned p)
+/// The first step does not necessarily start at p == 1, so the caller looks up the twiddle level directly.
+/// Steps are stored inline in the plan, which has room for \ref MUFFT_MAX_STEPS of them.
+static bool add_step(struct mufft_step_base *steps, unsigned *num_steps,
+        const struct fft_step_base *step, unsigned p, unsigned twiddle_offset)
 {
-    unsigned twiddle_offset = 0;
-    if (*num_steps != 0)
-    {
-        struct mufft_step_base prev = (*steps)[*num_steps - 1];
-        twiddle_offset = prev.twiddle_offset +
-            (prev.p == 2 ? 3 : (prev.p * (prev.radix - 1)));
-
-        // We skipped radix2 kernels, we have to add the padding twiddle here.
-        if (p >= 4 && prev.p == 1)
-        {
-            twiddle_offset++;
-        }
-    }
-
-    struct mufft_step_base *new_steps = realloc(*steps, (*num_steps + 1) * sizeof(*new_steps));
-    if (new_steps == NULL)
+    if (*num_steps >= MUFFT_MAX_STEPS)
     {
         return false;
     }
 
-    *steps = new_steps;
-    (*steps)[*num_steps] = (struct mufft_step_base) {
+    steps[*num_steps] = (struct mufft_step_base) {
         .func = step->func,
         .radix = step->radix,
         .p = p,
@@ -322,10 +834,14 @@ static bool add_step(struct mufft_step_base **steps, unsigned *num_steps,
 }
 
 /// \brief Builds a plan for a horizontal transform.
-static bool build_plan_1d(struct mufft_step_1d **steps, unsigned *num_steps, unsigned N, int direction, unsigned flags)
+/// If first_p is larger than 1, only the first N / first_p input elements can be non-zero,
+/// and the plan starts directly at butterfly stride first_p with a broadcast step.
+/// With \ref MUFFT_FLAG_COMPACT_TWIDDLES, the plan expects a table from \ref build_compact_twiddles.
+static bool build_plan_1d(struct mufft_step_1d *steps, unsigned *num_steps, unsigned N, int direction, unsigned flags,
+        unsigned first_p)
 {
-    unsigned radix = N;
-    unsigned p = 1;
+    unsigned radix = N / first_p;
+    unsigned p = first_p;
 
     unsigned step_flags = 0;
     switch (direction)
@@ -343,23 +859,39 @@ static bool build_plan_1d(struct mufft_step_1d **steps, unsigned *num_steps, uns
     step_flags |= mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
     step_flags |= (flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF) != 0 ?
         MUFFT_FLAG_ZERO_PAD_UPPER_HALF : MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF;
+    bool compact = (flags & MUFFT_FLAG_COMPACT_TWIDDLES) != 0;
 
     while (radix > 1)
     {
         bool found = false;
 
+        const struct fft_step_1d *table = fft_1d_table;
+        unsigned table_size = ARRAY_SIZE(fft_1d_table);
+        if (*num_steps == 0 && first_p > 1)
+        {
+            table = fft_1d_broadcast_table;
+            table_size = ARRAY_SIZE(fft_1d_broadcast_table);
+        }
+
         // Find first (optimal?) routine which can do work.
-        for (unsigned i = 0; i < ARRAY_SIZE(fft_1d_table); i++)
+        for (unsigned i = 0; i < table_size; i++)
         {
-            const struct fft_step_1d *step = &fft_1d_table[i];
+            const struct fft_step_1d *step = &table[i];
+
+            // Compact kernels are only used for the steps which actually read compact levels.
+            bool compact_step = (step->flags & MUFFT_FLAG_COMPACT_TWIDDLES) != 0;
 
             if (radix % step->radix == 0 &&
                     N >= step->minimum_elements &&
-                    (step_flags & step->flags) == step->flags &&
+                    (step->maximum_elements == 0 || N <= step->maximum_elements) &&
+                    (step_flags & step->flags) == (step->flags & ~MUFFT_FLAG_COMPACT_TWIDDLES) &&
+                    compact_step == step_uses_compact_twiddles(compact, p, step->radix) &&
                     (p >= step->minimum_p || p == step->fixed_p))
             {
+                unsigned twiddle_offset = compact ? compact_twiddle_level_offset(p) : twiddle_level_offset(p);
+
                 // Ugly casting, but add_step_1d and add_step_2d are ABI-wise exactly the same, and we don't have templates :(
-                if (add_step((struct mufft_step_base**)steps, num_steps, (const struct fft_step_base*)step, p))
+                if (add_step((struct mufft_step_base*)steps, num_steps, (const struct fft_step_base*)step, p, twiddle_offset))
                 {
                     found = true;
                     radix /= step->radix;
@@ -379,7 +911,7 @@ static bool build_plan_1d(struct mufft_step_1d **steps, unsigned *num_steps, uns
 }
 
 /// \brief Builds a plan for a vertical transform.
-static bool build_plan_2d(struct mufft_step_2d **steps, unsigned *num_steps, unsigned Nx, unsigned Ny, int direction, unsigned flags)
+static bool build_plan_2d(struct mufft_step_2d *steps, unsigned *num_steps, unsigned Nx, unsigned Ny, int direction, unsigned flags)
 {
     unsigned radix = Ny;
     unsigned p = 1;
@@ -397,6 +929,9 @@ static bool build_plan_2d(struct mufft_step_2d **steps, unsigned *num_steps, uns
     }
     // Add CPU flags. Just accept any CPU for now, but mask out flags we don't want.
     step_flags |= mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
+    // Vertically, the upper half is the lower half of the rows.
+    step_flags |= (flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y) != 0 ?
+        MUFFT_FLAG_ZERO_PAD_UPPER_HALF : MUFFT_FLAG_NO_ZERO_PAD_UPPER_HALF;
 
     while (radix > 1)
     {
@@ -415,7 +950,8 @@ static bool build_plan_2d(struct mufft_step_2d **steps, unsigned *num_steps, uns
             {
                 // Ugly casting, but add_step_1d and add_step_2d are ABI-wise exactly the same,
                 // and we don't have templates :(
-                if (add_step((struct mufft_step_base**)steps, num_steps, (const struct fft_step_base*)step, p))
+                if (add_step((struct mufft_step_base*)steps, num_steps, (const struct fft_step_base*)step, p,
+                            twiddle_level_offset(p)))
                 {
                     found = true;
                     radix /= step->radix;
@@ -434,351 +970,1632 @@ static bool build_plan_2d(struct mufft_step_2d **steps, unsigned *num_steps, uns
     return true;
 }
 
-// The real-to-complex transform is implemented with a N / 2 complex transform with a
-// final butterfly which extracts real/imag parts of the complex transform.
-// See http://www.engineeringproductivitytools.com/stuff/T0001/PT10.HTM for details on algorithm.
-
-static cfloat *build_r2c_twiddles(int direction, unsigned N)
+/// \brief Returns the normalization factor requested by flags for a transform of N samples in total.
+static float normalization_scale(unsigned flags, unsigned N)
 {
-    cfloat *twiddles = mufft_alloc(N * sizeof(cfloat));
-    if (twiddles == NULL)
+    if ((flags & MUFFT_FLAG_NORMALIZE) != 0)
     {
-        return NULL;
+        return (float)(1.0 / N);
     }
-
-    for (unsigned i = 0; i < N; i++)
+    else if ((flags & MUFFT_FLAG_NORMALIZE_ORTHO) != 0)
     {
-        twiddles[i] = cfloat_mul(cfloat_create(0.0f, direction), twiddle(direction, i, N));
+        return (float)(1.0 / sqrt((double)N));
     }
+    else
+    {
+        return 1.0f;
+    }
+}
 
-    return twiddles;
-}
-
-static mufft_r2c_resolve_func find_r2c_resolve_func(unsigned flags, unsigned N)
+/// \brief Reads a size in bytes from the environment variable name, or returns fallback if it is not set to one.
+/// Thresholds read this when plans are created, so it can be changed between plans, e.g. to compare both ways in benchmarks.
+static size_t env_size_override(const char *name, size_t fallback)
 {
-    // Add CPU flags. Just accept any CPU for now, but mask out flags we don't want.
-    unsigned resolve_flags = mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
-    resolve_flags |= flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R | MUFFT_FLAG_FULL_R2C);
-
-    for (unsigned i = 0; i < ARRAY_SIZE(fft_r2c_resolve_table); i++)
+    const char *override = getenv(name);
+    if (override != NULL && *override != '\0')
     {
-        const struct fft_r2c_resolve_step *step = &fft_r2c_resolve_table[i];
-        if ((step->flags & resolve_flags) == step->flags &&
-                N >= step->minimum_elements)
+        char *end;
+        unsigned long long bytes = strtoull(override, &end, 10);
+        if (*end == '\0')
         {
-            return step->func;
+            return bytes < SIZE_MAX ? (size_t)bytes : SIZE_MAX;
         }
     }
+    return fallback;
+}
 
-    return NULL;
+/// \brief Gets the output size from which the last step of a transform writes with non-temporal stores.
+/// Output which fits in the L3 cache twice over might well still be there when the caller reads it,
+/// so the threshold is the larger of \ref MUFFT_STREAM_MINIMUM_BYTES and twice the L3 cache of the host.
+/// The `MUFFT_STREAM_BYTES` environment variable overrides it, see \ref env_size_override.
+static size_t stream_minimum_bytes(void)
+{
+    mufft_cpu_info info;
+    mufft_get_cpu_info(&info);
+    size_t cache_bytes = 2 * info.l3_cache_size;
+    return env_size_override("MUFFT_STREAM_BYTES",
+            cache_bytes > MUFFT_STREAM_MINIMUM_BYTES ? cache_bytes : MUFFT_STREAM_MINIMUM_BYTES);
 }
 
-mufft_plan_1d *mufft_create_plan_1d_r2c(unsigned N, unsigned flags)
+/// \brief Lets the last step of a horizontal transform write its output with non-temporal stores if it is large enough.
+/// Only call this for plans whose last step writes the output of the transform. It must run before \ref set_plan_scale,
+/// as the streaming variants cannot scale.
+static void set_plan_streaming(struct mufft_step_1d *steps, unsigned num_steps, unsigned N)
 {
-    if ((N & (N - 1)) != 0 || N == 1)
+    if (num_steps == 0 || (size_t)N * sizeof(cfloat) < stream_minimum_bytes())
     {
-        return NULL;
+        return;
     }
 
-    unsigned complex_n = N / 2;
+    struct mufft_step_1d *last_step = &steps[num_steps - 1];
+    for (unsigned i = 0; i < ARRAY_SIZE(fft_1d_stream_table); i++)
+    {
+        if (fft_1d_stream_table[i].func == last_step->func)
+        {
+            last_step->func = fft_1d_stream_table[i].stream_func;
+            return;
+        }
+    }
+}
 
-    mufft_plan_1d *plan = mufft_create_plan_1d_c2c(complex_n, MUFFT_FORWARD, flags);
-    if (plan == NULL)
+/// \brief Puts back the generic step where \ref set_plan_streaming let a step write with non-temporal stores.
+/// Used by plan variants whose output is read again right away, so it should stay in cache.
+static void clear_plan_streaming(struct mufft_step_1d *steps, unsigned num_steps)
+{
+    for (unsigned i = 0; i < num_steps; i++)
     {
-        goto error;
+        for (unsigned j = 0; j < ARRAY_SIZE(fft_1d_stream_table); j++)
+        {
+            if (fft_1d_stream_table[j].stream_func == steps[i].func)
+            {
+                steps[i].func = fft_1d_stream_table[j].func;
+                break;
+            }
+        }
     }
+}
 
-    plan->r2c_twiddles = build_r2c_twiddles(MUFFT_FORWARD, complex_n);
-    if (plan->r2c_twiddles == NULL)
+/// \brief Lets the generic steps of a vertical transform prefetch their input if the rows they read span at least
+/// \ref MUFFT_PREFETCH_2D_MINIMUM_BYTES, which the `MUFFT_PREFETCH_BYTES` environment variable overrides.
+static void set_plan_prefetch_2d(struct mufft_step_2d *steps, unsigned num_steps, size_t bytes)
+{
+    if (bytes < env_size_override("MUFFT_PREFETCH_BYTES", MUFFT_PREFETCH_2D_MINIMUM_BYTES))
     {
-        goto error;
+        return;
     }
 
-    if ((flags & MUFFT_FLAG_FULL_R2C) == 0)
+    for (unsigned i = 0; i < num_steps; i++)
     {
-        flags |= MUFFT_FLAG_R2C;
+        for (unsigned j = 0; j < ARRAY_SIZE(fft_2d_prefetch_table); j++)
+        {
+            if (fft_2d_prefetch_table[j].func == steps[i].func)
+            {
+                steps[i].func = fft_2d_prefetch_table[j].prefetch_func;
+                break;
+            }
+        }
     }
+}
 
-    plan->r2c_resolve = find_r2c_resolve_func(flags, N);
-    if (plan->r2c_resolve == NULL)
+/// \brief Folds a normalization factor into one of the first num_steps steps of a horizontal transform.
+/// The FFT is linear, so scaling the input of any step scales the output just the same.
+/// The first step never has a scaling variant, so tiny transforms are scaled in a separate pass instead.
+static void set_plan_scale(struct mufft_scale_step *scale, const struct mufft_step_1d *steps, unsigned num_steps,
+        float factor)
+{
+    *scale = (struct mufft_scale_step) { .scale = factor };
+    if (factor == 1.0f)
     {
-        goto error;
+        return;
     }
 
-    return plan;
+    // Any step after the first will do, so just take the last one which has a scaling variant.
+    for (unsigned i = num_steps; i-- > 1; )
+    {
+        for (unsigned j = 0; j < ARRAY_SIZE(fft_1d_scale_table); j++)
+        {
+            if (fft_1d_scale_table[j].func == steps[i].func)
+            {
+                scale->func = fft_1d_scale_table[j].scale_func;
+                scale->index = i;
+                return;
+            }
+        }
+    }
+}
 
-error:
-    mufft_free_plan_1d(plan);
-    return NULL;
+/// \brief Rounds a size up to a multiple of \ref MUFFT_ALIGNMENT.
+static size_t align_size(size_t size)
+{
+    return (size + MUFFT_ALIGNMENT - 1) & ~(size_t)(MUFFT_ALIGNMENT - 1);
 }
 
-mufft_plan_1d *mufft_create_plan_1d_c2r(unsigned N, unsigned flags)
+/// Header in front of every block from \ref alloc_plan_arena.
+struct mufft_plan_arena_header
 {
-    if ((N & (N - 1)) != 0 || N == 1)
+    mufft_allocator allocator; ///< The allocator the block came from.
+    unsigned flags; ///< Plan flags the block was allocated with.
+    unsigned node; ///< NUMA node the block is bound to, or \ref MUFFT_NUMA_NODE_ANY. See \ref MUFFT_FLAG_NUMA_LOCAL.
+    size_t size; ///< Size of the block, including this header.
+    size_t storage_size; ///< Size of the storage the block was allocated in, see \ref alloc_storage.
+    struct mufft_plan_cache_entry *cache_entry; ///< If the plan is owned by a \ref mufft_plan_cache, its entry there.
+};
+
+/// \brief Allocates a plan as a single block bound to node, see \ref alloc_plan_arena.
+static void *alloc_plan_arena_on_node(const mufft_allocator *allocator, unsigned flags, unsigned node,
+        size_t plan_size, size_t scratch_size)
+{
+    if (allocator == NULL)
     {
-        return NULL;
+        allocator = &global_allocator;
     }
 
-    unsigned complex_n = N / 2;
-
-    mufft_plan_1d *plan = mufft_create_plan_1d_c2c(complex_n, MUFFT_INVERSE, flags);
-    if (plan == NULL)
+    size_t header_size = align_size(sizeof(struct mufft_plan_arena_header));
+    size_t block_size = header_size + align_size(plan_size) + scratch_size;
+    size_t storage_size = block_size;
+    char *block = alloc_storage(allocator, &storage_size, (flags & MUFFT_FLAG_HUGE_PAGES) != 0, node);
+    if (block == NULL)
     {
-        goto error;
+        return NULL;
     }
 
-    plan->r2c_twiddles = build_r2c_twiddles(MUFFT_INVERSE, complex_n);
-    if (plan->r2c_twiddles == NULL)
+    struct mufft_plan_arena_header *header = (struct mufft_plan_arena_header*)block;
+    header->allocator = *allocator;
+    header->flags = flags;
+    header->node = node;
+    header->size = block_size;
+    header->storage_size = storage_size;
+    header->cache_entry = NULL;
+    if (node != MUFFT_NUMA_NODE_ANY)
     {
-        goto error;
+        memset(block + header_size, 0, block_size - header_size);
     }
-
-    plan->c2r_resolve = find_r2c_resolve_func(flags | MUFFT_FLAG_C2R, N);
-    if (plan->c2r_resolve == NULL)
+    else
     {
-        goto error;
+        memset(block + header_size, 0, plan_size);
     }
+    return block + header_size;
+}
 
-    return plan;
-
-error:
-    mufft_free_plan_1d(plan);
-    return NULL;
+/// \brief Allocates a plan as a single block.
+/// The block starts with a copy of the allocator, so the plan is freed the same way even if the global allocator changes.
+/// The plan struct, with its steps stored inline, comes next and is cleared.
+/// It is followed by scratch_size bytes of scratch buffer, which starts on its own cache line
+/// and is returned by \ref plan_arena_scratch.
+/// Twiddle factors are shared between plans, see \ref acquire_twiddles, so they are not part of the block.
+/// @param allocator The allocator to use. If `NULL`, the global allocator is used.
+/// @param flags Plan flags. With \ref MUFFT_FLAG_HUGE_PAGES, large blocks are backed by huge pages, see \ref alloc_storage.
+/// With \ref MUFFT_FLAG_NUMA_LOCAL, the block is bound to the NUMA node of the calling thread,
+/// and the whole block is cleared, so that every page is faulted in there right away.
+static void *alloc_plan_arena(const mufft_allocator *allocator, unsigned flags, size_t plan_size, size_t scratch_size)
+{
+    unsigned node = (flags & MUFFT_FLAG_NUMA_LOCAL) != 0 ? current_numa_node() : MUFFT_NUMA_NODE_ANY;
+    return alloc_plan_arena_on_node(allocator, flags, node, plan_size, scratch_size);
 }
 
-mufft_convolve_func mufft_get_convolve_func(unsigned flags)
+/// \brief Gets the header of a block from \ref alloc_plan_arena.
+static struct mufft_plan_arena_header *plan_arena_header(void *plan)
 {
-    unsigned convolve_flags = mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
+    return (struct mufft_plan_arena_header*)((char*)plan - align_size(sizeof(struct mufft_plan_arena_header)));
+}
 
-    for (unsigned i = 0; i < ARRAY_SIZE(convolve_table); i++)
+/// \brief Frees a block from \ref alloc_plan_arena. Twiddle factors must be released separately.
+static void free_plan_arena(void *plan)
+{
+    if (plan == NULL)
     {
-        const struct fft_convolve_step *step = &convolve_table[i];
-        if ((step->flags & convolve_flags) == step->flags)
-        {
-            return step->func;
-        }
+        return;
     }
 
-    return NULL;
+    struct mufft_plan_arena_header *header = plan_arena_header(plan);
+    mufft_allocator allocator = header->allocator;
+    free_storage(&allocator, header, header->storage_size, header->node);
 }
 
-mufft_plan_conv *mufft_create_plan_conv(unsigned N, unsigned flags, unsigned method)
+/// \brief Gets the NUMA node a block from \ref alloc_plan_arena is bound to, or -1 if it is not bound.
+/// The first and last page of the block are checked with get_mempolicy(), so -1 is also returned
+/// if the block did not end up on its node, or if placement cannot be queried.
+static int plan_arena_numa_node(const void *plan)
 {
-    if ((N & (N - 1)) != 0 || N == 1)
+    const struct mufft_plan_arena_header *header = plan_arena_header((void*)plan);
+    if (header->node == MUFFT_NUMA_NODE_ANY)
     {
-        return NULL;
+        return -1;
     }
 
-    mufft_plan_conv *conv = mufft_calloc(sizeof(*conv));
-    if (conv == NULL)
-    {
-        goto error;
-    }
+    int node = (int)header->node;
+    bool placed = numa_node_of(header) == node && numa_node_of((const char*)header + header->size - 1) == node;
+    return placed ? node : -1;
+}
 
-    unsigned first_extra_flag = (method & MUFFT_CONV_METHOD_FLAG_ZERO_PAD_UPPER_HALF_FIRST) != 0 ?
-        MUFFT_FLAG_ZERO_PAD_UPPER_HALF : 0;
-    unsigned second_extra_flag = (method & MUFFT_CONV_METHOD_FLAG_ZERO_PAD_UPPER_HALF_SECOND) != 0 ?
-        MUFFT_FLAG_ZERO_PAD_UPPER_HALF : 0;
+/// \brief Checks that a twiddle factor table of a plan is placed on node. Plans without the table pass.
+static bool twiddles_on_numa_node(const cfloat *twiddles, int node)
+{
+    return twiddles == NULL || numa_node_of(twiddles) == node;
+}
 
-    switch (method & 1)
-    {
-        case MUFFT_CONV_METHOD_FLAG_MONO_MONO:
-            conv->block_size = (N / 2 + MUFFT_PADDING_COMPLEX_SAMPLES) * sizeof(cfloat);
-            conv->plans[0] = mufft_create_plan_1d_r2c(N, flags | first_extra_flag);
-            conv->plans[1] = mufft_create_plan_1d_r2c(N, flags | second_extra_flag);
-            conv->output_plan = mufft_create_plan_1d_c2r(N, flags);
-            conv->conv_multiply_n = N / 2 + 1;
-            break;
+/// \brief Gets the scratch buffer of a block from \ref alloc_plan_arena.
+static void *plan_arena_scratch(void *plan, size_t plan_size)
+{
+    return (char*)plan + align_size(plan_size);
+}
 
-        case MUFFT_CONV_METHOD_FLAG_STEREO_MONO:
-            conv->block_size = N * sizeof(cfloat);
-            conv->plans[0] = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, flags | first_extra_flag);
-            conv->plans[1] = mufft_create_plan_1d_r2c(N, flags | second_extra_flag | MUFFT_FLAG_FULL_R2C);
-            conv->output_plan = mufft_create_plan_1d_c2c(N, MUFFT_INVERSE, flags);
-            conv->conv_multiply_n = N;
-            break;
+/// \brief Moves a plan into a new block with scratch_size bytes of scratch buffer.
+/// Only used when a plan variant needs more scratch than the plan it is built from.
+/// The caller must point the plan at the new scratch buffer. On failure, the old plan is left untouched.
+static void *resize_plan_arena(void *plan, size_t plan_size, size_t scratch_size)
+{
+    const struct mufft_plan_arena_header *header = plan_arena_header(plan);
+    void *new_plan = alloc_plan_arena_on_node(&header->allocator, header->flags, header->node, plan_size, scratch_size);
+    if (new_plan == NULL)
+    {
+        return NULL;
     }
 
-    conv->normalization = 1.0f / N;
-    conv->conv_block = mufft_calloc(conv->block_size);
+    memcpy(new_plan, plan, plan_size);
+    free_plan_arena(plan);
+    return new_plan;
+}
 
-    if (conv->plans[0] == NULL ||
-            conv->plans[1] == NULL ||
-            conv->conv_block == NULL ||
-            conv->output_plan == NULL)
+/// \brief Gives a 1D plan a scratch buffer of at least the given number of samples.
+static mufft_plan_1d *resize_plan_1d_scratch(mufft_plan_1d *plan, size_t samples)
+{
+    mufft_plan_1d *new_plan = resize_plan_arena(plan, sizeof(*plan), samples * sizeof(cfloat));
+    if (new_plan != NULL)
     {
-        goto error;
+        new_plan->tmp_buffer = plan_arena_scratch(new_plan, sizeof(*new_plan));
     }
+    return new_plan;
+}
 
-    conv->convolve_func = mufft_get_convolve_func(flags);
-    if (conv->convolve_func == NULL)
+// The real-to-complex transform is implemented with a N / 2 complex transform with a
+// final butterfly which extracts real/imag parts of the complex transform.
+// See http://www.engineeringproductivitytools.com/stuff/T0001/PT10.HTM for details on algorithm.
+
+static cfloat *build_r2c_twiddles(const mufft_allocator *allocator, int direction, unsigned N, bool huge, unsigned node,
+        size_t *size)
+{
+    *size = N * sizeof(cfloat);
+    cfloat *twiddles = alloc_storage(allocator, size, huge, node);
+    if (twiddles == NULL)
     {
-        goto error;
+        return NULL;
     }
 
-    return conv;
+    fill_r2c_twiddles(twiddles, direction, N);
 
-error:
-    mufft_free_plan_conv(conv);
-    return NULL;
+    return twiddles;
 }
 
-mufft_plan_1d *mufft_create_plan_1d_c2c(unsigned N, int direction, unsigned flags)
+#ifdef MUFFT_HAVE_STATIC_TWIDDLES
+/// Represents a twiddle factor table which was generated at build time by twiddle_gen.c.
+struct mufft_static_twiddle_table
 {
-    if ((N & (N - 1)) != 0 || N == 1)
-    {
-        return NULL;
-    }
+    const cfloat *twiddles; ///< The twiddle factors.
+    unsigned N; ///< Transform size the table was built for.
+    int direction; ///< Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+    bool r2c; ///< If true, the table is from \ref fill_r2c_twiddles, otherwise from \ref fill_twiddles.
+};
 
-    mufft_plan_1d *plan = mufft_calloc(sizeof(*plan));
-    if (plan == NULL)
-    {
-        goto error;
-    }
+#if defined(_MSC_VER)
+/// Aligns the static tables like \ref mufft_alloc would.
+#define MUFFT_STATIC_ALIGN __declspec(align(MUFFT_ALIGNMENT))
+#else
+/// Aligns the static tables like \ref mufft_alloc would.
+#define MUFFT_STATIC_ALIGN __attribute__((aligned(MUFFT_ALIGNMENT)))
+#endif
 
-    plan->twiddles = build_twiddles(N, direction);
-    if (plan->twiddles == NULL)
-    {
-        goto error;
-    }
+#include "twiddles_static.h"
 
-    plan->tmp_buffer = mufft_alloc(N * sizeof(cfloat));
-    if (plan->tmp_buffer == NULL)
+/// \brief Finds a twiddle factor table in read-only data, following the same matching rules as \ref acquire_twiddles.
+static const cfloat *find_static_twiddles(unsigned N, int direction, bool r2c)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(static_twiddle_tables); i++)
     {
-        goto error;
+        const struct mufft_static_twiddle_table *table = &static_twiddle_tables[i];
+        if (table->direction == direction && table->r2c == r2c &&
+                (r2c ? table->N == N : table->N >= N))
+        {
+            return table->twiddles;
+        }
     }
+    return NULL;
+}
 
-    if (!build_plan_1d(&plan->steps, &plan->num_steps, N, direction, flags))
+/// \brief Checks if twiddle factors came from \ref find_static_twiddles.
+static bool is_static_twiddles(const cfloat *twiddles)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(static_twiddle_tables); i++)
     {
-        goto error;
+        if (static_twiddle_tables[i].twiddles == twiddles)
+        {
+            return true;
+        }
     }
+    return false;
+}
+#endif
 
-    plan->N = N;
-    return plan;
+/// Represents a twiddle factor table which is shared between all plans which need it.
+struct mufft_twiddle_table
+{
+    struct mufft_twiddle_table *next; ///< Next table in the cache.
+    mufft_allocator allocator; ///< The global allocator when the table was built. Backs the table and this record.
+    cfloat *twiddles; ///< The twiddle factors.
+    size_t size; ///< Size of the storage of mufft_twiddle_table::twiddles, see \ref alloc_storage.
+    unsigned N; ///< Transform size the table was built for.
+    int direction; ///< Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+    bool r2c; ///< If true, the table is from \ref build_r2c_twiddles, otherwise from \ref build_twiddles.
+    bool compact; ///< If true, the table is from \ref build_compact_twiddles.
+    unsigned node; ///< NUMA node the table is replicated for, or \ref MUFFT_NUMA_NODE_ANY.
+    unsigned refcount; ///< Number of plans holding on to the table.
+};
 
-error:
-    mufft_free_plan_1d(plan);
+/// Process-wide cache of twiddle factor tables.
+static struct mufft_twiddle_table *twiddle_cache;
+/// Lock for \ref twiddle_cache, as plans might be created and freed from multiple threads.
+static volatile long twiddle_cache_lock;
+
+/// \brief Finds a table in \ref twiddle_cache which serves a transform. The caller holds \ref twiddle_cache_lock.
+static struct mufft_twiddle_table *find_twiddle_table(unsigned N, int direction, bool r2c, bool compact, unsigned node)
+{
+    for (struct mufft_twiddle_table *table = twiddle_cache; table != NULL; table = table->next)
+    {
+        if (table->direction == direction && table->r2c == r2c && table->compact == compact && table->node == node &&
+                (r2c ? table->N == N : table->N >= N))
+        {
+            return table;
+        }
+    }
     return NULL;
 }
 
-mufft_plan_2d *mufft_create_plan_2d_c2c(unsigned Nx, unsigned Ny, int direction, unsigned flags)
+/// \brief Frees a twiddle factor table and its record with the allocator they came from.
+static void free_twiddle_table(struct mufft_twiddle_table *table)
 {
-    if ((Nx & (Nx - 1)) != 0 || (Ny & (Ny - 1)) != 0 || Nx == 1 || Ny == 1)
+    const mufft_allocator allocator = table->allocator;
+    free_storage(&allocator, table->twiddles, table->size, table->node);
+    free_record(&allocator, table);
+}
+
+/// \brief Gets a twiddle factor table from the cache, building it if needed. Release with \ref release_twiddles.
+///
+/// Every level of a table from \ref build_twiddles only depends on its butterfly stride,
+/// so a table for a larger transform also serves any smaller transform.
+/// The same holds for compact tables from \ref build_compact_twiddles.
+/// R2C twiddle factors depend on the transform size, and are only shared between plans of the same size.
+/// Tables generated at build time with MUFFT_STATIC_TWIDDLES are used without touching the heap.
+///
+/// Tables are built without holding \ref twiddle_cache_lock, so threads creating plans of other sizes are not held up.
+/// If another thread inserted a suitable table in the meantime, that one is used and ours is thrown away.
+///
+/// Tables come from the global allocator, which is copied into the table and used to free it again,
+/// so the global allocator can change while plans still hold on to tables.
+///
+/// With \ref MUFFT_FLAG_HUGE_PAGES in flags, a newly built table is backed by huge pages, see \ref alloc_storage.
+/// A table already in the cache is shared as it is.
+/// With \ref MUFFT_FLAG_NUMA_LOCAL, plans only share tables with other such plans created on the same NUMA node,
+/// and static tables are not used. The table is built by the calling thread, so its pages are placed on that node.
+static const cfloat *acquire_twiddles(unsigned N, int direction, bool r2c, bool compact, unsigned flags)
+{
+    bool huge = (flags & MUFFT_FLAG_HUGE_PAGES) != 0;
+    unsigned node = (flags & MUFFT_FLAG_NUMA_LOCAL) != 0 ? current_numa_node() : MUFFT_NUMA_NODE_ANY;
+
+#ifdef MUFFT_HAVE_STATIC_TWIDDLES
+    const cfloat *static_twiddles = compact || node != MUFFT_NUMA_NODE_ANY ?
+        NULL : find_static_twiddles(N, direction, r2c);
+    if (static_twiddles != NULL)
     {
-        return NULL;
+        return static_twiddles;
     }
+#endif
 
-    mufft_plan_2d *plan = mufft_calloc(sizeof(*plan));
-    if (plan == NULL)
+    spin_lock(&twiddle_cache_lock);
+    struct mufft_twiddle_table *table = find_twiddle_table(N, direction, r2c, compact, node);
+    if (table != NULL)
     {
-        goto error;
+        table->refcount++;
+        spin_unlock(&twiddle_cache_lock);
+        return table->twiddles;
     }
+    spin_unlock(&twiddle_cache_lock);
 
-    plan->twiddles_x = build_twiddles(Nx, direction);
-    plan->twiddles_y = build_twiddles(Ny, direction);
-    if (plan->twiddles_x == NULL || plan->twiddles_y == NULL)
+    const mufft_allocator allocator = global_allocator;
+    struct mufft_twiddle_table *new_table = alloc_record(&allocator, sizeof(*new_table));
+    if (new_table == NULL)
     {
-        goto error;
+        return NULL;
     }
+    new_table->allocator = allocator;
 
-    if ((flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R)) != 0)
+    if (r2c)
     {
-        plan->tmp_buffer = mufft_alloc(2 * Nx * Ny * sizeof(cfloat));
+        new_table->twiddles = build_r2c_twiddles(&allocator, direction, N, huge, node, &new_table->size);
     }
     else
     {
-        plan->tmp_buffer = mufft_alloc(Nx * Ny * sizeof(cfloat));
+        new_table->twiddles = compact ? build_compact_twiddles(&allocator, N, direction, huge, node, &new_table->size) :
+            build_twiddles(&allocator, N, direction, huge, node, &new_table->size);
     }
 
-    if (plan->tmp_buffer == NULL)
+    if (new_table->twiddles == NULL)
     {
-        goto error;
+        free_record(&allocator, new_table);
+        return NULL;
     }
 
-    if (!build_plan_1d(&plan->steps_x, &plan->num_steps_x, Nx, direction, flags))
-    {
-        goto error;
-    }
+    new_table->N = N;
+    new_table->direction = direction;
+    new_table->r2c = r2c;
+    new_table->compact = compact;
+    new_table->node = node;
+    new_table->refcount = 1;
 
-    if (!build_plan_2d(&plan->steps_y, &plan->num_steps_y, Nx, Ny, direction, flags))
+    spin_lock(&twiddle_cache_lock);
+    table = find_twiddle_table(N, direction, r2c, compact, node);
+    if (table != NULL)
     {
-        goto error;
+        // Lost the race against another thread building the same table.
+        table->refcount++;
+        spin_unlock(&twiddle_cache_lock);
+        free_twiddle_table(new_table);
+        return table->twiddles;
     }
 
-    plan->Nx = Nx;
-    plan->Ny = Ny;
-    plan->vertical_nx = Nx;
-    return plan;
-
-error:
-    mufft_free_plan_2d(plan);
-    return NULL;
+    new_table->next = twiddle_cache;
+    twiddle_cache = new_table;
+    spin_unlock(&twiddle_cache_lock);
+    return new_table->twiddles;
 }
 
-mufft_plan_2d *mufft_create_plan_2d_r2c(unsigned Nx, unsigned Ny, unsigned flags)
+/// \brief Releases a table from \ref acquire_twiddles. The table is freed once no plan uses it anymore.
+static void release_twiddles(const cfloat *twiddles)
 {
-    if ((Nx & (Nx - 1)) != 0 || (Ny & (Ny - 1)) != 0 || Nx == 1 || Ny == 1)
+    if (twiddles == NULL)
     {
-        return NULL;
+        return;
     }
 
-    unsigned complex_n = Nx / 2;
-    mufft_plan_2d *plan = mufft_create_plan_2d_c2c(complex_n, Ny, MUFFT_FORWARD, flags | MUFFT_FLAG_R2C);
-    if (plan == NULL)
+#ifdef MUFFT_HAVE_STATIC_TWIDDLES
+    if (is_static_twiddles(twiddles))
     {
-        goto error;
+        return;
     }
+#endif
 
-    plan->r2c_twiddles = build_r2c_twiddles(MUFFT_FORWARD, complex_n);
-    if (plan->r2c_twiddles == NULL)
-    {
-        goto error;
-    }
+    struct mufft_twiddle_table *unused = NULL;
+    spin_lock(&twiddle_cache_lock);
 
-    if ((flags & MUFFT_FLAG_FULL_R2C) == 0)
+    for (struct mufft_twiddle_table **table = &twiddle_cache; *table != NULL; table = &(*table)->next)
     {
-        flags |= MUFFT_FLAG_R2C;
-        plan->vertical_nx = Nx / 2 + 1;
-    }
-    else
-    {
-        plan->vertical_nx = Nx;
+        struct mufft_twiddle_table *current = *table;
+        if (current->twiddles == twiddles)
+        {
+            if (--current->refcount == 0)
+            {
+                *table = current->next;
+                unused = current;
+            }
+            break;
+        }
     }
 
-    plan->r2c_resolve = find_r2c_resolve_func(flags, Nx);
-    if (plan->r2c_resolve == NULL)
+    spin_unlock(&twiddle_cache_lock);
+
+    // Free outside the lock, unmapping huge pages can take a while.
+    if (unused != NULL)
     {
-        goto error;
+        free_twiddle_table(unused);
     }
-
-    return plan;
-
-error:
-    mufft_free_plan_2d(plan);
-    return NULL;
 }
 
-mufft_plan_2d *mufft_create_plan_2d_c2r(unsigned Nx, unsigned Ny, unsigned flags)
+static mufft_r2c_resolve_func find_r2c_resolve_func(unsigned flags, unsigned N)
 {
-    if ((Nx & (Nx - 1)) != 0 || (Ny & (Ny - 1)) != 0 || Nx == 1 || Ny == 1)
+    // Add CPU flags. Just accept any CPU for now, but mask out flags we don't want.
+    unsigned resolve_flags = mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
+    resolve_flags |= flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R | MUFFT_FLAG_FULL_R2C);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(fft_r2c_resolve_table); i++)
+    {
+        const struct fft_r2c_resolve_step *step = &fft_r2c_resolve_table[i];
+        if ((step->flags & resolve_flags) == step->flags &&
+                N >= step->minimum_elements)
+        {
+            return step->func;
+        }
+    }
+
+    return NULL;
+}
+
+/// \brief Finds a step which does the work of step and a C2R-R2C resolve in one pass.
+static mufft_resolve_step_func find_resolve_step_func(unsigned flags, const struct mufft_step_1d *step, unsigned N)
+{
+    // Add CPU flags. Just accept any CPU for now, but mask out flags we don't want.
+    unsigned resolve_flags = mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
+    resolve_flags |= flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R | MUFFT_FLAG_FULL_R2C);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(fft_resolve_step_table); i++)
+    {
+        const struct fft_resolve_step *resolve_step = &fft_resolve_step_table[i];
+        if ((resolve_step->flags & resolve_flags) == resolve_step->flags &&
+                resolve_step->radix == step->radix &&
+                N >= resolve_step->minimum_elements &&
+                step->p >= resolve_step->minimum_p)
+        {
+            return resolve_step->func;
+        }
+    }
+
+    return NULL;
+}
+
+/// \brief Gets the number of input samples which can be non-zero with \ref MUFFT_FLAG_ZERO_PAD_UPPER_HALF.
+static unsigned default_input_length(unsigned N, unsigned flags)
+{
+    return (flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF) != 0 ? N / 2 : N;
+}
+
+static mufft_plan_1d *create_plan_1d_c2c(unsigned N, int direction, unsigned flags, unsigned input_length,
+        const mufft_allocator *allocator);
+static mufft_plan_1d *create_plan_1d_r2c(unsigned N, unsigned flags, unsigned input_length,
+        const mufft_allocator *allocator);
+
+mufft_plan_1d *mufft_create_plan_1d_r2c(unsigned N, unsigned flags)
+{
+    return mufft_create_plan_1d_r2c_with_allocator(N, flags, NULL);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_r2c_zero_pad(unsigned N, unsigned flags, unsigned input_length)
+{
+    return create_plan_1d_r2c(N, flags, input_length, NULL);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_r2c_zero_pad_with_allocator(unsigned N, unsigned flags, unsigned input_length,
+        const mufft_allocator *allocator)
+{
+    return create_plan_1d_r2c(N, flags, input_length, allocator);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_r2c_with_allocator(unsigned N, unsigned flags, const mufft_allocator *allocator)
+{
+    return create_plan_1d_r2c(N, flags, default_input_length(N, flags), allocator);
+}
+
+static mufft_plan_1d *create_plan_1d_r2c(unsigned N, unsigned flags, unsigned input_length,
+        const mufft_allocator *allocator)
+{
+    if ((N & (N - 1)) != 0 || N == 1 || input_length == 0 || input_length > N)
+    {
+        return NULL;
+    }
+
+    unsigned complex_n = N / 2;
+
+    mufft_plan_1d *plan = create_plan_1d_c2c(complex_n, MUFFT_FORWARD, flags | MUFFT_FLAG_R2C, (input_length + 1) / 2,
+            allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    // Real samples are packed two by two, so the length of the non-zero region is counted in floats directly.
+    plan->input_size = input_length;
+
+    plan->r2c_twiddles = acquire_twiddles(complex_n, MUFFT_FORWARD, true, false, flags);
+    if (plan->r2c_twiddles == NULL)
+    {
+        goto error;
+    }
+
+    if ((flags & MUFFT_FLAG_FULL_R2C) == 0)
+    {
+        flags |= MUFFT_FLAG_R2C;
+    }
+
+    // A single step plan might start with a broadcast step, which cannot be fused with the resolve.
+    // The fused steps have no variant for compact twiddle factors either.
+    const struct mufft_step_1d *last_step = &plan->steps[plan->num_steps - 1];
+    if (plan->num_steps > 1 &&
+            !step_uses_compact_twiddles((flags & MUFFT_FLAG_COMPACT_TWIDDLES) != 0, last_step->p, last_step->radix))
+    {
+        plan->r2c_last_step = find_resolve_step_func(flags, &plan->steps[plan->num_steps - 1], complex_n);
+    }
+
+    if (plan->r2c_last_step == NULL)
+    {
+        plan->r2c_resolve = find_r2c_resolve_func(flags, N);
+        if (plan->r2c_resolve == NULL)
+        {
+            goto error;
+        }
+    }
+
+    // The fused last step cannot scale, so only the steps before it are candidates.
+    set_plan_scale(&plan->scale, plan->steps, plan->num_steps - (plan->r2c_last_step != NULL),
+            normalization_scale(flags, N));
+    plan->output_size = (flags & MUFFT_FLAG_FULL_R2C) != 0 ? 2 * N : N + 2;
+    return plan;
+
+error:
+    mufft_free_plan_1d(plan);
+    return NULL;
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2r(unsigned N, unsigned flags)
+{
+    return mufft_create_plan_1d_c2r_with_allocator(N, flags, NULL);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2r_with_allocator(unsigned N, unsigned flags, const mufft_allocator *allocator)
+{
+    if ((N & (N - 1)) != 0 || N == 1)
+    {
+        return NULL;
+    }
+
+    unsigned complex_n = N / 2;
+
+    mufft_plan_1d *plan = create_plan_1d_c2c(complex_n, MUFFT_INVERSE, flags,
+            default_input_length(complex_n, flags), allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    // The input has one more complex sample than the transform, and in place execution might have to copy all of it to scratch.
+    plan->input_size = 2 * (complex_n + 1);
+    mufft_plan_1d *resized = resize_plan_1d_scratch(plan, complex_n + 1);
+    if (resized == NULL)
+    {
+        goto error;
+    }
+    plan = resized;
+
+    plan->r2c_twiddles = acquire_twiddles(complex_n, MUFFT_INVERSE, true, false, flags);
+    if (plan->r2c_twiddles == NULL)
+    {
+        goto error;
+    }
+
+    // Zero padded first steps only read part of the resolved input, so they keep the separate resolve pass.
+    if ((flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF) == 0)
+    {
+        plan->c2r_first_step = find_resolve_step_func(flags | MUFFT_FLAG_C2R, &plan->steps[0], complex_n);
+    }
+
+    if (plan->c2r_first_step == NULL)
+    {
+        plan->c2r_resolve = find_r2c_resolve_func(flags | MUFFT_FLAG_C2R, N);
+        if (plan->c2r_resolve == NULL)
+        {
+            goto error;
+        }
+    }
+
+    set_plan_scale(&plan->scale, plan->steps, plan->num_steps, normalization_scale(flags, N));
+    plan->output_size = N;
+    return plan;
+
+error:
+    mufft_free_plan_1d(plan);
+    return NULL;
+}
+
+/// \brief Finds a transpose routine which can transpose blocks of at least rows by columns samples.
+static mufft_transpose_func find_transpose_func(unsigned flags, unsigned rows, unsigned columns)
+{
+    unsigned transpose_flags = mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(transpose_table); i++)
+    {
+        const struct fft_transpose_step *step = &transpose_table[i];
+        if ((step->flags & transpose_flags) == step->flags &&
+                rows >= step->minimum_elements &&
+                columns >= step->minimum_elements)
+        {
+            return step->func;
+        }
+    }
+
+    return NULL;
+}
+
+mufft_convolve_func mufft_get_convolve_func(unsigned flags)
+{
+    unsigned convolve_flags = mufft_get_cpu_flags() & ~(MUFFT_FLAG_CPU_NO_SIMD & flags);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(convolve_table); i++)
+    {
+        const struct fft_convolve_step *step = &convolve_table[i];
+        if ((step->flags & convolve_flags) == step->flags)
+        {
+            return step->func;
+        }
+    }
+
+    return NULL;
+}
+
+mufft_plan_conv *mufft_create_plan_conv(unsigned N, unsigned flags, unsigned method)
+{
+    return mufft_create_plan_conv_with_allocator(N, flags, method, NULL);
+}
+
+mufft_plan_conv *mufft_create_plan_conv_with_allocator(unsigned N, unsigned flags, unsigned method,
+        const mufft_allocator *allocator)
+{
+    if ((N & (N - 1)) != 0 || N == 1)
+    {
+        return NULL;
+    }
+
+    // Convolution applies its own normalization when multiplying the two spectra.
+    flags &= ~(MUFFT_FLAG_NORMALIZE | MUFFT_FLAG_NORMALIZE_ORTHO);
+
+    size_t block_size = (method & 1) == MUFFT_CONV_METHOD_FLAG_MONO_MONO ?
+        (N / 2 + MUFFT_PADDING_COMPLEX_SAMPLES) * sizeof(cfloat) : N * sizeof(cfloat);
+
+    mufft_plan_conv *conv = alloc_plan_arena(allocator, flags, sizeof(*conv), block_size);
+    if (conv == NULL)
+    {
+        goto error;
+    }
+    conv->block_size = block_size;
+    conv->conv_block = plan_arena_scratch(conv, sizeof(*conv));
+    memset(conv->conv_block, 0, block_size);
+
+    unsigned first_extra_flag = (method & MUFFT_CONV_METHOD_FLAG_ZERO_PAD_UPPER_HALF_FIRST) != 0 ?
+        MUFFT_FLAG_ZERO_PAD_UPPER_HALF : 0;
+    unsigned second_extra_flag = (method & MUFFT_CONV_METHOD_FLAG_ZERO_PAD_UPPER_HALF_SECOND) != 0 ?
+        MUFFT_FLAG_ZERO_PAD_UPPER_HALF : 0;
+
+    switch (method & 1)
+    {
+        case MUFFT_CONV_METHOD_FLAG_MONO_MONO:
+            conv->plans[0] = mufft_create_plan_1d_r2c_with_allocator(N, flags | first_extra_flag, allocator);
+            conv->plans[1] = mufft_create_plan_1d_r2c_with_allocator(N, flags | second_extra_flag, allocator);
+            conv->output_plan = mufft_create_plan_1d_c2r_with_allocator(N, flags, allocator);
+            conv->conv_multiply_n = N / 2 + 1;
+            break;
+
+        case MUFFT_CONV_METHOD_FLAG_STEREO_MONO:
+            conv->plans[0] = mufft_create_plan_1d_c2c_with_allocator(N, MUFFT_FORWARD, flags | first_extra_flag, allocator);
+            conv->plans[1] = mufft_create_plan_1d_r2c_with_allocator(N, flags | second_extra_flag | MUFFT_FLAG_FULL_R2C,
+                    allocator);
+            conv->output_plan = mufft_create_plan_1d_c2c_with_allocator(N, MUFFT_INVERSE, flags, allocator);
+            conv->conv_multiply_n = N;
+            break;
+    }
+
+    conv->normalization = 1.0f / N;
+
+    if (conv->plans[0] == NULL ||
+            conv->plans[1] == NULL ||
+            conv->output_plan == NULL)
+    {
+        goto error;
+    }
+
+    conv->convolve_func = mufft_get_convolve_func(flags);
+    if (conv->convolve_func == NULL)
+    {
+        goto error;
+    }
+
+    return conv;
+
+error:
+    mufft_free_plan_conv(conv);
+    return NULL;
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2c(unsigned N, int direction, unsigned flags)
+{
+    return mufft_create_plan_1d_c2c_with_allocator(N, direction, flags, NULL);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2c_zero_pad(unsigned N, int direction, unsigned flags, unsigned input_length)
+{
+    return create_plan_1d_c2c(N, direction, flags, input_length, NULL);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2c_zero_pad_with_allocator(unsigned N, int direction, unsigned flags,
+        unsigned input_length, const mufft_allocator *allocator)
+{
+    return create_plan_1d_c2c(N, direction, flags, input_length, allocator);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2c_with_allocator(unsigned N, int direction, unsigned flags,
+        const mufft_allocator *allocator)
+{
+    return create_plan_1d_c2c(N, direction, flags, default_input_length(N, flags), allocator);
+}
+
+static mufft_plan_1d *create_plan_1d_c2c(unsigned N, int direction, unsigned flags, unsigned input_length,
+        const mufft_allocator *allocator)
+{
+    if ((N & (N - 1)) != 0 || N == 1 || input_length == 0 || input_length > N)
+    {
+        return NULL;
+    }
+
+    if ((flags & MUFFT_FLAG_NORMALIZE) != 0 && (flags & MUFFT_FLAG_NORMALIZE_ORTHO) != 0)
+    {
+        return NULL;
+    }
+
+    // Round the non-zero region up to a power of two.
+    // Everything beyond it is known to be zero, and the first log2(N / padded_length) passes can be skipped.
+    unsigned padded_length = 2;
+    while (padded_length < input_length)
+    {
+        padded_length <<= 1;
+    }
+    unsigned first_p = N / padded_length;
+
+    // For the upper half case we have dedicated first pass kernels.
+    flags &= ~MUFFT_FLAG_ZERO_PAD_UPPER_HALF;
+    if (first_p == 2)
+    {
+        flags |= MUFFT_FLAG_ZERO_PAD_UPPER_HALF;
+        first_p = 1;
+    }
+
+    mufft_plan_1d *plan = alloc_plan_arena(allocator, flags, sizeof(*plan), N * sizeof(cfloat));
+    if (plan == NULL)
+    {
+        goto error;
+    }
+    plan->tmp_buffer = plan_arena_scratch(plan, sizeof(*plan));
+
+    // Without any compact level, a compact table is laid out just like a regular one, so share the regular one.
+    if (N / 2 < MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL)
+    {
+        flags &= ~MUFFT_FLAG_COMPACT_TWIDDLES;
+    }
+
+    plan->twiddles = acquire_twiddles(N, direction, false, (flags & MUFFT_FLAG_COMPACT_TWIDDLES) != 0, flags);
+    if (plan->twiddles == NULL)
+    {
+        goto error;
+    }
+
+    if (!build_plan_1d(plan->steps, &plan->num_steps, N, direction, flags, first_p))
+    {
+        goto error;
+    }
+
+    plan->N = N;
+    plan->input_size = 2 * input_length;
+    plan->padded_input_size = 2 * padded_length;
+    plan->output_size = 2 * N;
+
+    // R2C plans finish with a resolve pass, or fuse it into the last step, so their last step does not write the output.
+    if ((flags & MUFFT_FLAG_R2C) == 0)
+    {
+        set_plan_streaming(plan->steps, plan->num_steps, N);
+    }
+
+    set_plan_scale(&plan->scale, plan->steps, plan->num_steps, normalization_scale(flags, N));
+    return plan;
+
+error:
+    mufft_free_plan_1d(plan);
+    return NULL;
+}
+
+/// Relative cost of a complex multiply-add in \ref mufft_partial_dft_c compared to moving one element through a vectorized FFT step.
+#define MUFFT_PARTIAL_DFT_COST 4
+
+/// \brief Finds how many FFT steps an output pruned plan should run before finishing with a partial DFT.
+///
+/// Every FFT step is a full pass over the data, while finishing after p = product of radices
+/// costs num_bins * N / p multiply-adds. With few bins, the last passes are not worth it.
+static unsigned find_pruned_num_steps(const struct mufft_step_1d *steps, unsigned num_steps,
+        unsigned N, unsigned num_bins, unsigned min_steps)
+{
+    unsigned best_steps = num_steps;
+    uint64_t best_cost = UINT64_MAX;
+
+    for (unsigned i = min_steps; i <= num_steps; i++)
+    {
+        unsigned p = i ? steps[i - 1].p * steps[i - 1].radix : 1;
+        uint64_t cost = (uint64_t)i * N + (uint64_t)MUFFT_PARTIAL_DFT_COST * num_bins * (N / p);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_steps = i;
+        }
+    }
+
+    return best_steps;
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2c_pruned(unsigned N, int direction, unsigned flags,
+        unsigned first_bin, unsigned num_bins)
+{
+    return mufft_create_plan_1d_c2c_pruned_with_allocator(N, direction, flags, first_bin, num_bins, NULL);
+}
+
+mufft_plan_1d *mufft_create_plan_1d_c2c_pruned_with_allocator(unsigned N, int direction, unsigned flags,
+        unsigned first_bin, unsigned num_bins, const mufft_allocator *allocator)
+{
+    if (first_bin >= N || num_bins == 0 || num_bins > N)
+    {
+        return NULL;
+    }
+
+    // The partial DFT reads the last level of the twiddle factor table directly.
+    flags &= ~MUFFT_FLAG_COMPACT_TWIDDLES;
+
+    mufft_plan_1d *plan = mufft_create_plan_1d_c2c_with_allocator(N, direction, flags, allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    // The partial DFT reads all of its input, so with zero padding the first step must run.
+    unsigned min_steps = (flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF) != 0 ? 1 : 0;
+    plan->num_steps = find_pruned_num_steps(plan->steps, plan->num_steps, N, num_bins, min_steps);
+    // The partial DFT reads the output of the last step right away.
+    clear_plan_streaming(plan->steps, plan->num_steps);
+
+    // Output only holds the requested bins, so it cannot be used as scratch for ping-ponging.
+    if (plan->num_steps >= 2)
+    {
+        mufft_plan_1d *resized = resize_plan_1d_scratch(plan, 2 * N);
+        if (resized == NULL)
+        {
+            goto error;
+        }
+        plan = resized;
+    }
+
+    plan->partial_dft = mufft_partial_dft_c;
+    plan->first_bin = first_bin;
+    plan->num_bins = num_bins;
+    plan->output_size = 2 * num_bins;
+    set_plan_scale(&plan->scale, plan->steps, plan->num_steps, normalization_scale(flags, N));
+    return plan;
+
+error:
+    mufft_free_plan_1d(plan);
+    return NULL;
+}
+
+/// Size of the cache we try to keep strided 2D and N-dimensional passes within if the L2 cache size of the host is unknown.
+#define MUFFT_AXIS_BLOCK_CACHE_SIZE (256 * 1024)
+
+/// \brief Gets the size of the cache strided 2D and N-dimensional passes try to stay within, which is the L2 cache of the host.
+static size_t axis_block_cache_size(void)
+{
+    mufft_cpu_info info;
+    mufft_get_cpu_info(&info);
+    return info.l2_cache_size != 0 ? info.l2_cache_size : MUFFT_AXIS_BLOCK_CACHE_SIZE;
+}
+
+/// \brief Finds how many columns a strided transform should process at a time.
+/// All passes over a block ping-pong between two buffers of N lines, so try to fit both in cache.
+static unsigned find_axis_block(unsigned width, unsigned N)
+{
+    size_t max_block = axis_block_cache_size() / (2 * N * sizeof(cfloat));
+
+    // Keep blocks a power-of-two of at least a cache line so every block stays aligned.
+    unsigned block = 8;
+    while (2 * block <= max_block)
+    {
+        block <<= 1;
+    }
+
+    return block >= width ? width : block;
+}
+
+/// Scratch buffers of a 2D real plan with \ref MUFFT_FLAG_COMPACT_R2C, see \ref get_compact_scratch.
+struct mufft_compact_scratch
+{
+    cfloat *image; ///< One image of padded rows, which the horizontal and vertical passes exchange data through.
+    unsigned image_stride; ///< Distance in complex samples between two rows of mufft_compact_scratch::image.
+    cfloat *tiles[2]; ///< Two tiles of mufft_plan_2d::vertical_block columns, which the vertical steps ping-pong between.
+    unsigned tile_stride; ///< Distance in complex samples between two rows of a tile.
+    cfloat *rows[2]; ///< Two rows, which the horizontal steps ping-pong between.
+};
+
+/// \brief Rounds a number of complex samples up, so that rows of that many samples keep their alignment.
+static unsigned align_samples(unsigned samples)
+{
+    unsigned alignment = MUFFT_ALIGNMENT / sizeof(cfloat);
+    return (samples + alignment - 1) & ~(alignment - 1);
+}
+
+/// \brief Lays out the scratch buffer of a 2D real plan with \ref MUFFT_FLAG_COMPACT_R2C.
+/// Nx is the size of the complex transform, so padded rows hold Nx + 1 samples, and block is mufft_plan_2d::vertical_block.
+/// Only a single image of padded rows is needed, as compact rows in caller buffers pass through a tile or a row at a time.
+/// @param scratch If non-NULL, receives pointers into base.
+/// @returns Size of the scratch buffer in complex samples.
+static size_t get_compact_scratch(struct mufft_compact_scratch *scratch, cfloat *base,
+        unsigned Nx, unsigned Ny, unsigned block)
+{
+    unsigned image_stride = align_samples(Nx + 1);
+    unsigned tile_stride = align_samples(block);
+    size_t tile_offset = (size_t)image_stride * Ny;
+    size_t row_offset = tile_offset + 2 * (size_t)tile_stride * Ny;
+
+    if (scratch != NULL)
+    {
+        scratch->image = base;
+        scratch->image_stride = image_stride;
+        scratch->tiles[0] = base + tile_offset;
+        scratch->tiles[1] = base + tile_offset + (size_t)tile_stride * Ny;
+        scratch->tile_stride = tile_stride;
+        scratch->rows[0] = base + row_offset;
+        scratch->rows[1] = base + row_offset + image_stride;
+    }
+
+    return row_offset + 2 * (size_t)image_stride;
+}
+
+/// \brief Turns a 2D plan into a pitched plan.
+/// Pitched plans never touch the caller's buffers except for reading input and writing the final result,
+/// so they need room for two full intermediate images in mufft_plan_2d::tmp_buffer.
+/// Plans with compact rows already own the scratch they need for any pitch, see \ref get_compact_scratch.
+/// The plan moves to a new block, so *plan is updated. On failure, *plan is left untouched.
+static bool set_plan_2d_pitch(mufft_plan_2d **plan_, unsigned input_pitch, unsigned output_pitch)
+{
+    mufft_plan_2d *plan = *plan_;
+    if (plan->compact)
+    {
+        plan->input_pitch = input_pitch;
+        plan->output_pitch = output_pitch;
+        return true;
+    }
+
+    unsigned row_stride = (plan->r2c_resolve != NULL || plan->c2r_resolve != NULL) ? 2 * plan->Nx : plan->Nx;
+    size_t scratch_size = 2 * (size_t)row_stride * plan->Ny * sizeof(cfloat);
+
+    plan = resize_plan_arena(plan, sizeof(*plan), scratch_size);
+    if (plan == NULL)
+    {
+        return false;
+    }
+    *plan_ = plan;
+
+    plan->tmp_buffer = plan_arena_scratch(plan, sizeof(*plan));
+    memset(plan->tmp_buffer, 0, scratch_size);
+    plan->input_pitch = input_pitch;
+    plan->output_pitch = output_pitch;
+    return true;
+}
+
+/// \brief Decides if a 2D complex-to-complex transform should transpose columns into rows.
+/// If even the narrowest tile of the vertical pass cannot keep its two buffers in cache,
+/// strided column access thrashes the cache and it is cheaper to transpose twice.
+static bool use_transpose_2d(unsigned Ny, unsigned flags)
+{
+    if ((flags & (MUFFT_FLAG_2D_TRANSPOSE | MUFFT_FLAG_2D_TRANSPOSED_OUTPUT)) != 0)
+    {
+        return true;
+    }
+
+    return 2 * 8 * (size_t)Ny * sizeof(cfloat) > axis_block_cache_size();
+}
+
+int mufft_plan_2d_uses_transpose(const mufft_plan_2d *plan)
+{
+    return plan->transpose != NULL;
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2c(unsigned Nx, unsigned Ny, int direction, unsigned flags)
+{
+    return mufft_create_plan_2d_c2c_with_allocator(Nx, Ny, direction, flags, NULL);
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2c_with_allocator(unsigned Nx, unsigned Ny, int direction, unsigned flags,
+        const mufft_allocator *allocator)
+{
+    if ((Nx & (Nx - 1)) != 0 || (Ny & (Ny - 1)) != 0 || Nx == 1 || Ny == 1)
+    {
+        return NULL;
+    }
+
+    if ((flags & MUFFT_FLAG_NORMALIZE) != 0 && (flags & MUFFT_FLAG_NORMALIZE_ORTHO) != 0)
+    {
+        return NULL;
+    }
+
+    // Vertical kernels have no compact variants.
+    flags &= ~MUFFT_FLAG_COMPACT_TWIDDLES;
+
+    // Complex-to-real transforms use the scratch buffer for two intermediate images.
+    // Real transforms with compact rows only keep one image of padded rows, and pass everything else through a tile or a row at a time.
+    bool compact = (flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R)) != 0 && (flags & MUFFT_FLAG_COMPACT_R2C) != 0;
+    size_t scratch_size = (size_t)Nx * Ny * sizeof(cfloat);
+    if (compact)
+    {
+        scratch_size = get_compact_scratch(NULL, NULL, Nx, Ny, find_axis_block(Nx + 1, Ny)) * sizeof(cfloat);
+    }
+    else if ((flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R)) != 0)
+    {
+        scratch_size *= 2;
+    }
+
+    mufft_plan_2d *plan = alloc_plan_arena(allocator, flags, sizeof(*plan), scratch_size);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+    plan->tmp_buffer = plan_arena_scratch(plan, sizeof(*plan));
+    if (compact)
+    {
+        // Padding columns of the image are read by vertical kernels, but never written.
+        memset(plan->tmp_buffer, 0, scratch_size);
+    }
+
+    plan->twiddles_x = acquire_twiddles(Nx, direction, false, false, flags);
+    plan->twiddles_y = acquire_twiddles(Ny, direction, false, false, flags);
+    if (plan->twiddles_x == NULL || plan->twiddles_y == NULL)
+    {
+        goto error;
+    }
+
+    if (!build_plan_1d(plan->steps_x, &plan->num_steps_x, Nx, direction, flags, 1))
+    {
+        goto error;
+    }
+
+    if (!build_plan_2d(plan->steps_y, &plan->num_steps_y, Nx, Ny, direction, flags))
+    {
+        goto error;
+    }
+    set_plan_prefetch_2d(plan->steps_y, plan->num_steps_y, (size_t)Nx * Ny * sizeof(cfloat));
+
+    plan->Nx = Nx;
+    plan->Ny = Ny;
+    plan->vertical_nx = Nx;
+    plan->vertical_block = find_axis_block(Nx, Ny);
+    plan->horizontal_ny = (flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y) != 0 ? Ny / 2 : Ny;
+
+    // Real transforms are twice as wide as the complex transform they are built on.
+    unsigned real_factor = (flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R)) != 0 ? 2 : 1;
+    set_plan_scale(&plan->scale, plan->steps_x, plan->num_steps_x, normalization_scale(flags, real_factor * Nx * Ny));
+
+    // Real transforms rely on the vertical pass only touching some of the columns, so only complex transforms can transpose.
+    if ((flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R)) == 0 && use_transpose_2d(Ny, flags))
+    {
+        plan->transpose = find_transpose_func(flags, plan->horizontal_ny, Nx);
+        if (plan->transpose == NULL)
+        {
+            goto error;
+        }
+
+        // Transposed columns are regular 1D transforms. Vertical zero padding becomes zero padding of every transposed row.
+        unsigned flags_t = flags & ~MUFFT_FLAG_ZERO_PAD_UPPER_HALF;
+        if ((flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y) != 0)
+        {
+            flags_t |= MUFFT_FLAG_ZERO_PAD_UPPER_HALF;
+        }
+
+        if (!build_plan_1d(plan->steps_t, &plan->num_steps_t, Ny, direction, flags_t, 1))
+        {
+            goto error;
+        }
+
+        plan->transposed_output = (flags & MUFFT_FLAG_2D_TRANSPOSED_OUTPUT) != 0;
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_2d(plan);
+    return NULL;
+}
+
+mufft_plan_2d *mufft_create_plan_2d_r2c(unsigned Nx, unsigned Ny, unsigned flags)
+{
+    return mufft_create_plan_2d_r2c_with_allocator(Nx, Ny, flags, NULL);
+}
+
+mufft_plan_2d *mufft_create_plan_2d_r2c_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        const mufft_allocator *allocator)
+{
+    if ((Nx & (Nx - 1)) != 0 || (Ny & (Ny - 1)) != 0 || Nx == 1 || Ny == 1)
+    {
+        return NULL;
+    }
+
+    if ((flags & MUFFT_FLAG_COMPACT_R2C) != 0 && (flags & MUFFT_FLAG_FULL_R2C) != 0)
+    {
+        return NULL;
+    }
+
+    if ((flags & MUFFT_FLAG_2D_TRANSPOSED_OUTPUT) != 0)
+    {
+        return NULL;
+    }
+
+    unsigned complex_n = Nx / 2;
+    mufft_plan_2d *plan = mufft_create_plan_2d_c2c_with_allocator(complex_n, Ny, MUFFT_FORWARD, flags | MUFFT_FLAG_R2C,
+            allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    plan->r2c_twiddles = acquire_twiddles(complex_n, MUFFT_FORWARD, true, false, flags);
+    if (plan->r2c_twiddles == NULL)
+    {
+        goto error;
+    }
+
+    if ((flags & MUFFT_FLAG_FULL_R2C) == 0)
+    {
+        flags |= MUFFT_FLAG_R2C;
+        plan->vertical_nx = Nx / 2 + 1;
+    }
+    else
+    {
+        plan->vertical_nx = Nx;
+    }
+    plan->vertical_block = find_axis_block(plan->vertical_nx, Ny);
+
+    plan->r2c_resolve = find_r2c_resolve_func(flags, Nx);
+    if (plan->r2c_resolve == NULL)
+    {
+        goto error;
+    }
+
+    if ((flags & MUFFT_FLAG_COMPACT_R2C) != 0)
+    {
+        plan->compact = true;
+        plan->input_pitch = Nx;
+        plan->output_pitch = 2 * (Nx / 2 + 1);
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_2d(plan);
+    return NULL;
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2r(unsigned Nx, unsigned Ny, unsigned flags)
+{
+    return mufft_create_plan_2d_c2r_with_allocator(Nx, Ny, flags, NULL);
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2r_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        const mufft_allocator *allocator)
+{
+    if ((Nx & (Nx - 1)) != 0 || (Ny & (Ny - 1)) != 0 || Nx == 1 || Ny == 1)
+    {
+        return NULL;
+    }
+
+    if ((flags & MUFFT_FLAG_2D_TRANSPOSED_OUTPUT) != 0)
+    {
+        return NULL;
+    }
+
+    // Zero padding applies to the input of the transform, which is in the frequency domain here.
+    flags &= ~(MUFFT_FLAG_ZERO_PAD_UPPER_HALF | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+
+    unsigned complex_n = Nx / 2;
+    mufft_plan_2d *plan = mufft_create_plan_2d_c2c_with_allocator(complex_n, Ny, MUFFT_INVERSE, flags | MUFFT_FLAG_C2R,
+            allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    plan->r2c_twiddles = acquire_twiddles(complex_n, MUFFT_INVERSE, true, false, flags);
+    if (plan->r2c_twiddles == NULL)
+    {
+        goto error;
+    }
+
+    plan->vertical_nx = Nx / 2 + 1;
+    plan->vertical_block = find_axis_block(plan->vertical_nx, Ny);
+
+    plan->c2r_resolve = find_r2c_resolve_func(flags | MUFFT_FLAG_C2R, Nx);
+    if (plan->c2r_resolve == NULL)
+    {
+        goto error;
+    }
+
+    if ((flags & MUFFT_FLAG_COMPACT_R2C) != 0)
+    {
+        plan->compact = true;
+        plan->input_pitch = 2 * (Nx / 2 + 1);
+        plan->output_pitch = Nx;
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_2d(plan);
+    return NULL;
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2c_pitched(unsigned Nx, unsigned Ny, int direction, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch)
+{
+    return mufft_create_plan_2d_c2c_pitched_with_allocator(Nx, Ny, direction, flags, input_pitch, output_pitch, NULL);
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2c_pitched_with_allocator(unsigned Nx, unsigned Ny, int direction, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch, const mufft_allocator *allocator)
+{
+    if (input_pitch < Nx || output_pitch < Nx || (flags & MUFFT_FLAG_2D_TRANSPOSED_OUTPUT) != 0)
+    {
+        return NULL;
+    }
+
+    // Pitched plans always go through the vertical pass.
+    flags &= ~MUFFT_FLAG_2D_TRANSPOSE;
+    mufft_plan_2d *plan = mufft_create_plan_2d_c2c_with_allocator(Nx, Ny, direction, flags, allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    if (!set_plan_2d_pitch(&plan, 2 * input_pitch, 2 * output_pitch))
+    {
+        goto error;
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_2d(plan);
+    return NULL;
+}
+
+mufft_plan_2d *mufft_create_plan_2d_r2c_pitched(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch)
+{
+    return mufft_create_plan_2d_r2c_pitched_with_allocator(Nx, Ny, flags, input_pitch, output_pitch, NULL);
+}
+
+mufft_plan_2d *mufft_create_plan_2d_r2c_pitched_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch, const mufft_allocator *allocator)
+{
+    unsigned complex_nx = (flags & MUFFT_FLAG_COMPACT_R2C) != 0 ? Nx / 2 + 1 : Nx;
+    if (input_pitch < Nx || output_pitch < complex_nx)
+    {
+        return NULL;
+    }
+
+    mufft_plan_2d *plan = mufft_create_plan_2d_r2c_with_allocator(Nx, Ny, flags, allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    if (!set_plan_2d_pitch(&plan, input_pitch, 2 * output_pitch))
+    {
+        goto error;
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_2d(plan);
+    return NULL;
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2r_pitched(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch)
+{
+    return mufft_create_plan_2d_c2r_pitched_with_allocator(Nx, Ny, flags, input_pitch, output_pitch, NULL);
+}
+
+mufft_plan_2d *mufft_create_plan_2d_c2r_pitched_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch, const mufft_allocator *allocator)
+{
+    unsigned complex_nx = (flags & MUFFT_FLAG_COMPACT_R2C) != 0 ? Nx / 2 + 1 : Nx;
+    if (input_pitch < complex_nx || output_pitch < Nx)
+    {
+        return NULL;
+    }
+
+    mufft_plan_2d *plan = mufft_create_plan_2d_c2r_with_allocator(Nx, Ny, flags, allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    if (!set_plan_2d_pitch(&plan, 2 * input_pitch, output_pitch))
+    {
+        goto error;
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_2d(plan);
+    return NULL;
+}
+
+/// \brief Creates an N-dimensional plan. Nx is the size of the contiguous complex rows,
+/// and N holds the sizes of the remaining num_axes strided axes.
+static mufft_plan_nd *create_plan_nd(unsigned Nx, unsigned num_axes, const unsigned *N, int direction, unsigned flags,
+        const mufft_allocator *allocator)
+{
+    if ((Nx & (Nx - 1)) != 0 || Nx == 1)
+    {
+        return NULL;
+    }
+
+    unsigned num_rows = 1;
+    for (unsigned i = 0; i < num_axes; i++)
+    {
+        if ((N[i] & (N[i] - 1)) != 0 || N[i] <= 1)
+        {
+            return NULL;
+        }
+        num_rows *= N[i];
+    }
+
+    // Zero padding is only supported for 1D and 2D, and compact twiddle factors only for 1D.
+    flags &= ~(MUFFT_FLAG_ZERO_PAD_UPPER_HALF | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y | MUFFT_FLAG_COMPACT_TWIDDLES);
+
+    unsigned row_stride = (flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R)) != 0 ? 2 * Nx : Nx;
+    size_t plan_size = sizeof(mufft_plan_nd) + num_axes * sizeof(struct mufft_axis_nd);
+    mufft_plan_nd *plan = alloc_plan_arena(allocator, flags, plan_size, (size_t)row_stride * num_rows * sizeof(cfloat));
+    if (plan == NULL)
+    {
+        goto error;
+    }
+    plan->tmp_buffer = plan_arena_scratch(plan, plan_size);
+    plan->num_axes = num_axes;
+
+    plan->Nx = Nx;
+    plan->num_rows = num_rows;
+    plan->row_stride = row_stride;
+    if ((flags & (MUFFT_FLAG_R2C | MUFFT_FLAG_C2R)) != 0)
+    {
+        plan->vertical_nx = (flags & MUFFT_FLAG_FULL_R2C) != 0 ? 2 * Nx : Nx + 1;
+    }
+    else
+    {
+        plan->vertical_nx = Nx;
+    }
+
+    plan->twiddles_x = acquire_twiddles(Nx, direction, false, false, flags);
+    if (plan->twiddles_x == NULL)
+    {
+        goto error;
+    }
+
+    if (!build_plan_1d(plan->steps_x, &plan->num_steps_x, Nx, direction, flags, 1))
+    {
+        goto error;
+    }
+
+    // If all columns are transformed, every hyperplane is contiguous and can be treated as one wide row.
+    bool merge_lines = plan->vertical_nx == plan->row_stride;
+    unsigned lines = 1;
+
+    for (unsigned i = 0; i < num_axes; i++)
+    {
+        struct mufft_axis_nd *axis = &plan->axes[i];
+        axis->N = N[i];
+        axis->stride = plan->row_stride * lines;
+        axis->num_outer = num_rows / (lines * N[i]);
+        axis->num_lines = merge_lines ? 1 : lines;
+        axis->width = merge_lines ? axis->stride : plan->vertical_nx;
+        axis->block = find_axis_block(axis->width, axis->N);
+
+        axis->twiddles = acquire_twiddles(axis->N, direction, false, false, flags);
+        if (axis->twiddles == NULL)
+        {
+            goto error;
+        }
+
+        if (!build_plan_2d(axis->steps, &axis->num_steps, axis->block, axis->N, direction, flags))
+        {
+            goto error;
+        }
+        set_plan_prefetch_2d(axis->steps, axis->num_steps, (size_t)axis->stride * axis->N * sizeof(cfloat));
+
+        lines *= N[i];
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_nd(plan);
+    return NULL;
+}
+
+mufft_plan_nd *mufft_create_plan_nd_c2c(unsigned dimensions, const unsigned *N, int direction, unsigned flags)
+{
+    return mufft_create_plan_nd_c2c_with_allocator(dimensions, N, direction, flags, NULL);
+}
+
+mufft_plan_nd *mufft_create_plan_nd_c2c_with_allocator(unsigned dimensions, const unsigned *N, int direction,
+        unsigned flags, const mufft_allocator *allocator)
+{
+    if (dimensions == 0)
     {
         return NULL;
     }
 
-    unsigned complex_n = Nx / 2;
-    mufft_plan_2d *plan = mufft_create_plan_2d_c2c(complex_n, Ny, MUFFT_INVERSE, flags | MUFFT_FLAG_C2R);
+    return create_plan_nd(N[0], dimensions - 1, N + 1, direction, flags & ~(MUFFT_FLAG_R2C | MUFFT_FLAG_C2R), allocator);
+}
+
+mufft_plan_nd *mufft_create_plan_nd_r2c(unsigned dimensions, const unsigned *N, unsigned flags)
+{
+    return mufft_create_plan_nd_r2c_with_allocator(dimensions, N, flags, NULL);
+}
+
+mufft_plan_nd *mufft_create_plan_nd_r2c_with_allocator(unsigned dimensions, const unsigned *N, unsigned flags,
+        const mufft_allocator *allocator)
+{
+    if (dimensions == 0 || (N[0] & (N[0] - 1)) != 0 || N[0] < 4)
+    {
+        return NULL;
+    }
+
+    unsigned complex_n = N[0] / 2;
+    mufft_plan_nd *plan = create_plan_nd(complex_n, dimensions - 1, N + 1, MUFFT_FORWARD, flags | MUFFT_FLAG_R2C, allocator);
     if (plan == NULL)
     {
         goto error;
     }
 
-    plan->r2c_twiddles = build_r2c_twiddles(MUFFT_INVERSE, complex_n);
+    plan->r2c_twiddles = acquire_twiddles(complex_n, MUFFT_FORWARD, true, false, flags);
     if (plan->r2c_twiddles == NULL)
     {
         goto error;
     }
 
-    plan->c2r_resolve = find_r2c_resolve_func(flags | MUFFT_FLAG_C2R, Nx);
+    if ((flags & MUFFT_FLAG_FULL_R2C) == 0)
+    {
+        flags |= MUFFT_FLAG_R2C;
+    }
+
+    plan->r2c_resolve = find_r2c_resolve_func(flags, N[0]);
+    if (plan->r2c_resolve == NULL)
+    {
+        goto error;
+    }
+
+    return plan;
+
+error:
+    mufft_free_plan_nd(plan);
+    return NULL;
+}
+
+mufft_plan_nd *mufft_create_plan_nd_c2r(unsigned dimensions, const unsigned *N, unsigned flags)
+{
+    return mufft_create_plan_nd_c2r_with_allocator(dimensions, N, flags, NULL);
+}
+
+mufft_plan_nd *mufft_create_plan_nd_c2r_with_allocator(unsigned dimensions, const unsigned *N, unsigned flags,
+        const mufft_allocator *allocator)
+{
+    if (dimensions == 0 || (N[0] & (N[0] - 1)) != 0 || N[0] < 4)
+    {
+        return NULL;
+    }
+
+    unsigned complex_n = N[0] / 2;
+    mufft_plan_nd *plan = create_plan_nd(complex_n, dimensions - 1, N + 1, MUFFT_INVERSE,
+            (flags & ~MUFFT_FLAG_FULL_R2C) | MUFFT_FLAG_C2R, allocator);
+    if (plan == NULL)
+    {
+        goto error;
+    }
+
+    plan->r2c_twiddles = acquire_twiddles(complex_n, MUFFT_INVERSE, true, false, flags);
+    if (plan->r2c_twiddles == NULL)
+    {
+        goto error;
+    }
+
+    plan->c2r_resolve = find_r2c_resolve_func(flags | MUFFT_FLAG_C2R, N[0]);
     if (plan->c2r_resolve == NULL)
     {
         goto error;
@@ -787,10 +2604,28 @@ mufft_plan_2d *mufft_create_plan_2d_c2r(unsigned Nx, unsigned Ny, unsigned flags
     return plan;
 
 error:
-    mufft_free_plan_2d(plan);
+    mufft_free_plan_nd(plan);
     return NULL;
 }
 
+mufft_plan_3d *mufft_create_plan_3d_c2c(unsigned Nx, unsigned Ny, unsigned Nz, int direction, unsigned flags)
+{
+    const unsigned N[] = { Nx, Ny, Nz };
+    return mufft_create_plan_nd_c2c(3, N, direction, flags);
+}
+
+mufft_plan_3d *mufft_create_plan_3d_r2c(unsigned Nx, unsigned Ny, unsigned Nz, unsigned flags)
+{
+    const unsigned N[] = { Nx, Ny, Nz };
+    return mufft_create_plan_nd_r2c(3, N, flags);
+}
+
+mufft_plan_3d *mufft_create_plan_3d_c2r(unsigned Nx, unsigned Ny, unsigned Nz, unsigned flags)
+{
+    const unsigned N[] = { Nx, Ny, Nz };
+    return mufft_create_plan_nd_c2r(3, N, flags);
+}
+
 size_t mufft_conv_get_transformed_block_size(mufft_plan_conv *plan)
 {
     return plan->block_size;
@@ -808,8 +2643,77 @@ void mufft_execute_conv_output(mufft_plan_conv *plan, void *output, const void *
     mufft_execute_plan_1d(plan->output_plan, output, plan->conv_block);
 }
 
-void mufft_execute_plan_1d(mufft_plan_1d *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input)
+/// \brief Runs step i of a horizontal transform, or its scaling variant if the normalization is folded into it.
+static inline void execute_step_1d(const struct mufft_scale_step *scale, const struct mufft_step_1d *steps, unsigned i,
+        cfloat *output, const cfloat *input, const cfloat *twiddles, unsigned samples)
+{
+    const struct mufft_step_1d *step = &steps[i];
+    if (scale->func != NULL && scale->index == i)
+    {
+        scale->func(output, input, twiddles + step->twiddle_offset, scale->scale, step->p, samples);
+    }
+    else
+    {
+        step->func(output, input, twiddles + step->twiddle_offset, step->p, samples);
+    }
+}
+
+/// \brief Normalizes output in a separate pass, if it could not be folded into one of the steps.
+/// Scales rows of row_size floats, pitch floats apart.
+static void execute_scale(const struct mufft_scale_step *scale, float *output,
+        unsigned rows, unsigned row_size, unsigned pitch)
+{
+    if (scale->func != NULL || scale->scale == 1.0f)
+    {
+        return;
+    }
+
+    for (unsigned y = 0; y < rows; y++)
+    {
+        float *row = output + (size_t)y * pitch;
+        for (unsigned x = 0; x < row_size; x++)
+        {
+            row[x] *= scale->scale;
+        }
+    }
+}
+
+/// \brief Executes an output pruned plan. Runs the planned FFT steps in scratch, then finishes the requested bins with a partial DFT.
+static void execute_plan_1d_pruned(mufft_plan_1d *plan, cfloat *output, const cfloat *input)
+{
+    const cfloat *pt = plan->twiddles;
+    unsigned N = plan->N;
+    unsigned p = 1;
+
+    for (unsigned i = 0; i < plan->num_steps; i++)
+    {
+        const struct mufft_step_1d *step = &plan->steps[i];
+        cfloat *out = plan->tmp_buffer + (i & 1) * N;
+        execute_step_1d(&plan->scale, plan->steps, i, out, input, pt, N);
+        input = out;
+        p = step->p * step->radix;
+    }
+
+    plan->partial_dft(output, input, pt + twiddle_level_offset(N / 2), p,
+            plan->first_bin, plan->num_bins, N);
+}
+
+void mufft_execute_plan_1d(mufft_plan_1d *plan, void *output, const void *input)
 {
+    if (plan->partial_dft != NULL)
+    {
+        // The first step writes to scratch, but without any steps, the partial DFT reads input directly.
+        if (input == output && plan->num_steps == 0)
+        {
+            memcpy(plan->tmp_buffer, input, plan->input_size * sizeof(float));
+            input = plan->tmp_buffer;
+        }
+
+        execute_plan_1d_pruned(plan, output, input);
+        execute_scale(&plan->scale, output, 1, plan->output_size, 0);
+        return;
+    }
+
     const cfloat *pt = plan->twiddles;
     cfloat *out = output;
     cfloat *in = plan->tmp_buffer;
@@ -821,38 +2725,404 @@ void mufft_execute_plan_1d(mufft_plan_1d *plan, void * MUFFT_RESTRICT output, co
     // We want final step to write to output.
     if ((steps & 1) == 1)
     {
-        SWAP(out, in);
+        SWAP(out, in);
+    }
+
+    // Zero pad a non-zero region which is not a power of two in the buffer the first step does not write to.
+    // This is also safe in place, as the first step then reads from output and writes to scratch.
+    if (plan->input_size < plan->padded_input_size)
+    {
+        float *padded = (float*)out;
+        memmove(padded, input, plan->input_size * sizeof(float));
+        memset(padded + plan->input_size, 0, (plan->padded_input_size - plan->input_size) * sizeof(float));
+        input = padded;
+    }
+    else if (input == output)
+    {
+        // Input is only read by the first pass. In place, that pass must not write to output,
+        // so if the number of passes is odd, run it from a copy in scratch instead.
+        cfloat *first_output = plan->c2r_resolve != NULL ? out : in;
+        if (first_output == output)
+        {
+            memcpy(plan->tmp_buffer, input, plan->input_size * sizeof(float));
+            input = plan->tmp_buffer;
+        }
+    }
+
+    const struct mufft_step_1d *first_step = &plan->steps[0];
+    if (plan->c2r_resolve != NULL)
+    {
+        plan->c2r_resolve(out, input, plan->r2c_twiddles, N);
+        first_step->func(in, out, pt, 1, N);
+    }
+    else if (plan->c2r_first_step != NULL)
+    {
+        plan->c2r_first_step(in, input, pt + first_step->twiddle_offset, plan->r2c_twiddles, first_step->p, N);
+    }
+    else
+    {
+        first_step->func(in, input, pt + first_step->twiddle_offset, first_step->p, N);
+    }
+
+    unsigned num_steps = plan->num_steps - (plan->r2c_last_step != NULL);
+    for (unsigned i = 1; i < num_steps; i++)
+    {
+        execute_step_1d(&plan->scale, plan->steps, i, out, in, pt, N);
+        SWAP(out, in);
+    }
+
+    // Do Real-to-complex butterfly resolve, either on its own or as part of the last step.
+    if (plan->r2c_last_step != NULL)
+    {
+        const struct mufft_step_1d *step = &plan->steps[num_steps];
+        plan->r2c_last_step(out, in, pt + step->twiddle_offset, plan->r2c_twiddles, step->p, N);
+    }
+    else if (plan->r2c_resolve != NULL)
+    {
+        plan->r2c_resolve(out, in, plan->r2c_twiddles, N);
+    }
+
+    execute_scale(&plan->scale, output, 1, plan->output_size, 0);
+}
+
+/// \brief Runs all vertical steps of a 2D plan, one tile of mufft_plan_2d::vertical_block columns at a time.
+/// The first step reads from input and the last step writes to output.
+/// Intermediate steps ping-pong between the two buffers, such that the second-to-last step writes to buffers[1].
+/// Every tile goes through all steps before moving on, so wide transforms stay in cache.
+static void execute_plan_2d_vertical(const mufft_plan_2d *plan,
+        cfloat *output, unsigned output_stride, const cfloat *input, unsigned input_stride,
+        cfloat * const *buffers, unsigned stride)
+{
+    const cfloat *pty = plan->twiddles_y;
+    unsigned num_steps_y = plan->num_steps_y;
+    unsigned width = plan->vertical_nx;
+
+    for (unsigned x = 0; x < width; x += plan->vertical_block)
+    {
+        unsigned samples_x = width - x < plan->vertical_block ? width - x : plan->vertical_block;
+
+        const cfloat *in = input + x;
+        unsigned in_stride = input_stride;
+        for (unsigned i = 0; i < num_steps_y; i++)
+        {
+            const struct mufft_step_2d *step = &plan->steps_y[i];
+            bool last = i + 1 == num_steps_y;
+            cfloat *out = last ? output + x : buffers[(num_steps_y - 1 - i) & 1] + x;
+            step->func(out, in, pty + step->twiddle_offset, step->p,
+                    samples_x, in_stride, last ? output_stride : stride, plan->Ny);
+            in = out;
+            in_stride = stride;
+        }
+    }
+}
+
+/// \brief Executes a pitched 2D plan.
+/// All intermediate passes ping-pong between the two halves of mufft_plan_2d::tmp_buffer.
+/// Input is only read by the first pass and output is only written by the last pass,
+/// which allows transforming a region of interest in place.
+static void execute_plan_2d_pitched(mufft_plan_2d *plan, float *output, const float *input)
+{
+    const cfloat *ptx = plan->twiddles_x;
+
+    unsigned Nx = plan->Nx;
+    unsigned Ny = plan->Ny;
+    bool real = plan->r2c_resolve != NULL || plan->c2r_resolve != NULL;
+    unsigned row_stride = real ? 2 * Nx : Nx;
+
+    cfloat *buffers[2] = { plan->tmp_buffer, plan->tmp_buffer + (size_t)row_stride * Ny };
+
+    if (plan->c2r_resolve != NULL)
+    {
+        // Vertical transforms first. The last vertical step lands in buffers[0].
+        execute_plan_2d_vertical(plan, buffers[0], row_stride, (const cfloat*)input, plan->input_pitch / 2,
+                buffers, row_stride);
+
+        // Resolve, then horizontal transforms over all lines individually.
+        // Row pass j reads buffers[j & 1], and the last pass writes directly to output.
+        unsigned num_steps_x = plan->num_steps_x;
+        for (unsigned y = 0; y < Ny; y++)
+        {
+            size_t offset = (size_t)y * row_stride;
+            plan->c2r_resolve(buffers[1] + offset, buffers[0] + offset, plan->r2c_twiddles, Nx);
+
+            for (unsigned i = 0; i < num_steps_x; i++)
+            {
+                const cfloat *in = buffers[(i + 1) & 1] + offset;
+                cfloat *out = i + 1 == num_steps_x ?
+                    (cfloat*)(output + (size_t)y * plan->output_pitch) : buffers[i & 1] + offset;
+                execute_step_1d(&plan->scale, plan->steps_x, i, out, in, ptx, Nx);
+            }
+        }
+    }
+    else
+    {
+        // Horizontal transforms over all lines individually. The last pass on every row lands in buffers[0].
+        unsigned num_passes = plan->num_steps_x + (plan->r2c_resolve != NULL);
+        unsigned horizontal_ny = plan->horizontal_ny;
+        for (unsigned y = 0; y < horizontal_ny; y++)
+        {
+            size_t offset = (size_t)y * row_stride;
+            const cfloat *in = (const cfloat*)(input + (size_t)y * plan->input_pitch);
+
+            for (unsigned i = 0; i < plan->num_steps_x; i++)
+            {
+                cfloat *out = buffers[(num_passes - 1 - i) & 1] + offset;
+                execute_step_1d(&plan->scale, plan->steps_x, i, out, in, ptx, Nx);
+                in = out;
+            }
+
+            if (plan->r2c_resolve != NULL)
+            {
+                plan->r2c_resolve(buffers[0] + offset, in, plan->r2c_twiddles, Nx);
+            }
+        }
+
+        // Vertical transforms. The last vertical step writes directly to output.
+        unsigned num_steps_y = plan->num_steps_y;
+        cfloat *vertical_buffers[2] = { buffers[num_steps_y & 1], buffers[(num_steps_y + 1) & 1] };
+        execute_plan_2d_vertical(plan, (cfloat*)output, plan->output_pitch / 2, buffers[0], row_stride,
+                vertical_buffers, row_stride);
+    }
+}
+
+/// \brief Runs all vertical steps of a 2D plan with compact rows, one tile of mufft_plan_2d::vertical_block columns at a time.
+/// Intermediate steps ping-pong between the two tiles in scratch.
+/// Compact rows are not padded for SIMD, so with stage_input, every tile of input is copied to a tile first,
+/// and with stage_output, the last step writes to a tile which is copied to output.
+static void execute_plan_2d_vertical_tiled(const mufft_plan_2d *plan,
+        cfloat *output, unsigned output_stride, const cfloat *input, unsigned input_stride,
+        const struct mufft_compact_scratch *scratch, bool stage_input, bool stage_output)
+{
+    const cfloat *pty = plan->twiddles_y;
+    unsigned num_steps_y = plan->num_steps_y;
+    unsigned width = plan->vertical_nx;
+    unsigned Ny = plan->Ny;
+    unsigned tile_stride = scratch->tile_stride;
+
+    for (unsigned x = 0; x < width; x += plan->vertical_block)
+    {
+        unsigned samples_x = width - x < plan->vertical_block ? width - x : plan->vertical_block;
+
+        const cfloat *in = input + x;
+        unsigned in_stride = input_stride;
+        if (stage_input)
+        {
+            for (unsigned y = 0; y < Ny; y++)
+            {
+                memcpy(scratch->tiles[1] + (size_t)y * tile_stride, in + (size_t)y * input_stride,
+                        samples_x * sizeof(cfloat));
+            }
+            in = scratch->tiles[1];
+            in_stride = tile_stride;
+        }
+
+        for (unsigned i = 0; i < num_steps_y; i++)
+        {
+            const struct mufft_step_2d *step = &plan->steps_y[i];
+            bool direct = i + 1 == num_steps_y && !stage_output;
+            cfloat *out = direct ? output + x : scratch->tiles[i & 1];
+            unsigned out_stride = direct ? output_stride : tile_stride;
+            step->func(out, in, pty + step->twiddle_offset, step->p,
+                    samples_x, in_stride, out_stride, Ny);
+            in = out;
+            in_stride = out_stride;
+        }
+
+        if (stage_output)
+        {
+            for (unsigned y = 0; y < Ny; y++)
+            {
+                memcpy(output + (size_t)y * output_stride + x, in + (size_t)y * tile_stride,
+                        samples_x * sizeof(cfloat));
+            }
+        }
+    }
+}
+
+/// \brief Executes a 2D real plan with \ref MUFFT_FLAG_COMPACT_R2C.
+/// The horizontal and vertical passes exchange data through a single image of padded rows in scratch.
+/// Horizontal steps ping-pong between two rows, and vertical steps between two tiles,
+/// which is also where compact rows are staged. See \ref get_compact_scratch.
+/// Input is only read before output is written, so the plan works in place as well.
+static void execute_plan_2d_compact(mufft_plan_2d *plan, float *output, const float *input)
+{
+    const cfloat *ptx = plan->twiddles_x;
+
+    unsigned Nx = plan->Nx;
+    unsigned Ny = plan->Ny;
+    unsigned num_steps_x = plan->num_steps_x;
+
+    struct mufft_compact_scratch scratch;
+    get_compact_scratch(&scratch, plan->tmp_buffer, Nx, Ny, plan->vertical_block);
+    size_t image_stride = scratch.image_stride;
+
+    if (plan->c2r_resolve != NULL)
+    {
+        // Vertical transforms first, which land in the image of padded rows.
+        execute_plan_2d_vertical_tiled(plan, scratch.image, scratch.image_stride,
+                (const cfloat*)input, plan->input_pitch / 2, &scratch, true, false);
+
+        // Resolve, then horizontal transforms over all lines individually.
+        // Row pass j reads rows[(j + 1) & 1], and the last pass writes directly to output.
+        for (unsigned y = 0; y < Ny; y++)
+        {
+            plan->c2r_resolve(scratch.rows[1], scratch.image + y * image_stride, plan->r2c_twiddles, Nx);
+
+            for (unsigned i = 0; i < num_steps_x; i++)
+            {
+                const cfloat *in = scratch.rows[(i + 1) & 1];
+                cfloat *out = i + 1 == num_steps_x ?
+                    (cfloat*)(output + (size_t)y * plan->output_pitch) : scratch.rows[i & 1];
+                execute_step_1d(&plan->scale, plan->steps_x, i, out, in, ptx, Nx);
+            }
+        }
+    }
+    else
+    {
+        // Horizontal transforms over all lines individually. The last step on every row lands in rows[0],
+        // and resolves into the image of padded rows.
+        unsigned horizontal_ny = plan->horizontal_ny;
+        for (unsigned y = 0; y < horizontal_ny; y++)
+        {
+            const cfloat *in = (const cfloat*)(input + (size_t)y * plan->input_pitch);
+
+            for (unsigned i = 0; i < num_steps_x; i++)
+            {
+                cfloat *out = scratch.rows[(num_steps_x - 1 - i) & 1];
+                execute_step_1d(&plan->scale, plan->steps_x, i, out, in, ptx, Nx);
+                in = out;
+            }
+
+            plan->r2c_resolve(scratch.image + y * image_stride, in, plan->r2c_twiddles, Nx);
+        }
+
+        // Vertical transforms, which write compact rows to output.
+        execute_plan_2d_vertical_tiled(plan, (cfloat*)output, plan->output_pitch / 2,
+                scratch.image, scratch.image_stride, &scratch, false, true);
+    }
+}
+
+/// Largest side of a block which is transposed directly. 32 by 32 complex samples is 8 kB, which fits in L1 together with its destination.
+#define MUFFT_TRANSPOSE_BLOCK 32
+
+/// \brief Cache-oblivious transpose of a rows by columns block.
+/// Recursively halves the longest side until the block fits in L1, then transposes it with a SIMD routine.
+static void transpose_2d(mufft_transpose_func func, cfloat *output, const cfloat *input,
+        unsigned rows, unsigned columns, unsigned output_stride, unsigned input_stride)
+{
+    if (rows <= MUFFT_TRANSPOSE_BLOCK && columns <= MUFFT_TRANSPOSE_BLOCK)
+    {
+        func(output, input, rows, columns, output_stride, input_stride);
+    }
+    else if (rows >= columns)
+    {
+        unsigned half = rows >> 1;
+        transpose_2d(func, output, input, half, columns, output_stride, input_stride);
+        transpose_2d(func, output + half, input + (size_t)half * input_stride,
+                rows - half, columns, output_stride, input_stride);
+    }
+    else
+    {
+        unsigned half = columns >> 1;
+        transpose_2d(func, output, input, rows, half, output_stride, input_stride);
+        transpose_2d(func, output + (size_t)half * output_stride, input + half,
+                rows, columns - half, output_stride, input_stride);
+    }
+}
+
+/// \brief Executes a 2D plan by transforming rows, transposing, transforming the former columns as rows and transposing back.
+static void execute_plan_2d_transpose(mufft_plan_2d *plan, cfloat *output, const cfloat *input)
+{
+    const cfloat *ptx = plan->twiddles_x;
+    const cfloat *pty = plan->twiddles_y;
+
+    unsigned Nx = plan->Nx;
+    unsigned Ny = plan->Ny;
+    unsigned horizontal_ny = plan->horizontal_ny;
+
+    cfloat *buffers[2] = { output, plan->tmp_buffer };
+
+    // Work backwards from where the column transforms must end up to pick buffers for every pass.
+    // Transposing back needs the columns to end in scratch, otherwise they end directly in output.
+    unsigned column_buffer = plan->transposed_output ? 0 : 1;
+    unsigned transposed_buffer = (column_buffer + plan->num_steps_t) & 1;
+    unsigned row_buffer = transposed_buffer ^ 1;
+
+    // In place, the first row pass must not write to output, so run it from a copy in scratch if it would.
+    if (input == output && ((row_buffer + plan->num_steps_x - 1) & 1) == 0)
+    {
+        memcpy(plan->tmp_buffer, input, (size_t)horizontal_ny * Nx * sizeof(cfloat));
+        input = plan->tmp_buffer;
+    }
+
+    // Horizontal transforms over all lines individually.
+    for (unsigned y = 0; y < horizontal_ny; y++)
+    {
+        const cfloat *in = input + (size_t)y * Nx;
+        for (unsigned i = 0; i < plan->num_steps_x; i++)
+        {
+            cfloat *out = buffers[(row_buffer + plan->num_steps_x - 1 - i) & 1] + (size_t)y * Nx;
+            execute_step_1d(&plan->scale, plan->steps_x, i, out, in, ptx, Nx);
+            in = out;
+        }
+    }
+
+    // With vertical zero padding, only the first half of every transposed row is written, and the rest is never read.
+    transpose_2d(plan->transpose, buffers[transposed_buffer], buffers[row_buffer], horizontal_ny, Nx, Ny, Nx);
+
+    // Former columns are now contiguous rows.
+    for (unsigned x = 0; x < Nx; x++)
+    {
+        const cfloat *in = buffers[transposed_buffer] + (size_t)x * Ny;
+        for (unsigned i = 0; i < plan->num_steps_t; i++)
+        {
+            const struct mufft_step_1d *step = &plan->steps_t[i];
+            cfloat *out = buffers[(transposed_buffer + 1 + i) & 1] + (size_t)x * Ny;
+            step->func(out, in, pty + step->twiddle_offset, step->p, Ny);
+            in = out;
+        }
     }
 
-    const struct mufft_step_1d *first_step = &plan->steps[0];
-    if (plan->c2r_resolve != NULL)
+    if (!plan->transposed_output)
     {
-        plan->c2r_resolve(out, input, plan->r2c_twiddles, N);
-        first_step->func(in, out, pt, 1, N);
+        transpose_2d(plan->transpose, output, buffers[column_buffer], Nx, Ny, Nx, Ny);
     }
-    else
+}
+
+/// \brief Normalizes the output of a 2D plan in a separate pass, if it could not be folded into the horizontal transform.
+static void execute_scale_2d(const mufft_plan_2d *plan, float *output)
+{
+    // Real-to-complex rows hold mufft_plan_2d::vertical_nx complex samples, but are laid out 2 * Nx samples apart.
+    bool r2c = plan->r2c_resolve != NULL;
+    unsigned row_size = r2c ? 2 * plan->vertical_nx : 2 * plan->Nx;
+    unsigned pitch = plan->input_pitch != 0 ? plan->output_pitch : (r2c ? 4 * plan->Nx : 2 * plan->Nx);
+    execute_scale(&plan->scale, output, plan->Ny, row_size, pitch);
+}
+
+void mufft_execute_plan_2d(mufft_plan_2d *plan, void *output, const void *input_)
+{
+    if (plan->compact)
     {
-        first_step->func(in, input, pt, 1, N);
+        execute_plan_2d_compact(plan, output, input_);
+        execute_scale_2d(plan, output);
+        return;
     }
 
-    for (unsigned i = 1; i < plan->num_steps; i++)
+    if (plan->input_pitch != 0)
     {
-        const struct mufft_step_1d *step = &plan->steps[i];
-        step->func(out, in, pt + step->twiddle_offset, step->p, N);
-        SWAP(out, in);
+        execute_plan_2d_pitched(plan, output, input_);
+        execute_scale_2d(plan, output);
+        return;
     }
 
-    // Do Real-to-complex butterfly resolve.
-    if (plan->r2c_resolve != NULL)
+    if (plan->transpose != NULL)
     {
-        plan->r2c_resolve(out, in, plan->r2c_twiddles, N);
+        execute_plan_2d_transpose(plan, output, input_);
+        execute_scale_2d(plan, output);
+        return;
     }
-}
 
-void mufft_execute_plan_2d(mufft_plan_2d *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input_)
-{
     const cfloat *ptx = plan->twiddles_x;
-    const cfloat *pty = plan->twiddles_y;
     const cfloat *input = input_;
 
     unsigned Nx = plan->Nx;
@@ -869,26 +3139,16 @@ void mufft_execute_plan_2d(mufft_plan_2d *plan, void * MUFFT_RESTRICT output, co
             SWAP(hout, hin);
         }
 
-        cfloat *out = hout;
-        cfloat *in = hin;
+        // First, vertical transforms, which land in hin.
+        cfloat *buffers[2] = { hin, hout };
 
-        unsigned num_steps_y = plan->num_steps_y;
-        if ((num_steps_y & 1) == 0)
-        {
-            SWAP(out, in);
-        }
-
-        // First, vertical transforms.
-        const struct mufft_step_2d *first_step = &plan->steps_y[0];
-        first_step->func(in, input, pty, 1, Nx + 1, 2 * Nx, Ny);
-        for (unsigned i = 1; i < plan->num_steps_y; i++)
+        // In place, the first vertical pass must not write to output, so run it from a copy in scratch if it would.
+        if (input == output && buffers[(plan->num_steps_y - 1) & 1] == output)
         {
-            const struct mufft_step_2d *step = &plan->steps_y[i];
-            step->func(out, in, pty + step->twiddle_offset, step->p, Nx + 1, 2 * Nx, Ny);
-            SWAP(out, in);
+            memcpy(plan->tmp_buffer, input, 2 * (size_t)Nx * Ny * sizeof(cfloat));
+            input = plan->tmp_buffer;
         }
-
-        mufft_assert(in == hin);
+        execute_plan_2d_vertical(plan, hin, 2 * Nx, input, 2 * Nx, buffers, 2 * Nx);
 
         // Do first inverse FFT butterfly pass horizontally.
         for (unsigned y = 0; y < Ny; y++)
@@ -906,8 +3166,7 @@ void mufft_execute_plan_2d(mufft_plan_2d *plan, void * MUFFT_RESTRICT output, co
             first_step->func(tin + y * Nx, tout + y * Nx, ptx, 1, Nx);
             for (unsigned i = 1; i < plan->num_steps_x; i++)
             {
-                const struct mufft_step_1d *step = &plan->steps_x[i];
-                step->func(tout + y * Nx, tin + y * Nx, ptx + step->twiddle_offset, step->p, Nx);
+                execute_step_1d(&plan->scale, plan->steps_x, i, tout + y * Nx, tin + y * Nx, ptx, Nx);
                 SWAP(tout, tin);
             }
 
@@ -935,8 +3194,17 @@ void mufft_execute_plan_2d(mufft_plan_2d *plan, void * MUFFT_RESTRICT output, co
             SWAP(out, in);
         }
 
+        // In place, the first horizontal pass must not write to output, so run it from a copy in scratch if it would.
+        unsigned horizontal_ny = plan->horizontal_ny;
+        if (input == output && in == output)
+        {
+            memcpy(plan->tmp_buffer, input, (size_t)horizontal_ny * Nx * sizeof(cfloat));
+            input = plan->tmp_buffer;
+        }
+
         // First, horizontal transforms over all lines individually.
-        for (unsigned y = 0; y < Ny; y++)
+        // With vertical zero padding, the lower half of the rows is never read, and stays zero after the transform.
+        for (unsigned y = 0; y < horizontal_ny; y++)
         {
             cfloat *tin = in;
             cfloat *tout = out;
@@ -954,8 +3222,7 @@ void mufft_execute_plan_2d(mufft_plan_2d *plan, void * MUFFT_RESTRICT output, co
 
             for (unsigned i = 1; i < plan->num_steps_x; i++)
             {
-                const struct mufft_step_1d *step = &plan->steps_x[i];
-                step->func(tout + y * Nx, tin + y * Nx, ptx + step->twiddle_offset, step->p, Nx);
+                execute_step_1d(&plan->scale, plan->steps_x, i, tout + y * Nx, tin + y * Nx, ptx, Nx);
                 SWAP(tout, tin);
             }
         }
@@ -964,28 +3231,138 @@ void mufft_execute_plan_2d(mufft_plan_2d *plan, void * MUFFT_RESTRICT output, co
         {
             // Do Real-to-complex butterfly resolve.
             // Double the strides now.
-            for (unsigned y = 0; y < Ny; y++)
+            for (unsigned y = 0; y < horizontal_ny; y++)
             {
                 plan->r2c_resolve(hin + 2 * y * Nx, hout + y * Nx,
                         plan->r2c_twiddles, Nx);
             }
         }
 
-        // Since Nx is actually N / 2 if R2C, this is either Nx + 1 or Nx * 2 if we're doing R2C transform.
-        Nx = plan->vertical_nx;
+        // Vertical transforms, which land in output.
+        // Since Nx is actually N / 2 if R2C, this covers either Nx + 1 or Nx * 2 columns if we're doing R2C transform.
+        cfloat *buffers[2] = { output, plan->tmp_buffer };
+        execute_plan_2d_vertical(plan, output, vertical_stride_x, hin, vertical_stride_x, buffers, vertical_stride_x);
+    }
+
+    execute_scale_2d(plan, output);
+}
 
-        // Vertical transforms.
-        const struct mufft_step_2d *first_step = &plan->steps_y[0];
-        first_step->func(hout, hin, pty, 1, Nx, vertical_stride_x, Ny);
-        SWAP(hout, hin);
+/// \brief Transforms all columns along one strided axis of an N-dimensional plan.
+/// Step i writes to buffers[(first_buffer + i) & 1]. The first step reads from input.
+static void execute_axis_nd(const struct mufft_axis_nd *axis, cfloat * const *buffers, unsigned first_buffer,
+        const cfloat *input, unsigned row_stride)
+{
+    size_t outer_stride = (size_t)axis->N * axis->stride;
 
-        for (unsigned i = 1; i < plan->num_steps_y; i++)
+    for (unsigned o = 0; o < axis->num_outer; o++)
+    {
+        for (unsigned l = 0; l < axis->num_lines; l++)
         {
-            const struct mufft_step_2d *step = &plan->steps_y[i];
-            step->func(hout, hin, pty + step->twiddle_offset, step->p, Nx, vertical_stride_x, Ny);
-            SWAP(hout, hin);
+            // Run all passes over a block of columns before moving on to keep it in cache.
+            for (unsigned x = 0; x < axis->width; x += axis->block)
+            {
+                size_t offset = o * outer_stride + (size_t)l * row_stride + x;
+                unsigned samples_x = axis->width - x < axis->block ? axis->width - x : axis->block;
+
+                const cfloat *in = input + offset;
+                for (unsigned i = 0; i < axis->num_steps; i++)
+                {
+                    const struct mufft_step_2d *step = &axis->steps[i];
+                    cfloat *out = buffers[(first_buffer + i) & 1] + offset;
+                    step->func(out, in, axis->twiddles + step->twiddle_offset, step->p,
+                            samples_x, axis->stride, axis->stride, axis->N);
+                    in = out;
+                }
+            }
+        }
+    }
+}
+
+void mufft_execute_plan_nd(mufft_plan_nd *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input_)
+{
+    const cfloat *ptx = plan->twiddles_x;
+    const cfloat *input = input_;
+    cfloat *buffers[2] = { output, plan->tmp_buffer };
+
+    unsigned Nx = plan->Nx;
+    unsigned row_stride = plan->row_stride;
+    bool resolve = plan->r2c_resolve != NULL || plan->c2r_resolve != NULL;
+
+    // Every step ping-pongs between output and scratch, and we want the final step to write to output.
+    unsigned total_steps = plan->num_steps_x + resolve;
+    for (unsigned i = 0; i < plan->num_axes; i++)
+    {
+        total_steps += plan->axes[i].num_steps;
+    }
+    unsigned buffer = (total_steps - 1) & 1;
+
+    // If we're doing complex-to-real transform, we have to do the inverse transform along strided axes first,
+    // so the horizontal resolve sees conjugate symmetric rows.
+    if (plan->c2r_resolve != NULL)
+    {
+        for (unsigned i = 0; i < plan->num_axes; i++)
+        {
+            const struct mufft_axis_nd *axis = &plan->axes[i];
+            execute_axis_nd(axis, buffers, buffer, input, row_stride);
+            buffer ^= axis->num_steps & 1;
+            input = buffers[buffer ^ 1];
+        }
+    }
+
+    // Horizontal transforms over all rows individually, including resolve.
+    // Resolved complex-to-real rows are Nx complex samples apart. Everything else keeps rows row_stride apart.
+    unsigned input_row_stride = plan->r2c_resolve != NULL ? Nx : row_stride;
+    unsigned output_row_stride = plan->c2r_resolve != NULL ? Nx : row_stride;
+
+    for (unsigned y = 0; y < plan->num_rows; y++)
+    {
+        const cfloat *in = input + (size_t)y * input_row_stride;
+        unsigned row_buffer = buffer;
+
+        if (plan->c2r_resolve != NULL)
+        {
+            cfloat *out = buffers[row_buffer] + (size_t)y * output_row_stride;
+            plan->c2r_resolve(out, in, plan->r2c_twiddles, Nx);
+            in = out;
+            row_buffer ^= 1;
+        }
+
+        size_t offset = (size_t)y * output_row_stride;
+        for (unsigned i = 0; i < plan->num_steps_x; i++)
+        {
+            const struct mufft_step_1d *step = &plan->steps_x[i];
+            cfloat *out = buffers[row_buffer] + offset;
+            step->func(out, in, ptx + step->twiddle_offset, step->p, Nx);
+            in = out;
+            row_buffer ^= 1;
+        }
+
+        if (plan->r2c_resolve != NULL)
+        {
+            plan->r2c_resolve(buffers[row_buffer] + offset, in, plan->r2c_twiddles, Nx);
+        }
+    }
+
+    buffer ^= (plan->num_steps_x + resolve) & 1;
+    input = buffers[buffer ^ 1];
+
+    if (plan->c2r_resolve == NULL)
+    {
+        for (unsigned i = 0; i < plan->num_axes; i++)
+        {
+            const struct mufft_axis_nd *axis = &plan->axes[i];
+            execute_axis_nd(axis, buffers, buffer, input, row_stride);
+            buffer ^= axis->num_steps & 1;
+            input = buffers[buffer ^ 1];
         }
     }
+
+    mufft_assert(input == output);
+}
+
+void mufft_execute_plan_3d(mufft_plan_3d *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input)
+{
+    mufft_execute_plan_nd(plan, output, input);
 }
 
 void mufft_free_plan_1d(mufft_plan_1d *plan)
@@ -994,11 +3371,9 @@ void mufft_free_plan_1d(mufft_plan_1d *plan)
     {
         return;
     }
-    free(plan->steps);
-    mufft_free(plan->tmp_buffer);
-    mufft_free(plan->twiddles);
-    mufft_free(plan->r2c_twiddles);
-    mufft_free(plan);
+    release_twiddles(plan->twiddles);
+    release_twiddles(plan->r2c_twiddles);
+    free_plan_arena(plan);
 }
 
 void mufft_free_plan_2d(mufft_plan_2d *plan)
@@ -1007,13 +3382,30 @@ void mufft_free_plan_2d(mufft_plan_2d *plan)
     {
         return;
     }
-    free(plan->steps_x);
-    free(plan->steps_y);
-    mufft_free(plan->tmp_buffer);
-    mufft_free(plan->twiddles_x);
-    mufft_free(plan->twiddles_y);
-    mufft_free(plan->r2c_twiddles);
-    mufft_free(plan);
+    release_twiddles(plan->twiddles_x);
+    release_twiddles(plan->twiddles_y);
+    release_twiddles(plan->r2c_twiddles);
+    free_plan_arena(plan);
+}
+
+void mufft_free_plan_nd(mufft_plan_nd *plan)
+{
+    if (plan == NULL)
+    {
+        return;
+    }
+    for (unsigned i = 0; i < plan->num_axes; i++)
+    {
+        release_twiddles(plan->axes[i].twiddles);
+    }
+    release_twiddles(plan->twiddles_x);
+    release_twiddles(plan->r2c_twiddles);
+    free_plan_arena(plan);
+}
+
+void mufft_free_plan_3d(mufft_plan_3d *plan)
+{
+    mufft_free_plan_nd(plan);
 }
 
 void mufft_free_plan_conv(mufft_plan_conv *plan)
@@ -1025,17 +3417,307 @@ void mufft_free_plan_conv(mufft_plan_conv *plan)
     mufft_free_plan_1d(plan->plans[0]);
     mufft_free_plan_1d(plan->plans[1]);
     mufft_free_plan_1d(plan->output_plan);
-    mufft_free(plan->conv_block);
-    mufft_free(plan);
+    free_plan_arena(plan);
 }
 
-void *mufft_alloc(size_t size)
+int mufft_get_numa_node_plan_1d(const mufft_plan_1d *plan)
+{
+    int node = plan_arena_numa_node(plan);
+    if (node < 0 || !twiddles_on_numa_node(plan->twiddles, node) || !twiddles_on_numa_node(plan->r2c_twiddles, node))
+    {
+        return -1;
+    }
+    return node;
+}
+
+int mufft_get_numa_node_plan_2d(const mufft_plan_2d *plan)
+{
+    int node = plan_arena_numa_node(plan);
+    if (node < 0 || !twiddles_on_numa_node(plan->twiddles_x, node) || !twiddles_on_numa_node(plan->twiddles_y, node) ||
+            !twiddles_on_numa_node(plan->r2c_twiddles, node))
+    {
+        return -1;
+    }
+    return node;
+}
+
+int mufft_get_numa_node_plan_nd(const mufft_plan_nd *plan)
+{
+    int node = plan_arena_numa_node(plan);
+    if (node < 0 || !twiddles_on_numa_node(plan->twiddles_x, node) || !twiddles_on_numa_node(plan->r2c_twiddles, node))
+    {
+        return -1;
+    }
+    for (unsigned i = 0; i < plan->num_axes; i++)
+    {
+        if (!twiddles_on_numa_node(plan->axes[i].twiddles, node))
+        {
+            return -1;
+        }
+    }
+    return node;
+}
+
+int mufft_get_numa_node_plan_3d(const mufft_plan_3d *plan)
+{
+    return mufft_get_numa_node_plan_nd(plan);
+}
+
+int mufft_get_numa_node_plan_conv(const mufft_plan_conv *plan)
+{
+    int node = plan_arena_numa_node(plan);
+    if (node < 0 || mufft_get_numa_node_plan_1d(plan->plans[0]) != node ||
+            mufft_get_numa_node_plan_1d(plan->plans[1]) != node ||
+            mufft_get_numa_node_plan_1d(plan->output_plan) != node)
+    {
+        return -1;
+    }
+    return node;
+}
+
+mufft_plan_cache *mufft_create_plan_cache(void)
+{
+    const mufft_allocator allocator = global_allocator;
+    mufft_plan_cache *cache = alloc_record(&allocator, sizeof(*cache));
+    if (cache != NULL)
+    {
+        cache->allocator = allocator;
+    }
+    return cache;
+}
+
+/// \brief Creates a new plan for a \ref mufft_plan_cache.
+static void *create_cached_plan(unsigned dimensions, unsigned type, unsigned Nx, unsigned Ny, int direction, unsigned flags)
+{
+    switch (type)
+    {
+        case MUFFT_PLAN_TYPE_C2C:
+            return dimensions == 1 ? (void*)mufft_create_plan_1d_c2c(Nx, direction, flags) :
+                (void*)mufft_create_plan_2d_c2c(Nx, Ny, direction, flags);
+
+        case MUFFT_PLAN_TYPE_R2C:
+            return dimensions == 1 ? (void*)mufft_create_plan_1d_r2c(Nx, flags) :
+                (void*)mufft_create_plan_2d_r2c(Nx, Ny, flags);
+
+        case MUFFT_PLAN_TYPE_C2R:
+            return dimensions == 1 ? (void*)mufft_create_plan_1d_c2r(Nx, flags) :
+                (void*)mufft_create_plan_2d_c2r(Nx, Ny, flags);
+
+        default:
+            return NULL;
+    }
+}
+
+/// \brief Frees a plan created by \ref create_cached_plan.
+static void free_cached_plan(unsigned dimensions, void *plan)
+{
+    if (dimensions == 1)
+    {
+        mufft_free_plan_1d(plan);
+    }
+    else
+    {
+        mufft_free_plan_2d(plan);
+    }
+}
+
+/// \brief Picks the hash slot of a \ref mufft_plan_cache for a set of plan parameters.
+static unsigned plan_cache_slot(unsigned dimensions, unsigned type, unsigned Nx, unsigned Ny, int direction, unsigned flags)
+{
+    uint32_t hash = 2166136261u;
+    const uint32_t key[] = { dimensions, type, Nx, Ny, (uint32_t)direction, flags };
+    for (unsigned i = 0; i < ARRAY_SIZE(key); i++)
+    {
+        hash = (hash ^ key[i]) * 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & (MUFFT_PLAN_CACHE_SLOTS - 1);
+}
+
+/// \brief Finds the bucket for a set of plan parameters in a slot. The caller holds mufft_plan_cache_slot::lock.
+static struct mufft_plan_cache_bucket *find_plan_cache_bucket(const struct mufft_plan_cache_slot *slot,
+        unsigned dimensions, unsigned type, unsigned Nx, unsigned Ny, int direction, unsigned flags)
+{
+    for (struct mufft_plan_cache_bucket *bucket = slot->buckets; bucket != NULL; bucket = bucket->next)
+    {
+        if (bucket->dimensions == dimensions && bucket->type == type &&
+                bucket->Nx == Nx && bucket->Ny == Ny && bucket->direction == direction && bucket->flags == flags)
+        {
+            return bucket;
+        }
+    }
+    return NULL;
+}
+
+/// \brief Hands out an idle plan from the cache, or creates a new one.
+/// Plans with the same parameters share a bucket, which keeps its idle plans on a free list,
+/// so a lookup only walks the buckets of one hash slot and pops a plan, under that slot's lock.
+/// Planning happens without any lock held, so threads which find their plan never wait for planning.
+static void *acquire_cached_plan(mufft_plan_cache *cache, unsigned dimensions, unsigned type,
+        unsigned Nx, unsigned Ny, int direction, unsigned flags)
+{
+    if (type != MUFFT_PLAN_TYPE_C2C)
+    {
+        direction = 0;
+    }
+
+    unsigned slot_index = plan_cache_slot(dimensions, type, Nx, Ny, direction, flags);
+    struct mufft_plan_cache_slot *slot = &cache->slots[slot_index];
+
+    spin_lock(&slot->lock);
+    struct mufft_plan_cache_bucket *bucket = find_plan_cache_bucket(slot, dimensions, type, Nx, Ny, direction, flags);
+    if (bucket != NULL && bucket->idle != NULL)
+    {
+        struct mufft_plan_cache_entry *entry = bucket->idle;
+        bucket->idle = entry->next;
+        bucket->num_idle--;
+        bucket->num_in_use++;
+        spin_unlock(&slot->lock);
+        return entry->plan;
+    }
+    spin_unlock(&slot->lock);
+
+    struct mufft_plan_cache_entry *entry = alloc_record(&cache->allocator, sizeof(*entry));
+    struct mufft_plan_cache_bucket *new_bucket = bucket == NULL ? alloc_record(&cache->allocator, sizeof(*new_bucket)) : NULL;
+    if (entry == NULL || (bucket == NULL && new_bucket == NULL))
+    {
+        goto error;
+    }
+
+    entry->plan = create_cached_plan(dimensions, type, Nx, Ny, direction, flags);
+    if (entry->plan == NULL)
+    {
+        goto error;
+    }
+    plan_arena_header(entry->plan)->cache_entry = entry;
+
+    spin_lock(&slot->lock);
+    // Buckets are never removed, but another thread might have added this one in the meantime.
+    bucket = find_plan_cache_bucket(slot, dimensions, type, Nx, Ny, direction, flags);
+    if (bucket == NULL)
+    {
+        bucket = new_bucket;
+        new_bucket = NULL;
+        bucket->slot = slot_index;
+        bucket->dimensions = dimensions;
+        bucket->type = type;
+        bucket->Nx = Nx;
+        bucket->Ny = Ny;
+        bucket->direction = direction;
+        bucket->flags = flags;
+        bucket->next = slot->buckets;
+        slot->buckets = bucket;
+    }
+    bucket->num_in_use++;
+    entry->bucket = bucket;
+    spin_unlock(&slot->lock);
+
+    free_record(&cache->allocator, new_bucket);
+    return entry->plan;
+
+error:
+    free_record(&cache->allocator, entry);
+    free_record(&cache->allocator, new_bucket);
+    return NULL;
+}
+
+/// \brief Puts a plan from \ref acquire_cached_plan back on the free list of its bucket.
+/// If the bucket already holds \ref MUFFT_PLAN_CACHE_MAX_IDLE idle plans, the plan is freed instead,
+/// so a burst of concurrent requests does not keep its plans alive forever.
+static void release_cached_plan(mufft_plan_cache *cache, void *plan)
+{
+    if (plan == NULL)
+    {
+        return;
+    }
+
+    struct mufft_plan_cache_entry *entry = plan_arena_header(plan)->cache_entry;
+    mufft_assert(entry != NULL && entry->plan == plan);
+    struct mufft_plan_cache_bucket *bucket = entry->bucket;
+    struct mufft_plan_cache_slot *slot = &cache->slots[bucket->slot];
+
+    bool keep;
+    spin_lock(&slot->lock);
+    mufft_assert(bucket->num_in_use != 0);
+    bucket->num_in_use--;
+    keep = bucket->num_idle < MUFFT_PLAN_CACHE_MAX_IDLE;
+    if (keep)
+    {
+        entry->next = bucket->idle;
+        bucket->idle = entry;
+        bucket->num_idle++;
+    }
+    spin_unlock(&slot->lock);
+
+    if (!keep)
+    {
+        free_cached_plan(bucket->dimensions, plan);
+        free_record(&cache->allocator, entry);
+    }
+}
+
+mufft_plan_1d *mufft_plan_cache_acquire_1d(mufft_plan_cache *cache, unsigned type, unsigned N, int direction, unsigned flags)
+{
+    return acquire_cached_plan(cache, 1, type, N, 1, direction, flags);
+}
+
+void mufft_plan_cache_release_1d(mufft_plan_cache *cache, mufft_plan_1d *plan)
+{
+    release_cached_plan(cache, plan);
+}
+
+mufft_plan_2d *mufft_plan_cache_acquire_2d(mufft_plan_cache *cache, unsigned type, unsigned Nx, unsigned Ny,
+        int direction, unsigned flags)
+{
+    return acquire_cached_plan(cache, 2, type, Nx, Ny, direction, flags);
+}
+
+void mufft_plan_cache_release_2d(mufft_plan_cache *cache, mufft_plan_2d *plan)
+{
+    release_cached_plan(cache, plan);
+}
+
+void mufft_free_plan_cache(mufft_plan_cache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < MUFFT_PLAN_CACHE_SLOTS; i++)
+    {
+        struct mufft_plan_cache_bucket *bucket = cache->slots[i].buckets;
+        while (bucket != NULL)
+        {
+            struct mufft_plan_cache_bucket *next_bucket = bucket->next;
+            mufft_assert(bucket->num_in_use == 0);
+
+            struct mufft_plan_cache_entry *entry = bucket->idle;
+            while (entry != NULL)
+            {
+                struct mufft_plan_cache_entry *next = entry->next;
+                free_cached_plan(bucket->dimensions, entry->plan);
+                free_record(&cache->allocator, entry);
+                entry = next;
+            }
+
+            free_record(&cache->allocator, bucket);
+            bucket = next_bucket;
+        }
+    }
+
+    const mufft_allocator allocator = cache->allocator;
+    free_record(&allocator, cache);
+}
+
+static void *default_alloc(void *userdata, size_t size, size_t alignment)
 {
+    (void)userdata;
 #if defined(_ISOC11_SOURCE)
-    return aligned_alloc(MUFFT_ALIGNMENT, size);
+    // aligned_alloc() wants a size which is a multiple of the alignment.
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
 #elif (_POSIX_C_SOURCE >= 200112L) || (_XOPEN_SOURCE >= 600)
     void *ptr = NULL;
-    if (posix_memalign(&ptr, MUFFT_ALIGNMENT, size) < 0)
+    if (posix_memalign(&ptr, alignment, size) != 0)
     {
         return NULL;
     }
@@ -1044,15 +3726,15 @@ void *mufft_alloc(size_t size)
     // Align stuff ourselves. Kinda ugly, but will work anywhere.
     void **place;
     uintptr_t addr = 0;
-    void *ptr = malloc(MUFFT_ALIGNMENT + size + sizeof(uintptr_t));
+    void *ptr = malloc(alignment + size + sizeof(uintptr_t));
 
     if (ptr == NULL)
     {
         return NULL;
     }
 
-    addr = ((uintptr_t)ptr + sizeof(uintptr_t) + MUFFT_ALIGNMENT)
-        & ~(MUFFT_ALIGNMENT - 1);
+    addr = ((uintptr_t)ptr + sizeof(uintptr_t) + alignment)
+        & ~(alignment - 1);
     place = (void**)addr;
     place[-1] = ptr;
 
@@ -1060,6 +3742,41 @@ void *mufft_alloc(size_t size)
 #endif
 }
 
+static void default_free(void *userdata, void *ptr)
+{
+    (void)userdata;
+#if !defined(_ISOC11_SOURCE) && !((_POSIX_C_SOURCE >= 200112L) || (_XOPEN_SOURCE >= 600))
+    void **p = (void**)ptr;
+    free(p[-1]);
+#else
+    free(ptr);
+#endif
+}
+
+static mufft_allocator global_allocator = { default_alloc, default_free, NULL };
+
+void mufft_set_allocator(const mufft_allocator *allocator)
+{
+    if (allocator != NULL)
+    {
+        global_allocator = *allocator;
+    }
+    else
+    {
+        global_allocator = (mufft_allocator) { default_alloc, default_free, NULL };
+    }
+}
+
+void *mufft_alloc(size_t size)
+{
+    return global_allocator.alloc(global_allocator.userdata, size, MUFFT_ALIGNMENT);
+}
+
+void *mufft_alloc_huge(size_t size)
+{
+    return alloc_storage(&global_allocator, &size, true, MUFFT_NUMA_NODE_ANY);
+}
+
 void *mufft_calloc(size_t size)
 {
     void *ptr = mufft_alloc(size);
@@ -1072,14 +3789,9 @@ void *mufft_calloc(size_t size)
 
 void mufft_free(void *ptr)
 {
-#if !defined(_ISOC11_SOURCE) && !((_POSIX_C_SOURCE >= 200112L) || (_XOPEN_SOURCE >= 600))
     if (ptr != NULL)
     {
-        void **p = (void**)ptr;
-        free(p[-1]);
+        global_allocator.free(global_allocator.userdata, ptr);
     }
-#else
-    free(ptr);
-#endif
 }
 
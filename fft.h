@@ -61,13 +61,77 @@ extern "C" {
 /// The real-to-complex 1D transform will also output the redundant conjugate values X(N - k) = X(k)*.
 #define MUFFT_FLAG_FULL_R2C (1 << 16)
 /// The second/upper half of the input array is assumed to be 0 and will not be read and memory for the second half of the input array does not have to be allocated.
-/// This is mostly useful when you want to do zero-padded FFTs which are very common for convolution-type operations, see \ref MUFFT_CONV. This flag is only recognized for 1D transforms.
+/// This is mostly useful when you want to do zero-padded FFTs which are very common for convolution-type operations, see \ref MUFFT_CONV.
+/// For 2D complex-to-complex and real-to-complex transforms, the upper half of every row is assumed to be 0. It is ignored for complex-to-real transforms.
 #define MUFFT_FLAG_ZERO_PAD_UPPER_HALF (1 << 17)
+/// The lower half of the rows of a 2D input is assumed to be 0 and will not be read and memory for those rows does not have to be allocated.
+/// Combined with \ref MUFFT_FLAG_ZERO_PAD_UPPER_HALF, only the top-left quadrant of the input is read, which is the common case for 2D convolution.
+/// This flag is only recognized for 2D complex-to-complex and real-to-complex transforms.
+#define MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y (1 << 18)
+/// Rows of complex data in 2D real-to-complex output and complex-to-real input are only Nx / 2 + 1 samples long,
+/// which is the layout FFTW uses. muFFT still processes padded rows internally, and copies compact rows to or from them one tile at a time.
+/// The plan keeps a single image of padded rows as scratch, about half of what a plan without this flag needs.
+/// With this flag, the complex-to-real transform does not use the output buffer as scratch either.
+/// This flag is only recognized for 2D real-to-complex and complex-to-real transforms, and cannot be combined with \ref MUFFT_FLAG_FULL_R2C.
+#define MUFFT_FLAG_COMPACT_R2C (1 << 19)
+/// Use the transpose-based engine for 2D complex-to-complex transforms.
+/// Rows are transformed, the intermediate result is transposed with a cache-oblivious blocked transpose,
+/// the former columns are transformed as contiguous rows, and the result is transposed back.
+/// Without this flag, the planner only picks this engine when columns are too tall for strided vertical passes to stay in cache.
+/// This flag is ignored for pitched plans.
+#define MUFFT_FLAG_2D_TRANSPOSE (1 << 20)
+/// Like \ref MUFFT_FLAG_2D_TRANSPOSE, but the final transpose is skipped.
+/// The output is left as Nx rows of Ny samples, i.e. frequency (x, y) is found at output[x * Ny + y].
+/// This flag is only recognized for 2D complex-to-complex transforms which are not pitched. Creating any other plan with it fails.
+#define MUFFT_FLAG_2D_TRANSPOSED_OUTPUT (1 << 21)
+/// Scale the output by 1 / N, where N is the total number of samples in the transform (Nx * Ny for 2D transforms).
+/// A forward transform followed by a normalized inverse transform then gives back the original input.
+/// The scale is folded into one of the FFT steps, so it does not cost an extra pass over the data,
+/// except for transforms too small to have a step which can do it.
+/// This flag is only recognized for 1D and 2D transforms. Convolution plans ignore it, as their output is always normalized.
+#define MUFFT_FLAG_NORMALIZE (1 << 22)
+/// Scale the output by 1 / sqrt(N), which makes the transform orthonormal. Otherwise, the same as \ref MUFFT_FLAG_NORMALIZE.
+/// Cannot be combined with \ref MUFFT_FLAG_NORMALIZE.
+#define MUFFT_FLAG_NORMALIZE_ORTHO (1 << 23)
+/// Store the twiddle factors for large butterfly strides as a product of a small fine and a small coarse table,
+/// and reconstruct them on the fly. This costs a complex multiply per twiddle factor,
+/// but cuts the size of the twiddle factor table from N to roughly N / 64 complex samples,
+/// which keeps it out of the way of the data in cache for transforms of 2^16 samples and up.
+/// Smaller transforms are not affected.
+/// This flag is only recognized for 1D complex-to-complex, real-to-complex and complex-to-real transforms, and convolutions.
+/// Output pruned, 2D and N-dimensional plans ignore it.
+#define MUFFT_FLAG_COMPACT_TWIDDLES (1 << 29)
+/// Back the plan, its scratch buffer and newly built twiddle factor tables with 2 MB huge pages,
+/// which cuts TLB misses for large strided passes, e.g. 1D transforms of 2^22 samples and up, or large 2D transforms.
+/// Only allocations of at least 2 MB are affected, see \ref mufft_alloc_huge.
+/// Twiddle factor tables are shared between plans, so a table already built for a plan without this flag is reused as is.
+#define MUFFT_FLAG_HUGE_PAGES (1 << 30)
+/// Keep the memory a plan touches during execution on the NUMA node of the thread which creates the plan.
+/// The plan is placed for its creating thread: the node is queried once, with getcpu(), when the plan is created,
+/// and is not updated if threads move later. Create the plan on the thread which will execute it,
+/// after pinning that thread to its node.
+/// The plan's block, including its scratch buffer, is bound to that node with mbind(MPOL_PREFERRED) and faulted in right away,
+/// and twiddle factors come from a replica for that node, bound the same way, instead of a table shared by the whole process.
+/// Where the memory ended up can be checked with \ref mufft_get_numa_node_plan_1d and friends.
+/// Elsewhere than on Linux, and on single node machines, every thread is on node 0 and nothing is bound.
+#define MUFFT_FLAG_NUMA_LOCAL (1u << 31)
 /// @}
 
+/// \brief Memory allocation callbacks, see \ref mufft_set_allocator and the `_with_allocator` plan creation functions.
+typedef struct mufft_allocator
+{
+    /// \brief Allocates size bytes aligned to alignment, which is a power-of-two.
+    /// Returns `NULL` on failure.
+    void *(*alloc)(void *userdata, size_t size, size_t alignment);
+    /// \brief Frees memory obtained from alloc. ptr is never `NULL`.
+    void (*free)(void *userdata, void *ptr);
+    /// Opaque pointer passed to alloc and free.
+    void *userdata;
+} mufft_allocator;
+
 /// \addtogroup MUFFT_1D 1D real and complex FFT
 /// @{
-/// The FFT performed by these functions are not normalized.
+/// The FFT performed by these functions are not normalized, unless \ref MUFFT_FLAG_NORMALIZE or \ref MUFFT_FLAG_NORMALIZE_ORTHO is used.
 /// A forward transform followed by an inverse transform will scale the output by the transform size.
 /// The FFTs implemented take input in regular order, no permutation step is required.
 /// Similarly, the output of the FFT is in regular order, without any permutation.
@@ -85,6 +149,15 @@ typedef struct mufft_plan_1d mufft_plan_1d;
 /// @returns A 1D transform plan, or `NULL` if an error occured.
 mufft_plan_1d *mufft_create_plan_1d_c2c(unsigned N, int direction, unsigned flags);
 
+/// \brief Same as \ref mufft_create_plan_1d_c2c, but the plan is allocated with allocator.
+/// The allocator is copied into the plan, and is used to free it again in \ref mufft_free_plan_1d.
+/// Twiddle factor tables are the one exception. They are shared between all plans which need them,
+/// no matter which allocator those plans were created with, so they always come from the global allocator,
+/// see \ref mufft_set_allocator, and are freed with it even if it has changed since. Any scratch a plan variant needs on top, e.g. for pruned or pitched plans, comes from allocator.
+/// @param allocator The allocator to use. If `NULL`, the global allocator is used.
+mufft_plan_1d *mufft_create_plan_1d_c2c_with_allocator(unsigned N, int direction, unsigned flags,
+        const mufft_allocator *allocator);
+
 /// \brief Create a plan for real-to-complex forward transform.
 ///
 /// The real-to-complex transform is optimized for the case when the input data to the transform is purely real.
@@ -98,6 +171,10 @@ mufft_plan_1d *mufft_create_plan_1d_c2c(unsigned N, int direction, unsigned flag
 /// @returns A 1D transform plan, or `NULL` if an error occured.
 mufft_plan_1d *mufft_create_plan_1d_r2c(unsigned N, unsigned flags);
 
+/// \brief Same as \ref mufft_create_plan_1d_r2c, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_1d *mufft_create_plan_1d_r2c_with_allocator(unsigned N, unsigned flags, const mufft_allocator *allocator);
+
 /// \brief Create a plan for complex-to-real inverse transform.
 ///
 /// The complex-to-real transform is optimized for the case when the output data of the transform is purely real.
@@ -110,11 +187,81 @@ mufft_plan_1d *mufft_create_plan_1d_r2c(unsigned N, unsigned flags);
 /// @returns A 1D transform plan, or `NULL` if an error occured.
 mufft_plan_1d *mufft_create_plan_1d_c2r(unsigned N, unsigned flags);
 
+/// \brief Same as \ref mufft_create_plan_1d_c2r, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_1d *mufft_create_plan_1d_c2r_with_allocator(unsigned N, unsigned flags, const mufft_allocator *allocator);
+
+/// \brief Create a plan for a 1D complex-to-complex FFT where only a prefix of the input is non-zero.
+///
+/// This generalizes \ref MUFFT_FLAG_ZERO_PAD_UPPER_HALF to any amount of zero padding.
+/// The input is assumed to be zero from input_length and up, and this part of the input array will not be read.
+/// Memory for it does not have to be allocated.
+/// The first log2(N / input_length) passes of the FFT only ever see one non-zero input per butterfly, so they are skipped,
+/// and the first pass computed reads the non-zero input directly.
+/// If input_length is not a power-of-two, the input is copied and padded internally before the first pass.
+///
+/// @param N The transform size. Must be power-of-two and at least 2.
+/// @param direction Forward (\ref MUFFT_FORWARD) or inverse (\ref MUFFT_INVERSE) transform.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG. \ref MUFFT_FLAG_ZERO_PAD_UPPER_HALF is ignored.
+/// @param input_length Number of complex input samples which can be non-zero. Must be in the range [1, N].
+/// @returns A 1D transform plan, or `NULL` if an error occured.
+mufft_plan_1d *mufft_create_plan_1d_c2c_zero_pad(unsigned N, int direction, unsigned flags, unsigned input_length);
+
+/// \brief Same as \ref mufft_create_plan_1d_c2c_zero_pad, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_1d *mufft_create_plan_1d_c2c_zero_pad_with_allocator(unsigned N, int direction, unsigned flags,
+        unsigned input_length, const mufft_allocator *allocator);
+
+/// \brief Create a plan for real-to-complex forward transform where only a prefix of the input is non-zero.
+///
+/// Same as \ref mufft_create_plan_1d_r2c, but the input is assumed to be zero from input_length and up.
+/// See \ref mufft_create_plan_1d_c2c_zero_pad for details.
+///
+/// @param N The transform size. Must be power-of-two and at least 4.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG. \ref MUFFT_FLAG_ZERO_PAD_UPPER_HALF is ignored.
+/// @param input_length Number of real input samples which can be non-zero. Must be in the range [1, N].
+/// @returns A 1D transform plan, or `NULL` if an error occured.
+mufft_plan_1d *mufft_create_plan_1d_r2c_zero_pad(unsigned N, unsigned flags, unsigned input_length);
+
+/// \brief Same as \ref mufft_create_plan_1d_r2c_zero_pad, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_1d *mufft_create_plan_1d_r2c_zero_pad_with_allocator(unsigned N, unsigned flags, unsigned input_length,
+        const mufft_allocator *allocator);
+
+/// \brief Create a plan for a 1D complex-to-complex FFT which only computes a range of output bins.
+///
+/// This is the output side counterpart of \ref MUFFT_FLAG_ZERO_PAD_UPPER_HALF.
+/// The last FFT steps are pruned away when their results are mostly never read,
+/// and the requested bins are finished with a direct partial DFT instead.
+/// If only a handful of bins are requested, the transform degenerates to a plain partial DFT of the input.
+///
+/// @param N The transform size. Must be power-of-two and at least 2.
+/// @param direction Forward (\ref MUFFT_FORWARD) or inverse (\ref MUFFT_INVERSE) transform.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @param first_bin The first output bin to compute. Must be less than N.
+/// @param num_bins Number of consecutive output bins to compute. Must be in the range [1, N].
+/// Bins wrap around modulo N, so a band around DC can be requested with first_bin = N - k.
+/// The output of \ref mufft_execute_plan_1d will only contain num_bins complex values,
+/// with X[first_bin] stored first.
+/// @returns A 1D transform plan, or `NULL` if an error occured.
+mufft_plan_1d *mufft_create_plan_1d_c2c_pruned(unsigned N, int direction, unsigned flags,
+        unsigned first_bin, unsigned num_bins);
+
+/// \brief Same as \ref mufft_create_plan_1d_c2c_pruned, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_1d *mufft_create_plan_1d_c2c_pruned_with_allocator(unsigned N, int direction, unsigned flags,
+        unsigned first_bin, unsigned num_bins, const mufft_allocator *allocator);
+
 /// \brief Executes a 1D FFT plan.
+///
+/// The transform can be done in place by passing the same buffer as input and output.
+/// The buffer must then be large enough to hold both the input and the output of the transform,
+/// e.g. N / 2 + 1 complex samples for real-to-complex and complex-to-real transforms.
+/// Otherwise, input and output must not overlap.
 /// @param plan Previously allocated 1D FFT plan.
 /// @param output Output of the transform. The data must be aligned. See \ref MUFFT_MEMORY.
 /// @param input Input to the transform. The data must be aligned. See \ref MUFFT_MEMORY.
-void mufft_execute_plan_1d(mufft_plan_1d *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input);
+void mufft_execute_plan_1d(mufft_plan_1d *plan, void *output, const void *input);
 
 /// \brief Free a previously allocated 1D FFT plan.
 /// @param plan A plan. May be `NULL` in which case nothing happens.
@@ -167,6 +314,11 @@ typedef struct mufft_plan_conv mufft_plan_conv;
 /// @returns An instance of a convolution plan, or `NULL` if failed.
 mufft_plan_conv *mufft_create_plan_conv(unsigned N, unsigned flags, unsigned method);
 
+/// \brief Same as \ref mufft_create_plan_conv, but the plan and its FFT plans are allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_conv *mufft_create_plan_conv_with_allocator(unsigned N, unsigned flags, unsigned method,
+        const mufft_allocator *allocator);
+
 /// \brief Applies forward FFT of either first or second input block.
 /// 
 /// When doing block-based overlap-add convolution with FFTs the filter generally stays constant over many transforms.
@@ -209,7 +361,7 @@ mufft_convolve_func mufft_get_convolve_func(unsigned flags);
 
 /// \addtogroup MUFFT_2D 2D real and complex FFT
 /// @{
-/// The FFT performed by these functions are not normalized.
+/// The FFT performed by these functions are not normalized, unless \ref MUFFT_FLAG_NORMALIZE or \ref MUFFT_FLAG_NORMALIZE_ORTHO is used.
 /// A forward transform followed by an inverse transform will scale the output by the transform size (Nx * Ny).
 /// The FFTs implemented take input in regular order, no permutation step is required.
 /// Similarly, the output of the FFT is in regular order, without any permutation.
@@ -231,6 +383,11 @@ typedef struct mufft_plan_2d mufft_plan_2d;
 /// @returns A 2D transform plan, or `NULL` if an error occured.
 mufft_plan_2d *mufft_create_plan_2d_c2c(unsigned Nx, unsigned Ny, int direction, unsigned flags);
 
+/// \brief Same as \ref mufft_create_plan_2d_c2c, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_2d *mufft_create_plan_2d_c2c_with_allocator(unsigned Nx, unsigned Ny, int direction, unsigned flags,
+        const mufft_allocator *allocator);
+
 /// \brief Create a plan for a 2D real-to-complex forward FFT.
 ///
 /// The input and output data to the 2D transform is represented as a row-major array.
@@ -241,6 +398,7 @@ mufft_plan_2d *mufft_create_plan_2d_c2c(unsigned Nx, unsigned Ny, int direction,
 /// The vertical transform will only transform the first N / 2 + D columns,
 /// where D is some convenient value which aligns well to the SIMD instruction set used.
 /// The full N complex samples can be processed vertically as well if \ref MUFFT_FLAG_FULL_R2C is used.
+/// If \ref MUFFT_FLAG_COMPACT_R2C is used, rows of the output are only N / 2 + 1 complex samples long instead.
 /// 
 /// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 4.
 /// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
@@ -248,6 +406,11 @@ mufft_plan_2d *mufft_create_plan_2d_c2c(unsigned Nx, unsigned Ny, int direction,
 /// @returns A 2D transform plan, or `NULL` if an error occured.
 mufft_plan_2d *mufft_create_plan_2d_r2c(unsigned Nx, unsigned Ny, unsigned flags);
 
+/// \brief Same as \ref mufft_create_plan_2d_r2c, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_2d *mufft_create_plan_2d_r2c_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        const mufft_allocator *allocator);
+
 /// \brief Create a plan for a 2D complex-to-real inverse FFT.
 ///
 /// The input and output data to the 2D transform is represented as a row-major array.
@@ -258,6 +421,8 @@ mufft_plan_2d *mufft_create_plan_2d_r2c(unsigned Nx, unsigned Ny, unsigned flags
 /// The output array needs a minimum size of 2 * Nx * Ny * sizeof(float) and not the expected Nx * Ny * sizeof(float).
 /// muFFT uses the output buffer as a scratch buffer during the FFT computation.
 /// The end result however, will only require Nx * Ny * sizeof(float) size.
+/// If \ref MUFFT_FLAG_COMPACT_R2C is used, rows of the input are only N / 2 + 1 complex samples long,
+/// and the output only needs room for Nx * Ny * sizeof(float).
 /// 
 /// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 4.
 /// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
@@ -265,26 +430,319 @@ mufft_plan_2d *mufft_create_plan_2d_r2c(unsigned Nx, unsigned Ny, unsigned flags
 /// @returns A 2D transform plan, or `NULL` if an error occured.
 mufft_plan_2d *mufft_create_plan_2d_c2r(unsigned Nx, unsigned Ny, unsigned flags);
 
+/// \brief Same as \ref mufft_create_plan_2d_c2r, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_2d *mufft_create_plan_2d_c2r_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        const mufft_allocator *allocator);
+
+/// \brief Create a plan for a 2D complex-to-complex inverse or forward FFT on pitched rows.
+///
+/// Like \ref mufft_create_plan_2d_c2c, but rows of input and output may be further apart than Nx complex samples,
+/// e.g. when the data is a region of interest in a larger image or a capture buffer with padded rows.
+/// The start of every row in both input and output must be aligned, see \ref MUFFT_MEMORY.
+/// Pitched plans only read input during the first pass and only write output during the last pass,
+/// so input and output may point to the same rows, i.e. the transform may be done in place.
+///
+/// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 2.
+/// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
+/// @param direction Forward (\ref MUFFT_FORWARD) or inverse (\ref MUFFT_INVERSE) transform.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @param input_pitch Distance between two input rows in complex samples. Must be at least Nx.
+/// @param output_pitch Distance between two output rows in complex samples. Must be at least Nx.
+/// @returns A 2D transform plan, or `NULL` if an error occured.
+mufft_plan_2d *mufft_create_plan_2d_c2c_pitched(unsigned Nx, unsigned Ny, int direction, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch);
+
+/// \brief Same as \ref mufft_create_plan_2d_c2c_pitched, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_2d *mufft_create_plan_2d_c2c_pitched_with_allocator(unsigned Nx, unsigned Ny, int direction, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch, const mufft_allocator *allocator);
+
+/// \brief Create a plan for a 2D real-to-complex forward FFT on pitched rows.
+///
+/// Like \ref mufft_create_plan_2d_r2c, but rows of input and output may be further apart than usual.
+/// The start of every row in both input and output must be aligned, see \ref MUFFT_MEMORY.
+/// As for \ref mufft_create_plan_2d_r2c, every output row needs room for Nx complex samples,
+/// or Nx / 2 + 1 complex samples if \ref MUFFT_FLAG_COMPACT_R2C is used. Output rows do not have to be aligned in the latter case.
+///
+/// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 4.
+/// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @param input_pitch Distance between two input rows in real samples. Must be at least Nx.
+/// @param output_pitch Distance between two output rows in complex samples. Must be at least Nx, or Nx / 2 + 1 for compact output.
+/// @returns A 2D transform plan, or `NULL` if an error occured.
+mufft_plan_2d *mufft_create_plan_2d_r2c_pitched(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch);
+
+/// \brief Same as \ref mufft_create_plan_2d_r2c_pitched, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_2d *mufft_create_plan_2d_r2c_pitched_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch, const mufft_allocator *allocator);
+
+/// \brief Create a plan for a 2D complex-to-real inverse FFT on pitched rows.
+///
+/// Like \ref mufft_create_plan_2d_c2r, but rows of input and output may be further apart than usual.
+/// The start of every row in both input and output must be aligned, see \ref MUFFT_MEMORY.
+/// As for \ref mufft_create_plan_2d_c2r, every input row is expected to contain Nx columns of padded complex data,
+/// or Nx / 2 + 1 columns if \ref MUFFT_FLAG_COMPACT_R2C is used. Input rows do not have to be aligned in the latter case.
+/// Unlike \ref mufft_create_plan_2d_c2r, the output buffer is not used as scratch,
+/// and only Nx real samples are written per row.
+///
+/// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 4.
+/// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @param input_pitch Distance between two input rows in complex samples. Must be at least Nx, or Nx / 2 + 1 for compact input.
+/// @param output_pitch Distance between two output rows in real samples. Must be at least Nx.
+/// @returns A 2D transform plan, or `NULL` if an error occured.
+mufft_plan_2d *mufft_create_plan_2d_c2r_pitched(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch);
+
+/// \brief Same as \ref mufft_create_plan_2d_c2r_pitched, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_2d *mufft_create_plan_2d_c2r_pitched_with_allocator(unsigned Nx, unsigned Ny, unsigned flags,
+        unsigned input_pitch, unsigned output_pitch, const mufft_allocator *allocator);
+
 /// \brief Executes a 2D FFT plan.
+///
+/// The transform can be done in place by passing the same buffer as input and output.
+/// The buffer must then be large enough to hold both the input and the output of the transform.
+/// Otherwise, input and output must not overlap, except for pitched plans, see \ref mufft_create_plan_2d_c2c_pitched.
 /// @param plan Previously allocated 2D FFT plan.
 /// @param output Output of the transform. The data must be aligned. See \ref MUFFT_MEMORY.
 /// @param input Input to the transform. The data must be aligned. See \ref MUFFT_MEMORY.
-void mufft_execute_plan_2d(mufft_plan_2d *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input);
+void mufft_execute_plan_2d(mufft_plan_2d *plan, void *output, const void *input);
 
 /// \brief Free a previously allocated 2D FFT plan.
 /// @param plan A plan. May be `NULL` in which case nothing happens.
 void mufft_free_plan_2d(mufft_plan_2d *plan);
 /// @}
 
+/// \addtogroup MUFFT_ND 3D and N-dimensional real and complex FFT
+/// @{
+/// The FFT performed by these functions are not normalized.
+/// A forward transform followed by an inverse transform will scale the output by the total transform size.
+/// Data is laid out as a row-major array, where the first dimension (X) is the contiguous one.
+/// The layout of real-to-complex and complex-to-real data follows the 2D transforms,
+/// i.e. rows of complex data are padded to Nx complex samples, see \ref mufft_create_plan_2d_r2c and \ref mufft_create_plan_2d_c2r.
+/// Rows are transformed with the regular horizontal kernels, and all other axes are transformed with strided kernels
+/// a few columns at a time, so that all passes over those columns stay in cache.
+
+/// Opaque type representing an N-dimensional FFT.
+typedef struct mufft_plan_nd mufft_plan_nd;
+/// Opaque type representing a 3D FFT. It is the same type as \ref mufft_plan_nd.
+typedef struct mufft_plan_nd mufft_plan_3d;
+
+/// \brief Create a plan for an N-dimensional complex-to-complex inverse or forward FFT.
+///
+/// @param dimensions Number of dimensions. Must be at least 1.
+/// @param N Array of dimensions transform sizes, from fastest to slowest varying. All sizes must be power-of-two and at least 2.
+/// @param direction Forward (\ref MUFFT_FORWARD) or inverse (\ref MUFFT_INVERSE) transform.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @returns An N-dimensional transform plan, or `NULL` if an error occured.
+mufft_plan_nd *mufft_create_plan_nd_c2c(unsigned dimensions, const unsigned *N, int direction, unsigned flags);
+
+/// \brief Same as \ref mufft_create_plan_nd_c2c, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_nd *mufft_create_plan_nd_c2c_with_allocator(unsigned dimensions, const unsigned *N, int direction,
+        unsigned flags, const mufft_allocator *allocator);
+
+/// \brief Create a plan for an N-dimensional real-to-complex forward FFT.
+///
+/// @param dimensions Number of dimensions. Must be at least 1.
+/// @param N Array of dimensions transform sizes, from fastest to slowest varying.
+/// N[0] must be power-of-two and at least 4. The other sizes must be power-of-two and at least 2.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG. If \ref MUFFT_FLAG_FULL_R2C flag is added, the transform will output the full N[0] complex frequency samples for every row.
+/// @returns An N-dimensional transform plan, or `NULL` if an error occured.
+mufft_plan_nd *mufft_create_plan_nd_r2c(unsigned dimensions, const unsigned *N, unsigned flags);
+
+/// \brief Same as \ref mufft_create_plan_nd_r2c, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_nd *mufft_create_plan_nd_r2c_with_allocator(unsigned dimensions, const unsigned *N, unsigned flags,
+        const mufft_allocator *allocator);
+
+/// \brief Create a plan for an N-dimensional complex-to-real inverse FFT.
+///
+/// As for \ref mufft_create_plan_2d_c2r, the output buffer is used as scratch and needs room for twice the number of real samples.
+///
+/// @param dimensions Number of dimensions. Must be at least 1.
+/// @param N Array of dimensions transform sizes, from fastest to slowest varying.
+/// N[0] must be power-of-two and at least 4. The other sizes must be power-of-two and at least 2.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @returns An N-dimensional transform plan, or `NULL` if an error occured.
+mufft_plan_nd *mufft_create_plan_nd_c2r(unsigned dimensions, const unsigned *N, unsigned flags);
+
+/// \brief Same as \ref mufft_create_plan_nd_c2r, but the plan is allocated with allocator.
+/// See \ref mufft_create_plan_1d_c2c_with_allocator for details.
+mufft_plan_nd *mufft_create_plan_nd_c2r_with_allocator(unsigned dimensions, const unsigned *N, unsigned flags,
+        const mufft_allocator *allocator);
+
+/// \brief Executes an N-dimensional FFT plan.
+/// @param plan Previously allocated N-dimensional FFT plan.
+/// @param output Output of the transform. The data must be aligned. See \ref MUFFT_MEMORY.
+/// @param input Input to the transform. The data must be aligned. See \ref MUFFT_MEMORY.
+void mufft_execute_plan_nd(mufft_plan_nd *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input);
+
+/// \brief Free a previously allocated N-dimensional FFT plan.
+/// @param plan A plan. May be `NULL` in which case nothing happens.
+void mufft_free_plan_nd(mufft_plan_nd *plan);
+
+/// \brief Create a plan for a 3D complex-to-complex inverse or forward FFT.
+/// Same as \ref mufft_create_plan_nd_c2c with N = { Nx, Ny, Nz }.
+/// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 2.
+/// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
+/// @param Nz The transform size in Z dimension (number of planes). Must be power-of-two and at least 2.
+/// @param direction Forward (\ref MUFFT_FORWARD) or inverse (\ref MUFFT_INVERSE) transform.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @returns A 3D transform plan, or `NULL` if an error occured.
+mufft_plan_3d *mufft_create_plan_3d_c2c(unsigned Nx, unsigned Ny, unsigned Nz, int direction, unsigned flags);
+
+/// \brief Create a plan for a 3D real-to-complex forward FFT.
+/// Same as \ref mufft_create_plan_nd_r2c with N = { Nx, Ny, Nz }.
+/// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 4.
+/// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
+/// @param Nz The transform size in Z dimension (number of planes). Must be power-of-two and at least 2.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @returns A 3D transform plan, or `NULL` if an error occured.
+mufft_plan_3d *mufft_create_plan_3d_r2c(unsigned Nx, unsigned Ny, unsigned Nz, unsigned flags);
+
+/// \brief Create a plan for a 3D complex-to-real inverse FFT.
+/// Same as \ref mufft_create_plan_nd_c2r with N = { Nx, Ny, Nz }.
+/// @param Nx The transform size in X dimension (number of columns). Must be power-of-two and at least 4.
+/// @param Ny The transform size in Y dimension (number of rows). Must be power-of-two and at least 2.
+/// @param Nz The transform size in Z dimension (number of planes). Must be power-of-two and at least 2.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @returns A 3D transform plan, or `NULL` if an error occured.
+mufft_plan_3d *mufft_create_plan_3d_c2r(unsigned Nx, unsigned Ny, unsigned Nz, unsigned flags);
+
+/// \brief Executes a 3D FFT plan.
+/// @param plan Previously allocated 3D FFT plan.
+/// @param output Output of the transform. The data must be aligned. See \ref MUFFT_MEMORY.
+/// @param input Input to the transform. The data must be aligned. See \ref MUFFT_MEMORY.
+void mufft_execute_plan_3d(mufft_plan_3d *plan, void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input);
+
+/// \brief Free a previously allocated 3D FFT plan.
+/// @param plan A plan. May be `NULL` in which case nothing happens.
+void mufft_free_plan_3d(mufft_plan_3d *plan);
+/// @}
+
+/// \addtogroup MUFFT_PLAN_CACHE Plan cache
+/// @{
+/// A plan cache keeps 1D and 2D plans around for reuse, so that code which repeatedly needs plans for the same handful
+/// of sizes does not pay for planning, allocation and twiddle factor generation every time.
+///
+/// Executing a plan uses its internal scratch buffer, so a plan can only be used by one thread at a time.
+/// The cache hands out a plan for exclusive use until it is released back to the cache.
+/// If all plans matching a request are in use, a new plan is created.
+/// Once released, at most \ref MUFFT_PLAN_CACHE_MAX_IDLE idle plans are kept for every combination of type, size,
+/// direction and flags. Plans released beyond that are freed.
+/// Plans obtained from a cache must not be freed with the regular free functions.
+///
+/// All plan cache functions are thread-safe. Creating a plan does not block other threads from looking up plans.
+
+/// Complex-to-complex transform, see \ref mufft_create_plan_1d_c2c and \ref mufft_create_plan_2d_c2c.
+#define MUFFT_PLAN_TYPE_C2C 0
+/// Real-to-complex transform, see \ref mufft_create_plan_1d_r2c and \ref mufft_create_plan_2d_r2c.
+#define MUFFT_PLAN_TYPE_R2C 1
+/// Complex-to-real transform, see \ref mufft_create_plan_1d_c2r and \ref mufft_create_plan_2d_c2r.
+#define MUFFT_PLAN_TYPE_C2R 2
+
+/// Maximum number of idle plans a plan cache keeps for every combination of type, size, direction and flags.
+#define MUFFT_PLAN_CACHE_MAX_IDLE 8
+
+/// Opaque type representing a plan cache.
+typedef struct mufft_plan_cache mufft_plan_cache;
+
+/// \brief Create an empty plan cache.
+/// @returns A plan cache, or `NULL` if an error occured.
+mufft_plan_cache *mufft_create_plan_cache(void);
+
+/// \brief Get a 1D plan from the cache for exclusive use, creating it if needed.
+/// @param cache A plan cache.
+/// @param type Type of transform, \ref MUFFT_PLAN_TYPE_C2C, \ref MUFFT_PLAN_TYPE_R2C or \ref MUFFT_PLAN_TYPE_C2R.
+/// @param N The transform size, as for the regular plan creation functions.
+/// @param direction Forward (\ref MUFFT_FORWARD) or inverse (\ref MUFFT_INVERSE) transform. Ignored unless type is \ref MUFFT_PLAN_TYPE_C2C.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @returns A 1D transform plan, or `NULL` if an error occured. Must be given back with \ref mufft_plan_cache_release_1d.
+mufft_plan_1d *mufft_plan_cache_acquire_1d(mufft_plan_cache *cache, unsigned type, unsigned N, int direction, unsigned flags);
+
+/// \brief Give a plan from \ref mufft_plan_cache_acquire_1d back to the cache.
+/// @param cache The plan cache the plan was obtained from.
+/// @param plan A plan. May be `NULL` in which case nothing happens.
+void mufft_plan_cache_release_1d(mufft_plan_cache *cache, mufft_plan_1d *plan);
+
+/// \brief Get a 2D plan from the cache for exclusive use, creating it if needed.
+/// @param cache A plan cache.
+/// @param type Type of transform, \ref MUFFT_PLAN_TYPE_C2C, \ref MUFFT_PLAN_TYPE_R2C or \ref MUFFT_PLAN_TYPE_C2R.
+/// @param Nx The transform size in X dimension, as for the regular plan creation functions.
+/// @param Ny The transform size in Y dimension, as for the regular plan creation functions.
+/// @param direction Forward (\ref MUFFT_FORWARD) or inverse (\ref MUFFT_INVERSE) transform. Ignored unless type is \ref MUFFT_PLAN_TYPE_C2C.
+/// @param flags Flags for the planning. See \ref MUFFT_FLAG.
+/// @returns A 2D transform plan, or `NULL` if an error occured. Must be given back with \ref mufft_plan_cache_release_2d.
+mufft_plan_2d *mufft_plan_cache_acquire_2d(mufft_plan_cache *cache, unsigned type, unsigned Nx, unsigned Ny,
+        int direction, unsigned flags);
+
+/// \brief Give a plan from \ref mufft_plan_cache_acquire_2d back to the cache.
+/// @param cache The plan cache the plan was obtained from.
+/// @param plan A plan. May be `NULL` in which case nothing happens.
+void mufft_plan_cache_release_2d(mufft_plan_cache *cache, mufft_plan_2d *plan);
+
+/// \brief Free a plan cache and all plans in it. No plans from the cache may be in use.
+/// @param cache A plan cache. May be `NULL` in which case nothing happens.
+void mufft_free_plan_cache(mufft_plan_cache *cache);
+/// @}
+
+/// \addtogroup MUFFT_NUMA NUMA placement
+/// @{
+
+/// \brief Get the NUMA node the memory of a plan created with \ref MUFFT_FLAG_NUMA_LOCAL is placed on.
+/// This is the node the creating thread ran on. Placement is verified with get_mempolicy(),
+/// for the plan's own block as well as its twiddle factor tables.
+/// @param plan A 1D plan.
+/// @returns The node, or -1 if the plan was created without \ref MUFFT_FLAG_NUMA_LOCAL,
+/// if some of its memory is not on that node, e.g. because the node ran out of memory,
+/// or if placement cannot be queried on this platform.
+int mufft_get_numa_node_plan_1d(const mufft_plan_1d *plan);
+
+/// \brief Same as \ref mufft_get_numa_node_plan_1d, but for 2D plans.
+int mufft_get_numa_node_plan_2d(const mufft_plan_2d *plan);
+
+/// \brief Same as \ref mufft_get_numa_node_plan_1d, but for N-dimensional plans.
+int mufft_get_numa_node_plan_nd(const mufft_plan_nd *plan);
+
+/// \brief Same as \ref mufft_get_numa_node_plan_1d, but for 3D plans.
+int mufft_get_numa_node_plan_3d(const mufft_plan_3d *plan);
+
+/// \brief Same as \ref mufft_get_numa_node_plan_1d, but for convolution plans. All three inner plans are checked as well.
+int mufft_get_numa_node_plan_conv(const mufft_plan_conv *plan);
+/// @}
+
 /// \addtogroup MUFFT_MEMORY Memory allocation
 /// @{
 
+/// \brief Replaces the global allocator.
+/// The global allocator backs \ref mufft_alloc, twiddle factor tables, plan caches,
+/// and every plan which is not created with an explicit allocator.
+/// It must not be changed while other threads use muFFT.
+/// Plans, plan caches and twiddle factor tables remember the allocator they were created with,
+/// so they can still be freed after a change. Storage from \ref mufft_alloc must be freed before the change.
+/// @param allocator The new allocator, which is copied. If `NULL`, the default aligned system allocator is restored.
+void mufft_set_allocator(const mufft_allocator *allocator);
+
 /// \brief Allocate aligned storage suitable for muFFT.
 /// Must be freed with \ref mufft_free.
 /// @param size Number of bytes to allocate.
 /// @returns Allocated storage, or `NULL`.
 void *mufft_alloc(size_t size);
 
+/// \brief Allocate storage suitable for muFFT, backed by 2 MB huge pages if possible.
+/// Storage of at least 2 MB is aligned to and padded out to whole huge pages,
+/// and on Linux the kernel is asked to back it with transparent huge pages (`madvise(MADV_HUGEPAGE)`).
+/// If that is not possible, regular pages are used. Smaller storage is allocated as with \ref mufft_alloc.
+/// Storage comes from the global allocator, see \ref mufft_set_allocator, and must be freed with \ref mufft_free.
+/// @param size Number of bytes to allocate.
+/// @returns Allocated storage, or `NULL`.
+void *mufft_alloc_huge(size_t size);
+
 /// \brief Allocate zeroed out aligned storage suitable for muFFT.
 /// Same as calloc(), but aligned.
 /// Must be freed with \ref mufft_free.
@@ -297,6 +755,45 @@ void *mufft_calloc(size_t size);
 void mufft_free(void *ptr);
 /// @}
 
+/// \addtogroup MUFFT_CPU Host CPU information
+/// @{
+
+/// The CPU supports the AVX instruction set and muFFT uses it. Uses the bit of \ref MUFFT_FLAG_CPU_NO_AVX.
+#define MUFFT_CPU_HAS_AVX (1 << 0)
+/// The CPU supports the SSE3 instruction set and muFFT uses it. Uses the bit of \ref MUFFT_FLAG_CPU_NO_SSE3.
+#define MUFFT_CPU_HAS_SSE3 (1 << 1)
+/// The CPU supports the SSE instruction set and muFFT uses it. Uses the bit of \ref MUFFT_FLAG_CPU_NO_SSE.
+#define MUFFT_CPU_HAS_SSE (1 << 2)
+
+/// \brief Describes the CPU muFFT runs on, see \ref mufft_get_cpu_info.
+/// Anything which could not be detected is 0.
+typedef struct mufft_cpu_info
+{
+    /// SIMD instruction sets the CPU supports and muFFT uses.
+    /// A mask of \ref MUFFT_CPU_HAS_AVX, \ref MUFFT_CPU_HAS_SSE3 and \ref MUFFT_CPU_HAS_SSE.
+    /// Limited by the `MUFFT_CPU` environment variable, see \ref mufft_get_cpu_info.
+    unsigned flags;
+    size_t l1_cache_size; ///< Size of the L1 data cache of one core in bytes.
+    size_t l2_cache_size; ///< Size of the L2 cache in bytes.
+    size_t l3_cache_size; ///< Size of the L3 cache in bytes.
+    unsigned cache_line_size; ///< Size of an L1 cache line in bytes.
+    unsigned logical_cores; ///< Number of online logical cores, i.e. hardware threads.
+    unsigned physical_cores; ///< Number of online physical cores.
+} mufft_cpu_info;
+
+/// \brief Detects the CPU muFFT runs on.
+/// Cache sizes are read from the deterministic cache parameters of CPUID on x86,
+/// and from `/sys/devices/system/cpu` on Linux. Core counts are only detected on Linux and Windows.
+/// The planner sizes cache blocking of strided passes from this.
+///
+/// The CPU is detected once, the first time muFFT needs it, and the result is reused. This function is thread-safe.
+/// Setting the `MUFFT_CPU` environment variable to `avx`, `sse3`, `sse` or `c` before that limits muFFT to the SIMD
+/// instruction sets of that tier, `c` meaning plain C only, e.g. for testing or reproducible benchmarks.
+/// Instruction sets the CPU does not support are never enabled. Other values are ignored.
+/// @param info Receives the CPU information.
+void mufft_get_cpu_info(mufft_cpu_info *info);
+/// @}
+
 ///
 /// @}
 ///
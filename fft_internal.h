@@ -24,6 +24,10 @@
 #include "fft.h"
 #include <math.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #ifndef M_PI
 /// Portable definition of M_PI
 #define M_PI 3.14159265358979323846
@@ -105,17 +109,209 @@ static inline cfloat cfloat_mul_scalar(float s, cfloat a)
     return ret;
 }
 
+/// \brief Computes the twiddle factor exp(pi * I * direction * k / p)
+static inline cfloat twiddle(int direction, int k, int p)
+{
+    double phase = (M_PI * direction * k) / p;
+    return cfloat_create((float)cos(phase), (float)sin(phase));
+}
+
+/// \brief Gets the offset of the twiddle factors for butterfly stride p in a table from \ref fill_twiddles.
+static inline unsigned twiddle_level_offset(unsigned p)
+{
+    // Levels are stored back to back, and p == 2 is padded to 3 entries, so level p starts at p for p >= 4.
+    return p >= 4 ? p : p - 1;
+}
+
+/// \brief Computes the twiddle factors exp(pi * I * direction * k / P) for 0 <= k < P.
+/// Only the first octant is evaluated, with double precision polynomials the compiler can vectorize.
+/// The rest of the half circle is filled in with exact reflections of the first octant.
+/// @param twiddles Output table with P entries.
+/// @param direction Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+/// @param P Number of twiddle factors, must be a power of two.
+static inline void build_half_circle(cfloat *twiddles, int direction, unsigned P)
+{
+    if (P < 4)
+    {
+        for (unsigned k = 0; k < P; k++)
+        {
+            twiddles[k] = twiddle(direction, k, P);
+        }
+        return;
+    }
+
+    unsigned octant = P / 4;
+    double step = M_PI / P;
+    float sign = (float)direction;
+
+    // Taylor series up to x^15 and x^16 are accurate to well below double precision epsilon for |x| <= pi / 4.
+    for (unsigned k = 0; k <= octant; k++)
+    {
+        double x = step * k;
+        double x2 = x * x;
+        double s = x * (1.0 + x2 * (-1.0 / 6.0 + x2 * (1.0 / 120.0 + x2 * (-1.0 / 5040.0 +
+                        x2 * (1.0 / 362880.0 + x2 * (-1.0 / 39916800.0 + x2 * (1.0 / 6227020800.0 +
+                        x2 * (-1.0 / 1307674368000.0))))))));
+        double c = 1.0 + x2 * (-1.0 / 2.0 + x2 * (1.0 / 24.0 + x2 * (-1.0 / 720.0 + x2 * (1.0 / 40320.0 +
+                        x2 * (-1.0 / 3628800.0 + x2 * (1.0 / 479001600.0 + x2 * (-1.0 / 87178291200.0 +
+                        x2 * (1.0 / 20922789888000.0))))))));
+        twiddles[k] = cfloat_create((float)c, sign * (float)s);
+    }
+
+    // cos(pi / 2 - x) = sin(x), sin(pi / 2 - x) = cos(x).
+    for (unsigned k = octant + 1; k <= 2 * octant; k++)
+    {
+        cfloat t = twiddles[2 * octant - k];
+        twiddles[k] = cfloat_create(sign * t.imag, sign * t.real);
+    }
+
+    // cos(pi - x) = -cos(x), sin(pi - x) = sin(x).
+    for (unsigned k = 2 * octant + 1; k < P; k++)
+    {
+        cfloat t = twiddles[P - k];
+        twiddles[k] = cfloat_create(-t.real, t.imag);
+    }
+}
+
+/// \brief Fills in a table of twiddle factors.
+/// The table is built for a DIT transform with increasing butterfly strides.
+/// The table is suitable for any FFT radix.
+/// @param twiddles Output table with N entries.
+/// @param N Transform size
+/// @param direction Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+static inline void fill_twiddles(cfloat *twiddles, unsigned N, int direction)
+{
+    if (N < 2)
+    {
+        return;
+    }
+
+    // Only the largest level is computed, every smaller level p is a strided subset of it.
+    unsigned top = N / 2;
+    cfloat *top_level = twiddles + twiddle_level_offset(top);
+    build_half_circle(top_level, direction, top);
+
+    for (unsigned p = 1; p < top; p <<= 1)
+    {
+        cfloat *pt = twiddles + twiddle_level_offset(p);
+        unsigned stride = top / p;
+        for (unsigned k = 0; k < p; k++)
+        {
+            pt[k] = top_level[k * stride];
+        }
+    }
+
+}
+
+/// \brief Fills in the twiddle factors used to resolve a real-to-complex or complex-to-real transform.
+/// @param twiddles Output table with N entries.
+/// @param direction Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+/// @param N Size of the complex transform, half of the real transform size.
+static inline void fill_r2c_twiddles(cfloat *twiddles, int direction, unsigned N)
+{
+    build_half_circle(twiddles, direction, N);
+    for (unsigned i = 0; i < N; i++)
+    {
+        twiddles[i] = cfloat_mul(cfloat_create(0.0f, direction), twiddles[i]);
+    }
+}
+
+/// Twiddle factor levels for butterfly strides of at least this size are stored compactly in tables from \ref fill_compact_twiddles.
+#define MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL 4096
+/// Number of fine twiddle factors stored for every compact level. Must be a multiple of the widest SIMD vector.
+#define MUFFT_COMPACT_TWIDDLE_FINE 128
+/// log2 of \ref MUFFT_COMPACT_TWIDDLE_FINE.
+#define MUFFT_COMPACT_TWIDDLE_FINE_SHIFT 7
+
+/// \brief Gets the number of twiddle factors stored for butterfly stride P in a table from \ref fill_compact_twiddles.
+static inline unsigned compact_twiddle_level_size(unsigned P)
+{
+    return P < MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL ? P : MUFFT_COMPACT_TWIDDLE_FINE + P / MUFFT_COMPACT_TWIDDLE_FINE;
+}
+
+/// \brief Gets the offset of the twiddle factors for butterfly stride p in a table from \ref fill_compact_twiddles.
+/// Also gives the size of a table for transform size p.
+static inline unsigned compact_twiddle_level_offset(unsigned p)
+{
+    if (p <= MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL)
+    {
+        return twiddle_level_offset(p);
+    }
+
+    unsigned offset = MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL;
+    for (unsigned P = MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL; P < p; P <<= 1)
+    {
+        offset += compact_twiddle_level_size(P);
+    }
+    return offset;
+}
+
+/// \brief Gets twiddle factor k for butterfly stride P from a table built by \ref fill_compact_twiddles.
+/// @param level Start of the level for butterfly stride P.
+/// @param P Butterfly stride.
+/// @param k Index of the twiddle factor, 0 <= k < P.
+static inline cfloat compact_twiddle(const cfloat *level, unsigned P, unsigned k)
+{
+    if (P < MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL)
+    {
+        return level[k];
+    }
+
+    return cfloat_mul(level[MUFFT_COMPACT_TWIDDLE_FINE + (k >> MUFFT_COMPACT_TWIDDLE_FINE_SHIFT)],
+            level[k & (MUFFT_COMPACT_TWIDDLE_FINE - 1)]);
+}
+
+/// \brief Fills in a compact table of twiddle factors.
+/// Levels smaller than \ref MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL are laid out as in \ref fill_twiddles.
+/// Every larger level P is split as exp(pi * I * direction * k / P) = coarse[k / FINE] * fine[k % FINE],
+/// and stores \ref MUFFT_COMPACT_TWIDDLE_FINE fine factors followed by P / \ref MUFFT_COMPACT_TWIDDLE_FINE coarse factors.
+/// Large transforms then stream a tiny fraction of the twiddle factors, at the cost of a complex multiply per factor.
+/// @param twiddles Output table with compact_twiddle_level_offset(N) entries.
+/// @param N Transform size
+/// @param direction Direction of transform. See \ref MUFFT_FORWARD and \ref MUFFT_INVERSE.
+static inline void fill_compact_twiddles(cfloat *twiddles, unsigned N, int direction)
+{
+    fill_twiddles(twiddles, N < MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL ? N : MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL, direction);
+
+    cfloat *level = twiddles + MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL;
+    for (unsigned P = MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL; P < N; P <<= 1)
+    {
+        for (unsigned k = 0; k < MUFFT_COMPACT_TWIDDLE_FINE; k++)
+        {
+            level[k] = twiddle(direction, k, P);
+        }
+        build_half_circle(level + MUFFT_COMPACT_TWIDDLE_FINE, direction, P / MUFFT_COMPACT_TWIDDLE_FINE);
+        level += compact_twiddle_level_size(P);
+    }
+}
+
 /// 1D/horizontal FFT routine signature
 typedef void (*mufft_1d_func)(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples);
 
 /// 2D/vertical FFT routine signature
 typedef void (*mufft_2d_func)(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y);
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y);
 
 /// Real-to-complex and complex-to-real resolve routine signature
 typedef void (*mufft_r2c_resolve_func)(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles, unsigned samples);
 
+/// 1D FFT routine signature for steps which also scale their input
+typedef void (*mufft_1d_scale_func)(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, float scale, unsigned p, unsigned samples);
+
+/// Signature of an FFT step with the R2C resolve folded into it (last step) or the C2R resolve folded into it (first step).
+typedef void (*mufft_resolve_step_func)(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned p, unsigned samples);
+
+/// Transpose routine signature. Transposes a rows-by-columns block of complex samples.
+typedef void (*mufft_transpose_func)(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        unsigned rows, unsigned columns, unsigned output_stride, unsigned input_stride);
+
+/// Partial DFT routine signature used to finish output pruned transforms
+typedef void (*mufft_partial_dft_func)(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned first_bin, unsigned num_bins, unsigned samples);
+
 /// Helper macro to mangle function signatures for specific SIMD instruction sets
 #define MANGLE(name, arch) mufft_ ## name ## _ ## arch
 
@@ -125,11 +321,20 @@ typedef void (*mufft_r2c_resolve_func)(cfloat * MUFFT_RESTRICT output, const cfl
 /// Declares a mangled C2R-R2C resolve function
 #define FFT_RESOLVE_FUNC(name, arch) void MANGLE(name, arch) (cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles, unsigned samples);
 
+/// Declares a mangled FFT step function with a folded in C2R-R2C resolve
+#define FFT_RESOLVE_STEP_FUNC(name, arch) void MANGLE(name, arch) (void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned p, unsigned samples);
+
+/// Declares a mangled transpose function
+#define FFT_TRANSPOSE_FUNC(name, arch) void MANGLE(name, arch) (cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input, unsigned rows, unsigned columns, unsigned output_stride, unsigned input_stride);
+
 /// Declares a mangled 1D FFT function
 #define FFT_1D_FUNC(name, arch) void MANGLE(name, arch) (void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples);
 
+/// Declares a mangled 1D FFT function which also scales its input
+#define FFT_1D_SCALE_FUNC(name, arch) void MANGLE(name, arch) (void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles, float scale, unsigned p, unsigned samples);
+
 /// Declared a mangled 2D FFT function
-#define FFT_2D_FUNC(name, arch) void MANGLE(name, arch) (void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y);
+#define FFT_2D_FUNC(name, arch) void MANGLE(name, arch) (void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y);
 
 /// Declares all available routines for a specific SIMD instruction set
 #define DECLARE_FFT_CPU(arch) \
@@ -137,6 +342,16 @@ typedef void (*mufft_r2c_resolve_func)(cfloat * MUFFT_RESTRICT output, const cfl
     FFT_RESOLVE_FUNC(resolve_r2c, arch) \
     FFT_RESOLVE_FUNC(resolve_r2c_full, arch) \
     FFT_RESOLVE_FUNC(resolve_c2r, arch) \
+    FFT_TRANSPOSE_FUNC(transpose, arch) \
+    FFT_RESOLVE_STEP_FUNC(c2r_radix8_p1, arch) \
+    FFT_RESOLVE_STEP_FUNC(c2r_radix4_p1, arch) \
+    FFT_RESOLVE_STEP_FUNC(c2r_radix2_p1, arch) \
+    FFT_RESOLVE_STEP_FUNC(r2c_radix8_last, arch) \
+    FFT_RESOLVE_STEP_FUNC(r2c_radix4_last, arch) \
+    FFT_RESOLVE_STEP_FUNC(r2c_radix2_last, arch) \
+    FFT_RESOLVE_STEP_FUNC(r2c_full_radix8_last, arch) \
+    FFT_RESOLVE_STEP_FUNC(r2c_full_radix4_last, arch) \
+    FFT_RESOLVE_STEP_FUNC(r2c_full_radix2_last, arch) \
     FFT_1D_FUNC(forward_radix8_p1, arch) \
     FFT_1D_FUNC(forward_radix4_p1, arch) \
     FFT_1D_FUNC(radix2_p1, arch) \
@@ -148,10 +363,26 @@ typedef void (*mufft_r2c_resolve_func)(cfloat * MUFFT_RESTRICT output, const cfl
     FFT_1D_FUNC(inverse_radix8_p1, arch) \
     FFT_1D_FUNC(inverse_radix4_p1, arch) \
     FFT_1D_FUNC(inverse_radix2_p2, arch) \
+    FFT_1D_FUNC(radix64_fused, arch) \
     FFT_1D_FUNC(radix8_generic, arch) \
     FFT_1D_FUNC(radix4_generic, arch) \
     FFT_1D_FUNC(radix2_generic, arch) \
+    FFT_1D_SCALE_FUNC(radix8_generic_scale, arch) \
+    FFT_1D_SCALE_FUNC(radix4_generic_scale, arch) \
+    FFT_1D_SCALE_FUNC(radix2_generic_scale, arch) \
+    FFT_1D_FUNC(radix8_broadcast, arch) \
+    FFT_1D_FUNC(radix4_broadcast, arch) \
+    FFT_1D_FUNC(radix2_broadcast, arch) \
+    FFT_1D_FUNC(radix8_compact, arch) \
+    FFT_1D_FUNC(radix4_compact, arch) \
+    FFT_1D_FUNC(radix2_compact, arch) \
+    FFT_1D_FUNC(radix8_broadcast_compact, arch) \
+    FFT_1D_FUNC(radix4_broadcast_compact, arch) \
+    FFT_1D_FUNC(radix2_broadcast_compact, arch) \
     FFT_2D_FUNC(radix2_p1_vert, arch) \
+    FFT_2D_FUNC(radix2_half_p1_vert, arch) \
+    FFT_2D_FUNC(forward_half_radix8_p1_vert, arch) \
+    FFT_2D_FUNC(forward_half_radix4_p1_vert, arch) \
     FFT_2D_FUNC(forward_radix8_p1_vert, arch) \
     FFT_2D_FUNC(forward_radix4_p1_vert, arch) \
     FFT_2D_FUNC(inverse_radix8_p1_vert, arch) \
@@ -165,18 +396,69 @@ DECLARE_FFT_CPU(sse3)
 DECLARE_FFT_CPU(sse)
 DECLARE_FFT_CPU(c)
 
+/// Declares routines which only exist for SIMD instruction sets
+#define DECLARE_FFT_SIMD(arch) \
+    FFT_1D_FUNC(radix8_generic_stream, arch) \
+    FFT_1D_FUNC(radix4_generic_stream, arch) \
+    FFT_1D_FUNC(radix2_generic_stream, arch) \
+    FFT_2D_FUNC(radix8_generic_vert_prefetch, arch) \
+    FFT_2D_FUNC(radix4_generic_vert_prefetch, arch) \
+    FFT_2D_FUNC(radix2_generic_vert_prefetch, arch)
+
+DECLARE_FFT_SIMD(avx)
+DECLARE_FFT_SIMD(sse3)
+DECLARE_FFT_SIMD(sse)
+
+/// \brief Finishes an output pruned transform with a direct DFT over the remaining N / p sub-transforms.
+/// Only the requested bins are computed. There is only a C implementation of this routine.
+void mufft_partial_dft_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned first_bin, unsigned num_bins, unsigned samples);
+
 /// Internal flag used for choosing FFT routines
 #define MUFFT_FLAG_MASK_CPU MUFFT_FLAG_CPU_NO_SIMD
 /// Internal flag used for choosing FFT routines
-#define MUFFT_FLAG_CPU_AVX MUFFT_FLAG_CPU_NO_AVX
+#define MUFFT_FLAG_CPU_AVX MUFFT_CPU_HAS_AVX
 /// Internal flag used for choosing FFT routines
-#define MUFFT_FLAG_CPU_SSE3 MUFFT_FLAG_CPU_NO_SSE3
+#define MUFFT_FLAG_CPU_SSE3 MUFFT_CPU_HAS_SSE3
 /// Internal flag used for choosing FFT routines
-#define MUFFT_FLAG_CPU_SSE MUFFT_FLAG_CPU_NO_SSE
+#define MUFFT_FLAG_CPU_SSE MUFFT_CPU_HAS_SSE
+
+/// \brief Takes a spinlock. Only used to guard short lookups in process-wide and shared state, such as the twiddle factor cache and the detected CPU.
+static inline void spin_lock(volatile long *lock)
+{
+#if defined(__GNUC__)
+    while (__sync_lock_test_and_set(lock, 1))
+    {
+    }
+#elif defined(_MSC_VER)
+    while (_InterlockedExchange(lock, 1))
+    {
+    }
+#else
+#error "muFFT needs atomic operations to guard its caches on this compiler."
+#endif
+}
+
+/// \brief Releases a spinlock taken with \ref spin_lock.
+static inline void spin_unlock(volatile long *lock)
+{
+#if defined(__GNUC__)
+    __sync_lock_release(lock);
+#elif defined(_MSC_VER)
+    _InterlockedExchange(lock, 0);
+#else
+#error "muFFT needs atomic operations to guard its caches on this compiler."
+#endif
+}
 
 /// \brief Gets a mask of all relevant SIMD features the running CPU supports.
+/// Same as mufft_cpu_info::flags from \ref mufft_get_cpu_info, so the CPU is only detected once.
 unsigned mufft_get_cpu_flags(void);
 
+/// \brief Checks if a 2D plan transposes columns into rows for its vertical pass, see \ref MUFFT_FLAG_2D_TRANSPOSE.
+/// Lets tests check which engine the planner picked. Returns non-zero if it does.
+int mufft_plan_2d_uses_transpose(const mufft_plan_2d *plan);
+
 /// Internal flag used for choosing FFT routines
 #define MUFFT_FLAG_DIRECTION_INVERSE (1 << 24)
 /// Internal flag used for choosing FFT routines
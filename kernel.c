@@ -81,19 +81,70 @@ void mufft_resolve_r2c_full_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUF
     }
 }
 
-void mufft_radix2_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+void mufft_transpose_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        unsigned rows, unsigned columns, unsigned output_stride, unsigned input_stride)
 {
-    cfloat *output = output_;
-    const cfloat *input = input_;
-    (void)twiddles;
-    (void)p;
+    for (unsigned y = 0; y < rows; y++)
+    {
+        for (unsigned x = 0; x < columns; x++)
+        {
+            output[x * output_stride + y] = input[y * input_stride + x];
+        }
+    }
+}
+
+// After the FFT steps up to p, input holds samples / p interleaved p-point transforms,
+// input[b * p + f] being the f-th bin of the transform of x[b], x[b + samples / p], x[b + 2 * samples / p], ...
+// Every output bin is then a plain DFT over these sub-transforms.
+// twiddles is the last level of the twiddle table, i.e. the first samples / 2 roots of unity.
+void mufft_partial_dft_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned first_bin, unsigned num_bins, unsigned samples)
+{
+    unsigned half_samples = samples >> 1;
+    unsigned blocks = samples / p;
+
+    for (unsigned i = 0; i < num_bins; i++)
+    {
+        unsigned bin = (first_bin + i) & (samples - 1);
+        const cfloat *x = input + (bin & (p - 1));
+
+        cfloat sum = x[0];
+        unsigned k = 0;
+        for (unsigned b = 1; b < blocks; b++)
+        {
+            k = (k + bin) & (samples - 1);
+            cfloat w = k < half_samples ?
+                twiddles[k] : cfloat_mul_scalar(-1.0f, twiddles[k - half_samples]);
+            sum = cfloat_add(sum, cfloat_mul(w, x[b * p]));
+        }
+
+        output[i] = sum;
+    }
+}
+
+// Loads input[i] as mufft_resolve_c2r_c would have written it, so that first pass kernels can skip the resolve pass.
+// Without resolve twiddles, this is a plain load.
+static inline cfloat load_first_c(const cfloat * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT r2c_twiddles,
+        unsigned i, unsigned samples)
+{
+    if (r2c_twiddles == NULL)
+    {
+        return input[i];
+    }
+
+    cfloat a = input[i];
+    cfloat b = cfloat_conj(input[samples - i]);
+    return cfloat_add(cfloat_add(a, b), cfloat_mul(cfloat_sub(a, b), r2c_twiddles[i]));
+}
 
+static inline void radix2_p1_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned samples)
+{
     unsigned half_samples = samples >> 1;
     for (unsigned i = 0; i < half_samples; i++)
     {
-        cfloat a = input[i];
-        cfloat b = input[i + half_samples]; 
+        cfloat a = load_first_c(input, r2c_twiddles, i, samples);
+        cfloat b = load_first_c(input, r2c_twiddles, i + half_samples, samples);
 
         unsigned j = i << 1;
         output[j + 0] = cfloat_add(a, b);
@@ -101,6 +152,22 @@ void mufft_radix2_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRIC
     }
 }
 
+void mufft_radix2_p1_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    (void)twiddles;
+    (void)p;
+    radix2_p1_c(output, input, NULL, samples);
+}
+
+void mufft_c2r_radix2_p1_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned p, unsigned samples)
+{
+    (void)twiddles;
+    (void)p;
+    radix2_p1_c(output, input, r2c_twiddles, samples);
+}
+
 void mufft_radix2_half_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
@@ -148,18 +215,62 @@ void mufft_inverse_radix2_p2_c(void * MUFFT_RESTRICT output_, const void * MUFFT
     mufft_forward_radix2_p2_c(output_, input_, twiddles, p, samples);
 }
 
-void mufft_radix2_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+// The generic kernels read twiddle factor k of the level for butterfly stride P through these,
+// so that the same code serves both the regular and the compact table layout.
+static inline cfloat level_twiddle_c(const cfloat * MUFFT_RESTRICT level, unsigned P, unsigned k, int compact)
+{
+    return compact ? compact_twiddle(level, P, k) : level[k];
+}
+
+static inline const cfloat *next_twiddle_level_c(const cfloat * MUFFT_RESTRICT level, unsigned P, int compact)
+{
+    return level + (compact ? compact_twiddle_level_size(P) : P);
+}
+
+static inline void radix2_generic_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples, float scale, int compact)
+{
+    unsigned half_samples = samples >> 1;
+    for (unsigned i = 0; i < half_samples; i++)
+    {
+        unsigned k = i & (p - 1);
+        cfloat w = level_twiddle_c(twiddles, p, k, compact);
+        cfloat a = cfloat_mul_scalar(scale, input[i]);
+        cfloat b = cfloat_mul(w, cfloat_mul_scalar(scale, input[i + half_samples]));
+
+        unsigned j = (i << 1) - k;
+        output[j + 0] = cfloat_add(a, b);
+        output[j + p] = cfloat_sub(a, b);
+    }
+}
+
+void mufft_radix2_generic_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
-    cfloat *output = output_;
-    const cfloat *input = input_;
+    radix2_generic_c(output, input, twiddles, p, samples, 1.0f, 0);
+}
+
+void mufft_radix2_generic_scale_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, float scale, unsigned p, unsigned samples)
+{
+    radix2_generic_c(output, input, twiddles, p, samples, scale, 0);
+}
 
+// Broadcast variants of the generic kernels are used as the first step of zero padded transforms.
+// The input is only non-zero for the first samples / p elements, so the p butterflies
+// sharing a line of input all read the same values, and the earlier steps can be skipped entirely.
+static inline void radix2_broadcast_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples, int compact)
+{
     unsigned half_samples = samples >> 1;
+    unsigned line_stride = half_samples / p;
     for (unsigned i = 0; i < half_samples; i++)
     {
         unsigned k = i & (p - 1);
-        cfloat a = input[i];
-        cfloat b = cfloat_mul(twiddles[k], input[i + half_samples]);
+        cfloat w = level_twiddle_c(twiddles, p, k, compact);
+        unsigned line = i / p;
+        cfloat a = input[line];
+        cfloat b = cfloat_mul(w, input[line + line_stride]);
 
         unsigned j = (i << 1) - k;
         output[j + 0] = cfloat_add(a, b);
@@ -167,21 +278,34 @@ void mufft_radix2_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
     }
 }
 
-void mufft_forward_radix4_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+void mufft_radix2_broadcast_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
-    cfloat *output = output_;
-    const cfloat *input = input_;
-    (void)twiddles;
-    (void)p;
+    radix2_broadcast_c(output, input, twiddles, p, samples, 0);
+}
+
+void mufft_radix2_compact_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix2_generic_c(output, input, twiddles, p, samples, 1.0f, 1);
+}
+
+void mufft_radix2_broadcast_compact_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix2_broadcast_c(output, input, twiddles, p, samples, 1);
+}
 
+static inline void radix4_p1_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned samples)
+{
     unsigned quarter_samples = samples >> 2;
     for (unsigned i = 0; i < quarter_samples; i++)
     {
-        cfloat a = input[i];
-        cfloat b = input[i + quarter_samples];
-        cfloat c = input[i + 2 * quarter_samples];
-        cfloat d = input[i + 3 * quarter_samples];
+        cfloat a = load_first_c(input, r2c_twiddles, i, samples);
+        cfloat b = load_first_c(input, r2c_twiddles, i + quarter_samples, samples);
+        cfloat c = load_first_c(input, r2c_twiddles, i + 2 * quarter_samples, samples);
+        cfloat d = load_first_c(input, r2c_twiddles, i + 3 * quarter_samples, samples);
 
         cfloat r0 = cfloat_add(a, c);
         cfloat r1 = cfloat_sub(a, c);
@@ -197,6 +321,20 @@ void mufft_forward_radix4_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT
     }
 }
 
+void mufft_forward_radix4_p1_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    (void)p;
+    radix4_p1_c(output, input, twiddles, NULL, samples);
+}
+
+void mufft_c2r_radix4_p1_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned p, unsigned samples)
+{
+    (void)p;
+    radix4_p1_c(output, input, twiddles, r2c_twiddles, samples);
+}
+
 void mufft_forward_half_radix4_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
@@ -231,21 +369,72 @@ void mufft_inverse_radix4_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT
     mufft_forward_radix4_p1_c(output_, input_, twiddles, p, samples);
 }
 
-void mufft_radix4_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-                            const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+static inline void radix4_generic_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples, float scale, int compact)
 {
-    cfloat *output = output_;
-    const cfloat *input = input_;
+    unsigned quarter_samples = samples >> 2;
+    const cfloat *twiddles2 = next_twiddle_level_c(twiddles, p, compact);
+    for (unsigned i = 0; i < quarter_samples; i++)
+    {
+        unsigned k = i & (p - 1);
+        cfloat w = level_twiddle_c(twiddles, p, k, compact);
+
+        cfloat a = cfloat_mul_scalar(scale, input[i]);
+        cfloat b = cfloat_mul_scalar(scale, input[i + quarter_samples]);
+        cfloat c = cfloat_mul(w, cfloat_mul_scalar(scale, input[i + 2 * quarter_samples]));
+        cfloat d = cfloat_mul(w, cfloat_mul_scalar(scale, input[i + 3 * quarter_samples]));
+
+        // DFT-2
+        cfloat r0 = cfloat_add(a, c);
+        cfloat r1 = cfloat_sub(a, c);
+        cfloat r2 = cfloat_add(b, d);
+        cfloat r3 = cfloat_sub(b, d);
+
+        r2 = cfloat_mul(r2, level_twiddle_c(twiddles2, 2 * p, k, compact));
+        r3 = cfloat_mul(r3, level_twiddle_c(twiddles2, 2 * p, p + k, compact));
+
+        // DFT-2
+        cfloat o0 = cfloat_add(r0, r2);
+        cfloat o1 = cfloat_sub(r0, r2);
+        cfloat o2 = cfloat_add(r1, r3);
+        cfloat o3 = cfloat_sub(r1, r3);
+
+        unsigned j = ((i - k) << 2) + k;
+        output[j +     0] = o0;
+        output[j + 1 * p] = o2;
+        output[j + 2 * p] = o1;
+        output[j + 3 * p] = o3;
+    }
+}
 
+void mufft_radix4_generic_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix4_generic_c(output, input, twiddles, p, samples, 1.0f, 0);
+}
+
+void mufft_radix4_generic_scale_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, float scale, unsigned p, unsigned samples)
+{
+    radix4_generic_c(output, input, twiddles, p, samples, scale, 0);
+}
+
+static inline void radix4_broadcast_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples, int compact)
+{
     unsigned quarter_samples = samples >> 2;
+    const cfloat *twiddles2 = next_twiddle_level_c(twiddles, p, compact);
+    unsigned line_stride = quarter_samples / p;
     for (unsigned i = 0; i < quarter_samples; i++)
     {
         unsigned k = i & (p - 1);
+        cfloat w = level_twiddle_c(twiddles, p, k, compact);
+        unsigned line = i / p;
 
-        cfloat a = input[i];
-        cfloat b = input[i + quarter_samples];
-        cfloat c = cfloat_mul(twiddles[k], input[i + 2 * quarter_samples]);
-        cfloat d = cfloat_mul(twiddles[k], input[i + 3 * quarter_samples]);
+        cfloat a = input[line];
+        cfloat b = input[line + line_stride];
+        cfloat c = cfloat_mul(w, input[line + 2 * line_stride]);
+        cfloat d = cfloat_mul(w, input[line + 3 * line_stride]);
 
         // DFT-2
         cfloat r0 = cfloat_add(a, c);
@@ -253,8 +442,8 @@ void mufft_radix4_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
         cfloat r2 = cfloat_add(b, d);
         cfloat r3 = cfloat_sub(b, d);
 
-        r2 = cfloat_mul(r2, twiddles[p + k]);
-        r3 = cfloat_mul(r3, twiddles[p + k + p]);
+        r2 = cfloat_mul(r2, level_twiddle_c(twiddles2, 2 * p, k, compact));
+        r3 = cfloat_mul(r3, level_twiddle_c(twiddles2, 2 * p, p + k, compact));
 
         // DFT-2
         cfloat o0 = cfloat_add(r0, r2);
@@ -270,25 +459,38 @@ void mufft_radix4_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
     }
 }
 
-void mufft_forward_radix8_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+void mufft_radix4_broadcast_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
-    cfloat *output = output_;
-    const cfloat *input = input_;
-    (void)twiddles;
-    (void)p;
+    radix4_broadcast_c(output, input, twiddles, p, samples, 0);
+}
 
+void mufft_radix4_compact_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix4_generic_c(output, input, twiddles, p, samples, 1.0f, 1);
+}
+
+void mufft_radix4_broadcast_compact_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix4_broadcast_c(output, input, twiddles, p, samples, 1);
+}
+
+static inline void radix8_p1_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned samples)
+{
     unsigned octa_samples = samples >> 3;
     for (unsigned i = 0; i < octa_samples; i++)
     {
-        cfloat a = input[i];
-        cfloat b = input[i + octa_samples];
-        cfloat c = input[i + 2 * octa_samples];
-        cfloat d = input[i + 3 * octa_samples];
-        cfloat e = input[i + 4 * octa_samples];
-        cfloat f = input[i + 5 * octa_samples];
-        cfloat g = input[i + 6 * octa_samples];
-        cfloat h = input[i + 7 * octa_samples];
+        cfloat a = load_first_c(input, r2c_twiddles, i, samples);
+        cfloat b = load_first_c(input, r2c_twiddles, i + octa_samples, samples);
+        cfloat c = load_first_c(input, r2c_twiddles, i + 2 * octa_samples, samples);
+        cfloat d = load_first_c(input, r2c_twiddles, i + 3 * octa_samples, samples);
+        cfloat e = load_first_c(input, r2c_twiddles, i + 4 * octa_samples, samples);
+        cfloat f = load_first_c(input, r2c_twiddles, i + 5 * octa_samples, samples);
+        cfloat g = load_first_c(input, r2c_twiddles, i + 6 * octa_samples, samples);
+        cfloat h = load_first_c(input, r2c_twiddles, i + 7 * octa_samples, samples);
 
         cfloat r0 = cfloat_add(a, e); // 0O + 0
         cfloat r1 = cfloat_sub(a, e); // 0O + 1
@@ -330,6 +532,20 @@ void mufft_forward_radix8_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT
     }
 }
 
+void mufft_forward_radix8_p1_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    (void)p;
+    radix8_p1_c(output, input, twiddles, NULL, samples);
+}
+
+void mufft_c2r_radix8_p1_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned p, unsigned samples)
+{
+    (void)p;
+    radix8_p1_c(output, input, twiddles, r2c_twiddles, samples);
+}
+
 void mufft_forward_half_radix8_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
@@ -392,24 +608,262 @@ void mufft_inverse_radix8_p1_c(void * MUFFT_RESTRICT output_, const void * MUFFT
     mufft_forward_radix8_p1_c(output_, input_, twiddles, p, samples);
 }
 
-void mufft_radix8_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+// Radix-8 butterfly on x[0..7], the same as one iteration of mufft_radix8_generic_c.
+// The results replace x in output order.
+static inline void radix8_butterfly_c(cfloat *x, const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned k)
+{
+    cfloat a = x[0];
+    cfloat b = x[1];
+    cfloat c = x[2];
+    cfloat d = x[3];
+    cfloat e = cfloat_mul(twiddles[k], x[4]);
+    cfloat f = cfloat_mul(twiddles[k], x[5]);
+    cfloat g = cfloat_mul(twiddles[k], x[6]);
+    cfloat h = cfloat_mul(twiddles[k], x[7]);
+
+    cfloat r0 = cfloat_add(a, e);
+    cfloat r1 = cfloat_sub(a, e);
+    cfloat r2 = cfloat_add(b, f);
+    cfloat r3 = cfloat_sub(b, f);
+    cfloat r4 = cfloat_mul(cfloat_add(c, g), twiddles[p + k]);
+    cfloat r5 = cfloat_mul(cfloat_sub(c, g), twiddles[p + k + p]);
+    cfloat r6 = cfloat_mul(cfloat_add(d, h), twiddles[p + k]);
+    cfloat r7 = cfloat_mul(cfloat_sub(d, h), twiddles[p + k + p]);
+
+    a = cfloat_add(r0, r4);
+    b = cfloat_add(r1, r5);
+    c = cfloat_sub(r0, r4);
+    d = cfloat_sub(r1, r5);
+    e = cfloat_mul(cfloat_add(r2, r6), twiddles[3 * p + k]);
+    f = cfloat_mul(cfloat_add(r3, r7), twiddles[3 * p + k + p]);
+    g = cfloat_mul(cfloat_sub(r2, r6), twiddles[3 * p + k + 2 * p]);
+    h = cfloat_mul(cfloat_sub(r3, r7), twiddles[3 * p + k + 3 * p]);
+
+    x[0] = cfloat_add(a, e);
+    x[1] = cfloat_add(b, f);
+    x[2] = cfloat_add(c, g);
+    x[3] = cfloat_add(d, h);
+    x[4] = cfloat_sub(a, e);
+    x[5] = cfloat_sub(b, f);
+    x[6] = cfloat_sub(c, g);
+    x[7] = cfloat_sub(d, h);
+}
+
+// Two radix-8 steps in one pass, a step at p followed by a step at 8p.
+// The 64 samples the second step needs for one group of outputs are all produced by the first step
+// from input[i + n * samples / 64], so the intermediate result only lives in a small local buffer.
+void mufft_radix64_fused_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
 
+    // Twiddles for the step at 8p follow the three levels used by the step at p.
+    const cfloat *twiddles_8p = twiddles + 7 * p;
+
+    unsigned stride = samples >> 6;
+    for (unsigned i = 0; i < stride; i++)
+    {
+        unsigned k = i & (p - 1);
+        cfloat x[8][8];
+
+        // First step, one radix-8 butterfly per sub-transform s.
+        for (unsigned s = 0; s < 8; s++)
+        {
+            for (unsigned r = 0; r < 8; r++)
+            {
+                x[s][r] = input[i + (s + 8 * r) * stride];
+            }
+            radix8_butterfly_c(x[s], twiddles, p, k);
+        }
+
+        // Second step, butterflies across the sub-transforms.
+        unsigned j = ((i - k) << 6) + k;
+        for (unsigned r = 0; r < 8; r++)
+        {
+            cfloat y[8];
+            for (unsigned s = 0; s < 8; s++)
+            {
+                y[s] = x[s][r];
+            }
+            radix8_butterfly_c(y, twiddles_8p, 8 * p, k + r * p);
+
+            for (unsigned s = 0; s < 8; s++)
+            {
+                output[j + r * p + s * 8 * p] = y[s];
+            }
+        }
+    }
+}
+
+// Radix-4 butterfly on x[0..3], the same as one iteration of mufft_radix4_generic_c.
+// The results replace x in output order.
+static inline void radix4_butterfly_c(cfloat *x, const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned k)
+{
+    cfloat a = x[0];
+    cfloat b = x[1];
+    cfloat c = cfloat_mul(twiddles[k], x[2]);
+    cfloat d = cfloat_mul(twiddles[k], x[3]);
+
+    cfloat r0 = cfloat_add(a, c);
+    cfloat r1 = cfloat_sub(a, c);
+    cfloat r2 = cfloat_mul(cfloat_add(b, d), twiddles[p + k]);
+    cfloat r3 = cfloat_mul(cfloat_sub(b, d), twiddles[p + k + p]);
+
+    x[0] = cfloat_add(r0, r2);
+    x[1] = cfloat_add(r1, r3);
+    x[2] = cfloat_sub(r0, r2);
+    x[3] = cfloat_sub(r1, r3);
+}
+
+// Radix-2 butterfly on x[0..1], the same as one iteration of mufft_radix2_generic_c.
+static inline void radix2_butterfly_c(cfloat *x, const cfloat * MUFFT_RESTRICT twiddles, unsigned k)
+{
+    cfloat a = x[0];
+    cfloat b = cfloat_mul(twiddles[k], x[1]);
+    x[0] = cfloat_add(a, b);
+    x[1] = cfloat_sub(a, b);
+}
+
+// Iteration i of the last FFT step, where p == samples / radix.
+// x[r] receives the sample which belongs at i + r * p.
+static inline void last_step_butterfly_c(cfloat *x, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned i, unsigned radix)
+{
+    for (unsigned r = 0; r < radix; r++)
+    {
+        x[r] = input[i + r * p];
+    }
+
+    switch (radix)
+    {
+        case 8:
+            radix8_butterfly_c(x, twiddles, p, i);
+            break;
+        case 4:
+            radix4_butterfly_c(x, twiddles, p, i);
+            break;
+        default:
+            radix2_butterfly_c(x, twiddles, i);
+            break;
+    }
+}
+
+// The last FFT step followed by the R2C resolve, without a pass over the data in between.
+// The resolve combines sample m with sample samples - m. With p == samples / radix, the last step
+// writes sample i + r * p from iteration i, and samples - i - r * p == (p - i) + (radix - 1 - r) * p
+// from iteration p - i. Iterations are therefore handled in pairs from both ends, i and p - 1 - i,
+// keeping the iterations right after each of them (i + 1 and p - i) around to resolve against.
+// Requires p >= 2.
+static inline void r2c_last_step_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles,
+        unsigned samples, unsigned radix, int full)
+{
+    unsigned p = samples / radix;
+    unsigned half_p = p >> 1;
+
+    cfloat x[8];
+    cfloat front[8][2];
+    cfloat back[8][2];
+
+    last_step_butterfly_c(x, input, twiddles, p, 0, radix);
+    cfloat dc = x[0];
+    for (unsigned r = 0; r < radix; r++)
+    {
+        front[r][0] = x[r];
+        // The partner of iteration 0 is iteration p, i.e. iteration 0 of the next group of outputs.
+        back[r][1] = x[(r + 1) & (radix - 1)];
+    }
+
+    for (unsigned i = 0; i < half_p; i++)
+    {
+        unsigned b = p - i - 1;
+        last_step_butterfly_c(x, input, twiddles, p, b, radix);
+        for (unsigned r = 0; r < radix; r++)
+        {
+            back[r][0] = x[r];
+        }
+
+        if (i + 1 < half_p)
+        {
+            last_step_butterfly_c(x, input, twiddles, p, i + 1, radix);
+        }
+        for (unsigned r = 0; r < radix; r++)
+        {
+            // Iteration p / 2 is the last back iteration.
+            front[r][1] = i + 1 < half_p ? x[r] : back[r][0];
+        }
+
+        for (unsigned r = 0; r < radix; r++)
+        {
+            unsigned m = i + r * p;
+            cfloat a = front[r][0];
+            cfloat c = cfloat_conj(back[radix - 1 - r][1]);
+            cfloat fe = cfloat_add(a, c);
+            cfloat fo = cfloat_mul(r2c_twiddles[m], cfloat_sub(a, c));
+            output[m] = cfloat_mul_scalar(0.5f, cfloat_add(fe, fo));
+            if (full)
+            {
+                output[m + samples] = cfloat_mul_scalar(0.5f, cfloat_sub(fe, fo));
+            }
+
+            m = b + r * p;
+            a = back[r][0];
+            c = cfloat_conj(front[radix - 1 - r][1]);
+            fe = cfloat_add(a, c);
+            fo = cfloat_mul(r2c_twiddles[m], cfloat_sub(a, c));
+            output[m] = cfloat_mul_scalar(0.5f, cfloat_add(fe, fo));
+            if (full)
+            {
+                output[m + samples] = cfloat_mul_scalar(0.5f, cfloat_sub(fe, fo));
+            }
+        }
+
+        for (unsigned r = 0; r < radix; r++)
+        {
+            front[r][0] = front[r][1];
+            back[r][1] = back[r][0];
+        }
+    }
+
+    cfloat fe = cfloat_real(dc);
+    cfloat fo = cfloat_imag(dc);
+    output[0] = cfloat_add(fe, fo);
+    output[samples] = cfloat_sub(fe, fo);
+}
+
+#define R2C_LAST_STEP(name, radix, full) \
+void mufft_ ## name ## _c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input, \
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned p, unsigned samples) \
+{ \
+    (void)p; \
+    r2c_last_step_c(output, input, twiddles, r2c_twiddles, samples, radix, full); \
+}
+R2C_LAST_STEP(r2c_radix8_last, 8, 0)
+R2C_LAST_STEP(r2c_radix4_last, 4, 0)
+R2C_LAST_STEP(r2c_radix2_last, 2, 0)
+R2C_LAST_STEP(r2c_full_radix8_last, 8, 1)
+R2C_LAST_STEP(r2c_full_radix4_last, 4, 1)
+R2C_LAST_STEP(r2c_full_radix2_last, 2, 1)
+
+static inline void radix8_generic_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples, float scale, int compact)
+{
     unsigned octa_samples = samples >> 3;
+    const cfloat *twiddles2 = next_twiddle_level_c(twiddles, p, compact);
+    const cfloat *twiddles4 = next_twiddle_level_c(twiddles2, 2 * p, compact);
     for (unsigned i = 0; i < octa_samples; i++)
     {
         unsigned k = i & (p - 1);
-        cfloat a = input[i];
-        cfloat b = input[i + octa_samples];
-        cfloat c = input[i + 2 * octa_samples];
-        cfloat d = input[i + 3 * octa_samples];
-        cfloat e = cfloat_mul(twiddles[k], input[i + 4 * octa_samples]);
-        cfloat f = cfloat_mul(twiddles[k], input[i + 5 * octa_samples]);
-        cfloat g = cfloat_mul(twiddles[k], input[i + 6 * octa_samples]);
-        cfloat h = cfloat_mul(twiddles[k], input[i + 7 * octa_samples]);
+        cfloat w = level_twiddle_c(twiddles, p, k, compact);
+        cfloat a = cfloat_mul_scalar(scale, input[i]);
+        cfloat b = cfloat_mul_scalar(scale, input[i + octa_samples]);
+        cfloat c = cfloat_mul_scalar(scale, input[i + 2 * octa_samples]);
+        cfloat d = cfloat_mul_scalar(scale, input[i + 3 * octa_samples]);
+        cfloat e = cfloat_mul(w, cfloat_mul_scalar(scale, input[i + 4 * octa_samples]));
+        cfloat f = cfloat_mul(w, cfloat_mul_scalar(scale, input[i + 5 * octa_samples]));
+        cfloat g = cfloat_mul(w, cfloat_mul_scalar(scale, input[i + 6 * octa_samples]));
+        cfloat h = cfloat_mul(w, cfloat_mul_scalar(scale, input[i + 7 * octa_samples]));
 
         cfloat r0 = cfloat_add(a, e); // 0O + 0
         cfloat r1 = cfloat_sub(a, e); // 0O + 1
@@ -420,10 +874,10 @@ void mufft_radix8_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
         cfloat r6 = cfloat_add(d, h); // 60 + 0
         cfloat r7 = cfloat_sub(d, h); // 6O + 1
 
-        r4 = cfloat_mul(r4, twiddles[p + k]);
-        r5 = cfloat_mul(r5, twiddles[p + k + p]);
-        r6 = cfloat_mul(r6, twiddles[p + k]);
-        r7 = cfloat_mul(r7, twiddles[p + k + p]);
+        r4 = cfloat_mul(r4, level_twiddle_c(twiddles2, 2 * p, k, compact));
+        r5 = cfloat_mul(r5, level_twiddle_c(twiddles2, 2 * p, p + k, compact));
+        r6 = cfloat_mul(r6, level_twiddle_c(twiddles2, 2 * p, k, compact));
+        r7 = cfloat_mul(r7, level_twiddle_c(twiddles2, 2 * p, p + k, compact));
 
         a = cfloat_add(r0, r4); // 0O + 0
         b = cfloat_add(r1, r5); // 0O + 1
@@ -435,10 +889,10 @@ void mufft_radix8_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
         h = cfloat_sub(r3, r7); // 4O + 3
 
         // p == 4 twiddles
-        e = cfloat_mul(e, twiddles[3 * p + k]);
-        f = cfloat_mul(f, twiddles[3 * p + k + p]);
-        g = cfloat_mul(g, twiddles[3 * p + k + 2 * p]);
-        h = cfloat_mul(h, twiddles[3 * p + k + 3 * p]);
+        e = cfloat_mul(e, level_twiddle_c(twiddles4, 4 * p, k, compact));
+        f = cfloat_mul(f, level_twiddle_c(twiddles4, 4 * p, k + p, compact));
+        g = cfloat_mul(g, level_twiddle_c(twiddles4, 4 * p, k + 2 * p, compact));
+        h = cfloat_mul(h, level_twiddle_c(twiddles4, 4 * p, k + 3 * p, compact));
 
         unsigned j = ((i - k) << 3) + k;
         output[j + 0 * p] = cfloat_add(a, e);
@@ -452,8 +906,100 @@ void mufft_radix8_generic_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
     }
 }
 
+void mufft_radix8_generic_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix8_generic_c(output, input, twiddles, p, samples, 1.0f, 0);
+}
+
+void mufft_radix8_generic_scale_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, float scale, unsigned p, unsigned samples)
+{
+    radix8_generic_c(output, input, twiddles, p, samples, scale, 0);
+}
+
+static inline void radix8_broadcast_c(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples, int compact)
+{
+    unsigned octa_samples = samples >> 3;
+    const cfloat *twiddles2 = next_twiddle_level_c(twiddles, p, compact);
+    const cfloat *twiddles4 = next_twiddle_level_c(twiddles2, 2 * p, compact);
+    unsigned line_stride = octa_samples / p;
+    for (unsigned i = 0; i < octa_samples; i++)
+    {
+        unsigned k = i & (p - 1);
+        cfloat w = level_twiddle_c(twiddles, p, k, compact);
+        unsigned line = i / p;
+        cfloat a = input[line];
+        cfloat b = input[line + line_stride];
+        cfloat c = input[line + 2 * line_stride];
+        cfloat d = input[line + 3 * line_stride];
+        cfloat e = cfloat_mul(w, input[line + 4 * line_stride]);
+        cfloat f = cfloat_mul(w, input[line + 5 * line_stride]);
+        cfloat g = cfloat_mul(w, input[line + 6 * line_stride]);
+        cfloat h = cfloat_mul(w, input[line + 7 * line_stride]);
+
+        cfloat r0 = cfloat_add(a, e); // 0O + 0
+        cfloat r1 = cfloat_sub(a, e); // 0O + 1
+        cfloat r2 = cfloat_add(b, f); // 2O + 0
+        cfloat r3 = cfloat_sub(b, f); // 2O + 1
+        cfloat r4 = cfloat_add(c, g); // 4O + 0
+        cfloat r5 = cfloat_sub(c, g); // 4O + 1
+        cfloat r6 = cfloat_add(d, h); // 60 + 0
+        cfloat r7 = cfloat_sub(d, h); // 6O + 1
+
+        r4 = cfloat_mul(r4, level_twiddle_c(twiddles2, 2 * p, k, compact));
+        r5 = cfloat_mul(r5, level_twiddle_c(twiddles2, 2 * p, p + k, compact));
+        r6 = cfloat_mul(r6, level_twiddle_c(twiddles2, 2 * p, k, compact));
+        r7 = cfloat_mul(r7, level_twiddle_c(twiddles2, 2 * p, p + k, compact));
+
+        a = cfloat_add(r0, r4); // 0O + 0
+        b = cfloat_add(r1, r5); // 0O + 1
+        c = cfloat_sub(r0, r4); // 00 + 2
+        d = cfloat_sub(r1, r5); // O0 + 3
+        e = cfloat_add(r2, r6); // 4O + 0
+        f = cfloat_add(r3, r7); // 4O + 1
+        g = cfloat_sub(r2, r6); // 4O + 2
+        h = cfloat_sub(r3, r7); // 4O + 3
+
+        // p == 4 twiddles
+        e = cfloat_mul(e, level_twiddle_c(twiddles4, 4 * p, k, compact));
+        f = cfloat_mul(f, level_twiddle_c(twiddles4, 4 * p, k + p, compact));
+        g = cfloat_mul(g, level_twiddle_c(twiddles4, 4 * p, k + 2 * p, compact));
+        h = cfloat_mul(h, level_twiddle_c(twiddles4, 4 * p, k + 3 * p, compact));
+
+        unsigned j = ((i - k) << 3) + k;
+        output[j + 0 * p] = cfloat_add(a, e);
+        output[j + 1 * p] = cfloat_add(b, f);
+        output[j + 2 * p] = cfloat_add(c, g);
+        output[j + 3 * p] = cfloat_add(d, h);
+        output[j + 4 * p] = cfloat_sub(a, e);
+        output[j + 5 * p] = cfloat_sub(b, f);
+        output[j + 6 * p] = cfloat_sub(c, g);
+        output[j + 7 * p] = cfloat_sub(d, h);
+    }
+}
+
+void mufft_radix8_broadcast_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix8_broadcast_c(output, input, twiddles, p, samples, 0);
+}
+
+void mufft_radix8_compact_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix8_generic_c(output, input, twiddles, p, samples, 1.0f, 1);
+}
+
+void mufft_radix8_broadcast_compact_c(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+{
+    radix8_broadcast_c(output, input, twiddles, p, samples, 1);
+}
+
 void mufft_radix2_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
@@ -461,10 +1007,10 @@ void mufft_radix2_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
     (void)p;
 
     unsigned half_lines = samples_y >> 1;
-    unsigned half_stride = stride * half_lines;
+    unsigned half_stride = input_stride * half_lines;
 
     for (unsigned line = 0; line < half_lines;
-            line++, input += stride, output += stride << 1)
+            line++, input += input_stride, output += output_stride << 1)
     {
         for (unsigned i = 0; i < samples_x; i++)
         {
@@ -475,26 +1021,48 @@ void mufft_radix2_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RE
             cfloat r1 = cfloat_sub(a, b); // 0O + 1
 
             output[i] = r0;
-            output[i + 1 * stride] = r1;
+            output[i + 1 * output_stride] = r1;
+        }
+    }
+}
+
+void mufft_radix2_half_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
+{
+    cfloat *output = output_;
+    const cfloat *input = input_;
+    (void)twiddles;
+    (void)p;
+
+    unsigned half_lines = samples_y >> 1;
+
+    for (unsigned line = 0; line < half_lines;
+            line++, input += input_stride, output += output_stride << 1)
+    {
+        for (unsigned i = 0; i < samples_x; i++)
+        {
+            cfloat a = input[i];
+            output[i] = a;
+            output[i + 1 * output_stride] = a;
         }
     }
 }
 
 void mufft_radix2_generic_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
 
     unsigned half_lines = samples_y >> 1;
-    unsigned half_stride = stride * half_lines;
-    unsigned out_stride = p * stride;
+    unsigned half_stride = input_stride * half_lines;
+    unsigned out_stride = p * output_stride;
 
     for (unsigned line = 0; line < half_lines;
-            line++, input += stride)
+            line++, input += input_stride)
     {
         unsigned k = line & (p - 1);
-        unsigned j = ((line << 1) - k) * stride;
+        unsigned j = ((line << 1) - k) * output_stride;
 
         for (unsigned i = 0; i < samples_x; i++)
         {
@@ -511,7 +1079,7 @@ void mufft_radix2_generic_vert_c(void * MUFFT_RESTRICT output_, const void * MUF
 }
 
 void mufft_forward_radix4_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
@@ -519,10 +1087,10 @@ void mufft_forward_radix4_p1_vert_c(void * MUFFT_RESTRICT output_, const void *
     (void)p;
 
     unsigned quarter_lines = samples_y >> 2;
-    unsigned quarter_stride = stride * quarter_lines;
+    unsigned quarter_stride = input_stride * quarter_lines;
 
     for (unsigned line = 0; line < quarter_lines;
-            line++, input += stride, output += stride << 2)
+            line++, input += input_stride, output += output_stride << 2)
     {
         for (unsigned i = 0; i < samples_x; i++)
         {
@@ -545,33 +1113,74 @@ void mufft_forward_radix4_p1_vert_c(void * MUFFT_RESTRICT output_, const void *
             d = cfloat_sub(r1, r3); // O0 + 3
 
             output[i] = a;
-            output[i + 1 * stride] = b;
-            output[i + 2 * stride] = c;
-            output[i + 3 * stride] = d;
+            output[i + 1 * output_stride] = b;
+            output[i + 2 * output_stride] = c;
+            output[i + 3 * output_stride] = d;
+        }
+    }
+}
+
+void mufft_forward_half_radix4_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
+{
+    cfloat *output = output_;
+    const cfloat *input = input_;
+    (void)twiddles;
+    (void)p;
+
+    unsigned quarter_lines = samples_y >> 2;
+    unsigned quarter_stride = input_stride * quarter_lines;
+
+    for (unsigned line = 0; line < quarter_lines;
+            line++, input += input_stride, output += output_stride << 2)
+    {
+        for (unsigned i = 0; i < samples_x; i++)
+        {
+            cfloat a = input[i];
+            cfloat b = input[i + quarter_stride];
+            cfloat c, d;
+
+            cfloat r0 = a;
+            cfloat r1 = a;
+            cfloat r2 = b;
+            cfloat r3 = b;
+
+            // p == 2 twiddles
+            r3 = cfloat_mul(r3, twiddles[2]);
+
+            a = cfloat_add(r0, r2); // 0O + 0
+            b = cfloat_add(r1, r3); // 0O + 1
+            c = cfloat_sub(r0, r2); // 00 + 2
+            d = cfloat_sub(r1, r3); // O0 + 3
+
+            output[i] = a;
+            output[i + 1 * output_stride] = b;
+            output[i + 2 * output_stride] = c;
+            output[i + 3 * output_stride] = d;
         }
     }
 }
 
 void mufft_inverse_radix4_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
-    mufft_forward_radix4_p1_vert_c(output_, input_, twiddles, p, samples_x, stride, samples_y);
+    mufft_forward_radix4_p1_vert_c(output_, input_, twiddles, p, samples_x, input_stride, output_stride, samples_y);
 }
 
 void mufft_radix4_generic_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
 
     unsigned quarter_lines = samples_y >> 2;
-    unsigned quarter_stride = stride* quarter_lines;
-    unsigned out_stride = p * stride;
+    unsigned quarter_stride = input_stride * quarter_lines;
+    unsigned out_stride = p * output_stride;
 
-    for (unsigned line = 0; line < quarter_lines; line++, input += stride)
+    for (unsigned line = 0; line < quarter_lines; line++, input += input_stride)
     {
         unsigned k = line & (p - 1);
-        unsigned j = (((line - k) << 2) + k) * stride;
+        unsigned j = (((line - k) << 2) + k) * output_stride;
 
         for (unsigned i = 0; i < samples_x; i++)
         {
@@ -602,17 +1211,17 @@ void mufft_radix4_generic_vert_c(void * MUFFT_RESTRICT output_, const void * MUF
 }
 
 void mufft_forward_radix8_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
     (void)p;
 
     unsigned octa_lines = samples_y >> 3;
-    unsigned octa_stride = stride * octa_lines;
+    unsigned octa_stride = input_stride * octa_lines;
 
     for (unsigned line = 0; line < octa_lines;
-            line++, input += stride, output += stride << 3)
+            line++, input += input_stride, output += output_stride << 3)
     {
         for (unsigned i = 0; i < samples_x; i++)
         {
@@ -653,37 +1262,97 @@ void mufft_forward_radix8_p1_vert_c(void * MUFFT_RESTRICT output_, const void *
             h = cfloat_mul(h, twiddles[7]);
 
             output[i] = cfloat_add(a, e);
-            output[i + 1 * stride] = cfloat_add(b, f);
-            output[i + 2 * stride] = cfloat_add(c, g);
-            output[i + 3 * stride] = cfloat_add(d, h);
-            output[i + 4 * stride] = cfloat_sub(a, e);
-            output[i + 5 * stride] = cfloat_sub(b, f);
-            output[i + 6 * stride] = cfloat_sub(c, g);
-            output[i + 7 * stride] = cfloat_sub(d, h);
+            output[i + 1 * output_stride] = cfloat_add(b, f);
+            output[i + 2 * output_stride] = cfloat_add(c, g);
+            output[i + 3 * output_stride] = cfloat_add(d, h);
+            output[i + 4 * output_stride] = cfloat_sub(a, e);
+            output[i + 5 * output_stride] = cfloat_sub(b, f);
+            output[i + 6 * output_stride] = cfloat_sub(c, g);
+            output[i + 7 * output_stride] = cfloat_sub(d, h);
+        }
+    }
+}
+
+void mufft_forward_half_radix8_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
+{
+    cfloat *output = output_;
+    const cfloat *input = input_;
+    (void)p;
+
+    unsigned octa_lines = samples_y >> 3;
+    unsigned octa_stride = input_stride * octa_lines;
+
+    for (unsigned line = 0; line < octa_lines;
+            line++, input += input_stride, output += output_stride << 3)
+    {
+        for (unsigned i = 0; i < samples_x; i++)
+        {
+            cfloat a = input[i];
+            cfloat b = input[i + octa_stride];
+            cfloat c = input[i + 2 * octa_stride];
+            cfloat d = input[i + 3 * octa_stride];
+            cfloat e, f, g, h;
+
+            cfloat r0 = a;
+            cfloat r1 = a;
+            cfloat r2 = b;
+            cfloat r3 = b;
+            cfloat r4 = c;
+            cfloat r5 = c;
+            cfloat r6 = d;
+            cfloat r7 = d;
+
+            // p == 2 twiddles
+            r5 = cfloat_mul(r5, twiddles[2]);
+            r7 = cfloat_mul(r7, twiddles[2]);
+
+            a = cfloat_add(r0, r4); // 0O + 0
+            b = cfloat_add(r1, r5); // 0O + 1
+            c = cfloat_sub(r0, r4); // 00 + 2
+            d = cfloat_sub(r1, r5); // O0 + 3
+            e = cfloat_add(r2, r6); // 4O + 0
+            f = cfloat_add(r3, r7); // 4O + 1
+            g = cfloat_sub(r2, r6); // 4O + 2
+            h = cfloat_sub(r3, r7); // 4O + 3
+
+            // p == 4 twiddles
+            f = cfloat_mul(f, twiddles[5]);
+            g = cfloat_mul(g, twiddles[6]);
+            h = cfloat_mul(h, twiddles[7]);
+
+            output[i] = cfloat_add(a, e);
+            output[i + 1 * output_stride] = cfloat_add(b, f);
+            output[i + 2 * output_stride] = cfloat_add(c, g);
+            output[i + 3 * output_stride] = cfloat_add(d, h);
+            output[i + 4 * output_stride] = cfloat_sub(a, e);
+            output[i + 5 * output_stride] = cfloat_sub(b, f);
+            output[i + 6 * output_stride] = cfloat_sub(c, g);
+            output[i + 7 * output_stride] = cfloat_sub(d, h);
         }
     }
 }
 
 void mufft_inverse_radix8_p1_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
-    mufft_forward_radix8_p1_vert_c(output_, input_, twiddles, p, samples_x, stride, samples_y);
+    mufft_forward_radix8_p1_vert_c(output_, input_, twiddles, p, samples_x, input_stride, output_stride, samples_y);
 }
 
 void mufft_radix8_generic_vert_c(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
 
     unsigned octa_lines = samples_y >> 3;
-    unsigned octa_stride = stride * octa_lines;
-    unsigned out_stride = p * stride;
+    unsigned octa_stride = input_stride * octa_lines;
+    unsigned out_stride = p * output_stride;
 
-    for (unsigned line = 0; line < octa_lines; line++, input += stride)
+    for (unsigned line = 0; line < octa_lines; line++, input += input_stride)
     {
         unsigned k = line & (p - 1);
-        unsigned j = (((line - k) << 3) + k) * stride;
+        unsigned j = (((line - k) << 3) + k) * output_stride;
 
         for (unsigned i = 0; i < samples_x; i++)
         {
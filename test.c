@@ -23,11 +23,25 @@
 #include "fft.h"
 #include "fft_internal.h"
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#endif
+
 #include <fftw3.h> // Used as a reference.
 
+// Checks if a 2D input sample is assumed to be zero by the zero padding flags.
+static int is_zero_padded_2d(unsigned x, unsigned y, unsigned Nx, unsigned Ny, unsigned flags)
+{
+    return ((flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF) && x >= Nx / 2) ||
+        ((flags & MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y) && y >= Ny / 2);
+}
+
 static void test_fft_2d(unsigned Nx, unsigned Ny, int direction, unsigned flags)
 {
     cfloat *input = mufft_alloc(Nx * Ny * sizeof(cfloat));
@@ -49,6 +63,16 @@ static void test_fft_2d(unsigned Nx, unsigned Ny, int direction, unsigned flags)
     mufft_assert(plan != NULL);
     memcpy(input_fftw, input, Nx * Ny * sizeof(cfloat));
 
+    // Put garbage in the padding for muFFT, it must not be read.
+    for (unsigned i = 0; i < Nx * Ny; i++)
+    {
+        if (is_zero_padded_2d(i % Nx, i / Nx, Nx, Ny, flags))
+        {
+            input_fftw[i] = cfloat_create(0.0f, 0.0f);
+            input[i] = cfloat_create(1000.0f, -1000.0f);
+        }
+    }
+
     mufft_plan_2d *muplan = mufft_create_plan_2d_c2c(Nx, Ny, direction, flags);
     mufft_assert(muplan != NULL);
 
@@ -58,7 +82,23 @@ static void test_fft_2d(unsigned Nx, unsigned Ny, int direction, unsigned flags)
     const float epsilon = 0.000001f * sqrtf(Nx * Ny);
     for (unsigned i = 0; i < Nx * Ny; i++)
     {
-        float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+        unsigned x = i % Nx;
+        unsigned y = i / Nx;
+        unsigned index = (flags & MUFFT_FLAG_2D_TRANSPOSED_OUTPUT) != 0 ? x * Ny + y : i;
+        float delta = cfloat_abs(cfloat_sub(output[index], output_fftw[i]));
+        mufft_assert(delta < epsilon);
+    }
+
+    // In place.
+    memcpy(output, input, Nx * Ny * sizeof(cfloat));
+    mufft_execute_plan_2d(muplan, output, output);
+
+    for (unsigned i = 0; i < Nx * Ny; i++)
+    {
+        unsigned x = i % Nx;
+        unsigned y = i / Nx;
+        unsigned index = (flags & MUFFT_FLAG_2D_TRANSPOSED_OUTPUT) != 0 ? x * Ny + y : i;
+        float delta = cfloat_abs(cfloat_sub(output[index], output_fftw[i]));
         mufft_assert(delta < epsilon);
     }
 
@@ -90,6 +130,15 @@ static void test_fft_2d_r2c(unsigned Nx, unsigned Ny, unsigned flags)
     mufft_assert(plan != NULL);
     memcpy(input_fftw, input, Nx * Ny * sizeof(float));
 
+    for (unsigned i = 0; i < Nx * Ny; i++)
+    {
+        if (is_zero_padded_2d(i % Nx, i / Nx, Nx, Ny, flags))
+        {
+            input_fftw[i] = 0.0f;
+            input[i] = 1000.0f;
+        }
+    }
+
     mufft_plan_2d *muplan = mufft_create_plan_2d_r2c(Nx, Ny, flags);
     mufft_assert(muplan != NULL);
 
@@ -106,6 +155,19 @@ static void test_fft_2d_r2c(unsigned Nx, unsigned Ny, unsigned flags)
         }
     }
 
+    // In place.
+    memcpy(output, input, Nx * Ny * sizeof(float));
+    mufft_execute_plan_2d(muplan, output, output);
+
+    for (unsigned y = 0; y < Ny; y++)
+    {
+        for (unsigned x = 0; x < fftN; x++)
+        {
+            float delta = cfloat_abs(cfloat_sub(output[y * Nx + x], output_fftw[y * fftN + x]));
+            mufft_assert(delta < epsilon);
+        }
+    }
+
     mufft_free(input);
     mufft_free(output);
     mufft_free_plan_2d(muplan);
@@ -158,50 +220,643 @@ static void test_fft_2d_c2r(unsigned Nx, unsigned Ny, unsigned flags)
         mufft_assert(delta < epsilon);
     }
 
+    // In place, which overwrites the input.
+    mufft_execute_plan_2d(muplan, input, input);
+
+    for (unsigned i = 0; i < Nx * Ny; i++)
+    {
+        float delta = fabsf(((const float*)input)[i] - output_fftw[i]);
+        mufft_assert(delta < epsilon);
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free_plan_2d(muplan);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+// A normalized transform followed by an unnormalized one, or two orthonormal transforms, must give back the input.
+static void test_fft_2d_normalize(unsigned Nx, unsigned Ny, unsigned flags)
+{
+    cfloat *input = mufft_alloc(Nx * Ny * sizeof(cfloat));
+    cfloat *output = mufft_alloc(2 * Nx * Ny * sizeof(cfloat));
+    cfloat *result = mufft_alloc(2 * Nx * Ny * sizeof(cfloat));
+
+    srand(0);
+    for (unsigned i = 0; i < Nx * Ny; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = cfloat_create(real, imag);
+    }
+
+    const float epsilon = 0.000001f * sqrtf(Nx * Ny);
+    static const unsigned forward_flags[] = { MUFFT_FLAG_NORMALIZE, 0, MUFFT_FLAG_NORMALIZE_ORTHO };
+    static const unsigned inverse_flags[] = { 0, MUFFT_FLAG_NORMALIZE, MUFFT_FLAG_NORMALIZE_ORTHO };
+    static const unsigned layout_flags[] = { 0, MUFFT_FLAG_2D_TRANSPOSE, MUFFT_FLAG_COMPACT_R2C };
+    for (unsigned f = 0; f < ARRAY_SIZE(forward_flags); f++)
+    {
+        mufft_plan_2d *forward = mufft_create_plan_2d_c2c(Nx, Ny, MUFFT_FORWARD,
+                flags | forward_flags[f] | layout_flags[f]);
+        mufft_plan_2d *inverse = mufft_create_plan_2d_c2c(Nx, Ny, MUFFT_INVERSE, flags | inverse_flags[f]);
+        mufft_assert(forward != NULL && inverse != NULL);
+
+        mufft_execute_plan_2d(forward, output, input);
+        mufft_execute_plan_2d(inverse, result, output);
+        for (unsigned i = 0; i < Nx * Ny; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(result[i], input[i]));
+            mufft_assert(delta < epsilon);
+        }
+
+        mufft_free_plan_2d(forward);
+        mufft_free_plan_2d(inverse);
+
+        // Reinterpret the input as 2 * Nx real samples per row.
+        forward = mufft_create_plan_2d_r2c(2 * Nx, Ny, flags | forward_flags[f] | layout_flags[f]);
+        inverse = mufft_create_plan_2d_c2r(2 * Nx, Ny, flags | inverse_flags[f] | layout_flags[f]);
+        mufft_assert(forward != NULL && inverse != NULL);
+
+        mufft_execute_plan_2d(forward, output, input);
+        mufft_execute_plan_2d(inverse, result, output);
+        for (unsigned i = 0; i < Nx * Ny; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(result[i], input[i]));
+            mufft_assert(delta < epsilon);
+        }
+
+        mufft_free_plan_2d(forward);
+        mufft_free_plan_2d(inverse);
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free(result);
+}
+
+// Transforms a region of interest in place inside a larger image with padded rows.
+static void test_fft_2d_pitched(unsigned Nx, unsigned Ny, int direction, unsigned flags)
+{
+    unsigned pitch = ((Nx + 3) & ~3u) + 8;
+    unsigned rows = Ny + 2;
+    cfloat *image = mufft_alloc(pitch * rows * sizeof(cfloat));
+    cfloat *reference = mufft_alloc(pitch * rows * sizeof(cfloat));
+    cfloat *input_fftw = fftwf_malloc(Nx * Ny * sizeof(fftwf_complex));
+    cfloat *output_fftw = fftwf_malloc(Nx * Ny * sizeof(fftwf_complex));
+    cfloat *roi = image + pitch + 4;
+
+    srand(0);
+    for (unsigned i = 0; i < pitch * rows; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        image[i] = cfloat_create(real, imag);
+    }
+    memcpy(reference, image, pitch * rows * sizeof(cfloat));
+
+    fftwf_plan plan = fftwf_plan_dft_2d(Ny, Nx,
+                                        (fftwf_complex *)input_fftw, (fftwf_complex *)output_fftw,
+                                        direction, FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+    for (unsigned y = 0; y < Ny; y++)
+    {
+        for (unsigned x = 0; x < Nx; x++)
+        {
+            input_fftw[y * Nx + x] = is_zero_padded_2d(x, y, Nx, Ny, flags) ?
+                cfloat_create(0.0f, 0.0f) : roi[y * pitch + x];
+        }
+    }
+
+    mufft_plan_2d *muplan = mufft_create_plan_2d_c2c_pitched(Nx, Ny, direction, flags, pitch, pitch);
+    mufft_assert(muplan != NULL);
+
+    fftwf_execute(plan);
+    mufft_execute_plan_2d(muplan, roi, roi);
+
+    const float epsilon = 0.000001f * sqrtf(Nx * Ny);
+    for (unsigned i = 0; i < pitch * rows; i++)
+    {
+        unsigned x = i % pitch;
+        unsigned y = i / pitch;
+        if (y >= 1 && y < Ny + 1 && x >= 4 && x < Nx + 4)
+        {
+            float delta = cfloat_abs(cfloat_sub(image[i], output_fftw[(y - 1) * Nx + x - 4]));
+            mufft_assert(delta < epsilon);
+        }
+        else
+        {
+            // Everything outside the region of interest must be left alone.
+            mufft_assert(memcmp(&image[i], &reference[i], sizeof(cfloat)) == 0);
+        }
+    }
+
+    mufft_free(image);
+    mufft_free(reference);
+    mufft_free_plan_2d(muplan);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+// If pitched is zero, rows are tightly packed and a regular plan is used.
+static void test_fft_2d_r2c_pitched(unsigned Nx, unsigned Ny, unsigned flags, int pitched)
+{
+    unsigned fftN = Nx / 2 + 1;
+    unsigned compact_nx = (flags & MUFFT_FLAG_COMPACT_R2C) != 0 ? fftN : Nx;
+    unsigned input_pitch = pitched ? ((Nx + 7) & ~7u) + 8 : Nx;
+    unsigned output_pitch = pitched ? compact_nx + 4 : compact_nx;
+    float *input = mufft_alloc(input_pitch * Ny * sizeof(float));
+    cfloat *output = mufft_alloc(output_pitch * Ny * sizeof(cfloat));
+    float *input_fftw = fftwf_malloc(Nx * Ny * sizeof(float));
+    cfloat *output_fftw = fftwf_malloc(fftN * Ny * sizeof(fftwf_complex));
+
+    srand(0);
+    for (unsigned i = 0; i < input_pitch * Ny; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = real;
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_r2c_2d(Ny, Nx, input_fftw, (fftwf_complex *)output_fftw,
+            FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+    for (unsigned y = 0; y < Ny; y++)
+    {
+        memcpy(input_fftw + y * Nx, input + y * input_pitch, Nx * sizeof(float));
+    }
+
+    mufft_plan_2d *muplan = pitched ?
+        mufft_create_plan_2d_r2c_pitched(Nx, Ny, flags, input_pitch, output_pitch) :
+        mufft_create_plan_2d_r2c(Nx, Ny, flags);
+    mufft_assert(muplan != NULL);
+
+    fftwf_execute(plan);
+    mufft_execute_plan_2d(muplan, output, input);
+
+    const float epsilon = 0.000001f * sqrtf(Nx * Ny);
+    for (unsigned y = 0; y < Ny; y++)
+    {
+        for (unsigned x = 0; x < fftN; x++)
+        {
+            float delta = cfloat_abs(cfloat_sub(output[y * output_pitch + x], output_fftw[y * fftN + x]));
+            mufft_assert(delta < epsilon);
+        }
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free_plan_2d(muplan);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+static void test_fft_2d_c2r_pitched(unsigned Nx, unsigned Ny, unsigned flags, int pitched)
+{
+    unsigned fftN = Nx / 2 + 1;
+    unsigned compact_nx = (flags & MUFFT_FLAG_COMPACT_R2C) != 0 ? fftN : Nx;
+    unsigned input_pitch = pitched ? compact_nx + 4 : compact_nx;
+    unsigned output_pitch = pitched ? ((Nx + 7) & ~7u) + 8 : Nx;
+    cfloat *input = mufft_calloc(input_pitch * Ny * sizeof(cfloat));
+    float *output = mufft_alloc(output_pitch * Ny * sizeof(float));
+    cfloat *input_fftw = fftwf_malloc(fftN * Ny * sizeof(cfloat));
+    float *output_fftw = fftwf_malloc(Nx * Ny * sizeof(float));
+
+    srand(0);
+    for (unsigned y = 0; y < Ny; y++)
+    {
+        for (unsigned x = 1; x < Nx / 2; x++)
+        {
+            float real = (float)rand() / RAND_MAX - 0.5f;
+            float imag = (float)rand() / RAND_MAX - 0.5f;
+            input[y * input_pitch + x] = cfloat_create(real, imag);
+        }
+    }
+    input[0].real = (float)rand() / RAND_MAX - 0.5f;
+    input[Ny / 2 * input_pitch].real = (float)rand() / RAND_MAX - 0.5f;
+    input[Nx / 2].real = (float)rand() / RAND_MAX - 0.5f;
+    input[Ny / 2 * input_pitch + Nx / 2].real = (float)rand() / RAND_MAX - 0.5f;
+
+    // The output is not used as scratch, so padding between rows must survive.
+    for (unsigned i = 0; i < output_pitch * Ny; i++)
+    {
+        output[i] = 1000.0f;
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_c2r_2d(Ny, Nx, (fftwf_complex *)input_fftw, output_fftw,
+                                            FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+    for (unsigned y = 0; y < Ny; y++)
+    {
+        memcpy(input_fftw + fftN * y, input + input_pitch * y, fftN * sizeof(cfloat));
+    }
+
+    mufft_plan_2d *muplan = pitched ?
+        mufft_create_plan_2d_c2r_pitched(Nx, Ny, flags, input_pitch, output_pitch) :
+        mufft_create_plan_2d_c2r(Nx, Ny, flags);
+    mufft_assert(muplan != NULL);
+
+    fftwf_execute(plan);
+    mufft_execute_plan_2d(muplan, output, input);
+
+    const float epsilon = 0.000001f * sqrtf(Nx * Ny);
+    for (unsigned y = 0; y < Ny; y++)
+    {
+        for (unsigned x = 0; x < output_pitch; x++)
+        {
+            if (x < Nx)
+            {
+                float delta = fabsf(output[y * output_pitch + x] - output_fftw[y * Nx + x]);
+                mufft_assert(delta < epsilon);
+            }
+            else
+            {
+                mufft_assert(output[y * output_pitch + x] == 1000.0f);
+            }
+        }
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free_plan_2d(muplan);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+static void test_fft_1d(unsigned N, int direction, unsigned flags)
+{
+    cfloat *input = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    cfloat *input_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+    cfloat *output_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+
+    srand(0);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = cfloat_create(real, imag);
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_1d(N, (fftwf_complex *)input_fftw, (fftwf_complex *)output_fftw,
+                                        direction, FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+    memcpy(input_fftw, input, N * sizeof(cfloat));
+
+    // The plan shares twiddle factors with a plan for a larger transform, which must stay valid after that plan is freed.
+    mufft_plan_1d *larger_muplan = mufft_create_plan_1d_c2c(2 * N, direction, flags);
+    mufft_assert(larger_muplan != NULL);
+    mufft_plan_1d *muplan = mufft_create_plan_1d_c2c(N, direction, flags);
+    mufft_assert(muplan != NULL);
+    mufft_free_plan_1d(larger_muplan);
+
+    fftwf_execute(plan);
+    mufft_execute_plan_1d(muplan, output, input);
+
+    const float epsilon = 0.000001f * sqrtf(N);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+        mufft_assert(delta < epsilon);
+    }
+
+    // In place.
+    memcpy(output, input, N * sizeof(cfloat));
+    mufft_execute_plan_1d(muplan, output, output);
+
+    for (unsigned i = 0; i < N; i++)
+    {
+        float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+        mufft_assert(delta < epsilon);
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free_plan_1d(muplan);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+static void test_fft_1d_pruned(unsigned N, int direction, unsigned flags)
+{
+    cfloat *input = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    cfloat *input_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+    cfloat *output_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+
+    srand(0);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = cfloat_create(real, imag);
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_1d(N, (fftwf_complex *)input_fftw, (fftwf_complex *)output_fftw,
+                                        direction, FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+    memcpy(input_fftw, input, N * sizeof(cfloat));
+    fftwf_execute(plan);
+
+    // Narrow band, single bin, band wrapping around DC and the full range.
+    const unsigned ranges[][2] = {
+        { N / 3, N / 50 + 1 },
+        { N / 2 - 1, 1 },
+        { N - 1 - N / 4, N / 2 + 1 },
+        { 0, N },
+    };
+
+    const float epsilon = 0.000001f * sqrtf(N);
+    for (unsigned r = 0; r < ARRAY_SIZE(ranges); r++)
+    {
+        unsigned first_bin = ranges[r][0];
+        unsigned num_bins = ranges[r][1];
+
+        mufft_plan_1d *muplan = mufft_create_plan_1d_c2c_pruned(N, direction, flags, first_bin, num_bins);
+        mufft_assert(muplan != NULL);
+        mufft_execute_plan_1d(muplan, output, input);
+
+        for (unsigned i = 0; i < num_bins; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[(first_bin + i) & (N - 1)]));
+            mufft_assert(delta < epsilon);
+        }
+
+        memcpy(output, input, N * sizeof(cfloat));
+        mufft_execute_plan_1d(muplan, output, output);
+
+        for (unsigned i = 0; i < num_bins; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[(first_bin + i) & (N - 1)]));
+            mufft_assert(delta < epsilon);
+        }
+
+        mufft_free_plan_1d(muplan);
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+static void test_fft_1d_zero_pad(unsigned N, int direction, unsigned flags)
+{
+    cfloat *input = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    cfloat *input_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+    cfloat *output_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+
+    fftwf_plan plan = fftwf_plan_dft_1d(N, (fftwf_complex *)input_fftw, (fftwf_complex *)output_fftw,
+                                        direction, FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+
+    // Single sample, non power-of-two, power-of-two and almost full input.
+    const unsigned lengths[] = { 1, N / 8 + 1, N / 4 + (N < 4), N - 1 + (N < 2) };
+
+    const float epsilon = 0.000001f * sqrtf(N);
+    for (unsigned l = 0; l < ARRAY_SIZE(lengths); l++)
+    {
+        unsigned input_length = lengths[l];
+
+        srand(0);
+        memset(input_fftw, 0, N * sizeof(cfloat));
+        for (unsigned i = 0; i < input_length; i++)
+        {
+            float real = (float)rand() / RAND_MAX - 0.5f;
+            float imag = (float)rand() / RAND_MAX - 0.5f;
+            input[i] = cfloat_create(real, imag);
+            input_fftw[i] = input[i];
+        }
+
+        // Garbage beyond the non-zero region must not be read.
+        for (unsigned i = input_length; i < N; i++)
+        {
+            input[i] = cfloat_create(1000.0f, -1000.0f);
+        }
+
+        fftwf_execute(plan);
+
+        mufft_plan_1d *muplan = mufft_create_plan_1d_c2c_zero_pad(N, direction, flags, input_length);
+        mufft_assert(muplan != NULL);
+        mufft_execute_plan_1d(muplan, output, input);
+
+        for (unsigned i = 0; i < N; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+            mufft_assert(delta < epsilon);
+        }
+
+        mufft_free_plan_1d(muplan);
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+static void test_fft_1d_r2c_zero_pad(unsigned N, unsigned flags)
+{
+    unsigned fftN = N / 2 + 1;
+    float *input = mufft_alloc(N * sizeof(float));
+    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    float *input_fftw = fftwf_malloc(N * sizeof(float));
+    cfloat *output_fftw = fftwf_malloc(fftN * sizeof(fftwf_complex));
+
+    fftwf_plan plan = fftwf_plan_dft_r2c_1d(N, input_fftw, (fftwf_complex *)output_fftw, FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+
+    // Odd lengths end in the middle of a complex sample.
+    const unsigned lengths[] = { 1, N / 8 + 3, N / 4, N - 1 };
+
+    const float epsilon = 0.000001f * sqrtf(N);
+    for (unsigned l = 0; l < ARRAY_SIZE(lengths); l++)
+    {
+        unsigned input_length = lengths[l];
+
+        srand(0);
+        memset(input_fftw, 0, N * sizeof(float));
+        for (unsigned i = 0; i < input_length; i++)
+        {
+            input[i] = (float)rand() / RAND_MAX - 0.5f;
+            input_fftw[i] = input[i];
+        }
+
+        for (unsigned i = input_length; i < N; i++)
+        {
+            input[i] = 1000.0f;
+        }
+
+        fftwf_execute(plan);
+
+        mufft_plan_1d *muplan = mufft_create_plan_1d_r2c_zero_pad(N, flags, input_length);
+        mufft_assert(muplan != NULL);
+        mufft_execute_plan_1d(muplan, output, input);
+
+        for (unsigned i = 0; i < fftN; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+            mufft_assert(delta < epsilon);
+        }
+
+        mufft_free_plan_1d(muplan);
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+static void test_fft_3d(unsigned Nx, unsigned Ny, unsigned Nz, int direction, unsigned flags)
+{
+    unsigned N = Nx * Ny * Nz;
+    cfloat *input = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    cfloat *input_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+    cfloat *output_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+
+    srand(0);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = cfloat_create(real, imag);
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_3d(Nz, Ny, Nx,
+                                        (fftwf_complex *)input_fftw, (fftwf_complex *)output_fftw,
+                                        direction, FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+    memcpy(input_fftw, input, N * sizeof(cfloat));
+
+    mufft_plan_3d *muplan = mufft_create_plan_3d_c2c(Nx, Ny, Nz, direction, flags);
+    mufft_assert(muplan != NULL);
+
+    fftwf_execute(plan);
+    mufft_execute_plan_3d(muplan, output, input);
+
+    const float epsilon = 0.000001f * sqrtf(N);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+        mufft_assert(delta < epsilon);
+    }
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free_plan_3d(muplan);
+    fftwf_free(input_fftw);
+    fftwf_free(output_fftw);
+    fftwf_destroy_plan(plan);
+}
+
+static void test_fft_3d_r2c(unsigned Nx, unsigned Ny, unsigned Nz, unsigned flags)
+{
+    unsigned fftN = Nx / 2 + 1;
+    unsigned rows = Ny * Nz;
+    float *input = mufft_alloc(Nx * rows * sizeof(float));
+    cfloat *output = mufft_alloc(Nx * rows * sizeof(cfloat));
+    float *input_fftw = fftwf_malloc(Nx * rows * sizeof(float));
+    cfloat *output_fftw = fftwf_malloc(fftN * rows * sizeof(fftwf_complex));
+
+    srand(0);
+    for (unsigned i = 0; i < Nx * rows; i++)
+    {
+        input[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_r2c_3d(Nz, Ny, Nx, input_fftw, (fftwf_complex *)output_fftw,
+            FFTW_ESTIMATE);
+    mufft_assert(plan != NULL);
+    memcpy(input_fftw, input, Nx * rows * sizeof(float));
+
+    mufft_plan_3d *muplan = mufft_create_plan_3d_r2c(Nx, Ny, Nz, flags);
+    mufft_assert(muplan != NULL);
+
+    fftwf_execute(plan);
+    mufft_execute_plan_3d(muplan, output, input);
+
+    const float epsilon = 0.000001f * sqrtf(Nx * rows);
+    for (unsigned y = 0; y < rows; y++)
+    {
+        for (unsigned x = 0; x < fftN; x++)
+        {
+            float delta = cfloat_abs(cfloat_sub(output[y * Nx + x], output_fftw[y * fftN + x]));
+            mufft_assert(delta < epsilon);
+        }
+    }
+
     mufft_free(input);
     mufft_free(output);
-    mufft_free_plan_2d(muplan);
+    mufft_free_plan_3d(muplan);
     fftwf_free(input_fftw);
     fftwf_free(output_fftw);
     fftwf_destroy_plan(plan);
 }
 
-static void test_fft_1d(unsigned N, int direction, unsigned flags)
+static void test_fft_3d_c2r(unsigned Nx, unsigned Ny, unsigned Nz, unsigned flags)
 {
-    cfloat *input = mufft_alloc(N * sizeof(cfloat));
-    cfloat *output = mufft_alloc(N * sizeof(cfloat));
-    cfloat *input_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
-    cfloat *output_fftw = fftwf_malloc(N * sizeof(fftwf_complex));
+    unsigned fftN = Nx / 2 + 1;
+    unsigned rows = Ny * Nz;
+    cfloat *input = mufft_calloc(Nx * rows * sizeof(cfloat));
+    float *output = mufft_calloc(2 * Nx * rows * sizeof(float));
+    cfloat *input_fftw = fftwf_malloc(Nx * rows * sizeof(cfloat));
+    float *output_fftw = fftwf_malloc(2 * Nx * rows * sizeof(float));
 
     srand(0);
-    for (unsigned i = 0; i < N; i++)
+    for (unsigned y = 0; y < rows; y++)
     {
-        float real = (float)rand() / RAND_MAX - 0.5f;
-        float imag = (float)rand() / RAND_MAX - 0.5f;
-        input[i] = cfloat_create(real, imag);
+        for (unsigned x = 1; x < Nx / 2; x++)
+        {
+            float real = (float)rand() / RAND_MAX - 0.5f;
+            float imag = (float)rand() / RAND_MAX - 0.5f;
+            input[y * Nx + x] = cfloat_create(real, imag);
+        }
     }
 
-    fftwf_plan plan = fftwf_plan_dft_1d(N, (fftwf_complex *)input_fftw, (fftwf_complex *)output_fftw,
-                                        direction, FFTW_ESTIMATE);
+    // Columns 0 and Nx / 2 must be conjugate symmetric on their own, only use the self-conjugate samples.
+    for (unsigned z = 0; z < Nz; z += Nz / 2)
+    {
+        for (unsigned y = 0; y < Ny; y += Ny / 2)
+        {
+            input[(z * Ny + y) * Nx].real = (float)rand() / RAND_MAX - 0.5f;
+            input[(z * Ny + y) * Nx + Nx / 2].real = (float)rand() / RAND_MAX - 0.5f;
+        }
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_c2r_3d(Nz, Ny, Nx, (fftwf_complex *)input_fftw, output_fftw,
+                                            FFTW_ESTIMATE);
     mufft_assert(plan != NULL);
-    memcpy(input_fftw, input, N * sizeof(cfloat));
+    for (unsigned y = 0; y < rows; y++)
+    {
+        memcpy(input_fftw + fftN * y, input + Nx * y, fftN * sizeof(cfloat));
+    }
 
-    mufft_plan_1d *muplan = mufft_create_plan_1d_c2c(N, direction, flags);
+    mufft_plan_3d *muplan = mufft_create_plan_3d_c2r(Nx, Ny, Nz, flags);
     mufft_assert(muplan != NULL);
 
     fftwf_execute(plan);
-    mufft_execute_plan_1d(muplan, output, input);
+    mufft_execute_plan_3d(muplan, output, input);
 
-    const float epsilon = 0.000001f * sqrtf(N);
-    for (unsigned i = 0; i < N; i++)
+    const float epsilon = 0.000001f * sqrtf(Nx * rows);
+    for (unsigned i = 0; i < Nx * rows; i++)
     {
-        float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+        float delta = fabsf(output[i] - output_fftw[i]);
         mufft_assert(delta < epsilon);
     }
 
     mufft_free(input);
     mufft_free(output);
-    mufft_free_plan_1d(muplan);
+    mufft_free_plan_3d(muplan);
     fftwf_free(input_fftw);
     fftwf_free(output_fftw);
     fftwf_destroy_plan(plan);
@@ -242,6 +897,15 @@ static void test_fft_1d_c2r(unsigned N, unsigned flags)
         mufft_assert(delta < epsilon);
     }
 
+    // In place, which overwrites the input.
+    mufft_execute_plan_1d(muplan, input, input);
+
+    for (unsigned i = 0; i < N; i++)
+    {
+        float delta = fabsf(((const float*)input)[i] - output_fftw[i]);
+        mufft_assert(delta < epsilon);
+    }
+
     mufft_free(input);
     mufft_free(output);
     mufft_free_plan_1d(muplan);
@@ -284,6 +948,16 @@ static void test_fft_1d_r2c(unsigned N, unsigned flags)
         mufft_assert(delta < epsilon);
     }
 
+    // In place.
+    memcpy(output, input, N * sizeof(float));
+    mufft_execute_plan_1d(muplan, output, output);
+
+    for (unsigned i = 0; i < fftN; i++)
+    {
+        float delta = cfloat_abs(cfloat_sub(output[i], output_fftw[i]));
+        mufft_assert(delta < epsilon);
+    }
+
     mufft_execute_plan_1d(muplan_full, output, input);
 
     for (unsigned i = 0; i < fftN; i++)
@@ -372,6 +1046,452 @@ static void test_fft_1d_r2c_half(unsigned N, unsigned flags)
     fftwf_destroy_plan(plan);
 }
 
+// A normalized transform followed by an unnormalized one, or two orthonormal transforms, must give back the input.
+static void test_fft_1d_normalize(unsigned N, unsigned flags)
+{
+    cfloat *input = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output = mufft_alloc((N + 1) * sizeof(cfloat));
+    cfloat *result = mufft_alloc(N * sizeof(cfloat));
+
+    srand(0);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = cfloat_create(real, imag);
+    }
+
+    const float epsilon = 0.000001f * sqrtf(N);
+    static const unsigned forward_flags[] = { MUFFT_FLAG_NORMALIZE, 0, MUFFT_FLAG_NORMALIZE_ORTHO };
+    static const unsigned inverse_flags[] = { 0, MUFFT_FLAG_NORMALIZE, MUFFT_FLAG_NORMALIZE_ORTHO };
+    for (unsigned f = 0; f < ARRAY_SIZE(forward_flags); f++)
+    {
+        mufft_plan_1d *forward = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, flags | forward_flags[f]);
+        mufft_plan_1d *inverse = mufft_create_plan_1d_c2c(N, MUFFT_INVERSE, flags | inverse_flags[f]);
+        mufft_assert(forward != NULL && inverse != NULL);
+
+        mufft_execute_plan_1d(forward, output, input);
+        mufft_execute_plan_1d(inverse, result, output);
+        for (unsigned i = 0; i < N; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(result[i], input[i]));
+            mufft_assert(delta < epsilon);
+        }
+
+        mufft_free_plan_1d(forward);
+        mufft_free_plan_1d(inverse);
+
+        // Reinterpret the input as 2 * N real samples.
+        forward = mufft_create_plan_1d_r2c(2 * N, flags | forward_flags[f]);
+        inverse = mufft_create_plan_1d_c2r(2 * N, flags | inverse_flags[f]);
+        mufft_assert(forward != NULL && inverse != NULL);
+
+        mufft_execute_plan_1d(forward, output, input);
+        mufft_execute_plan_1d(inverse, result, output);
+        for (unsigned i = 0; i < N; i++)
+        {
+            float delta = cfloat_abs(cfloat_sub(result[i], input[i]));
+            mufft_assert(delta < epsilon);
+        }
+
+        mufft_free_plan_1d(forward);
+        mufft_free_plan_1d(inverse);
+    }
+
+    mufft_assert(mufft_create_plan_1d_c2c(N, MUFFT_FORWARD,
+                flags | MUFFT_FLAG_NORMALIZE | MUFFT_FLAG_NORMALIZE_ORTHO) == NULL);
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free(result);
+}
+
+// Plans from a cache must be handed out exclusively, and be reused once released.
+static void test_plan_cache(unsigned N, unsigned flags)
+{
+    cfloat *input = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output_cached = mufft_alloc(N * sizeof(cfloat));
+
+    srand(0);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = cfloat_create(real, imag);
+    }
+
+    mufft_plan_cache *cache = mufft_create_plan_cache();
+    mufft_assert(cache != NULL);
+
+    mufft_plan_1d *first = mufft_plan_cache_acquire_1d(cache, MUFFT_PLAN_TYPE_C2C, N, MUFFT_FORWARD, flags);
+    mufft_plan_1d *second = mufft_plan_cache_acquire_1d(cache, MUFFT_PLAN_TYPE_C2C, N, MUFFT_FORWARD, flags);
+    mufft_plan_1d *inverse = mufft_plan_cache_acquire_1d(cache, MUFFT_PLAN_TYPE_C2C, N, MUFFT_INVERSE, flags);
+    mufft_assert(first != NULL && second != NULL && inverse != NULL);
+    mufft_assert(first != second && first != inverse && second != inverse);
+
+    mufft_plan_cache_release_1d(cache, first);
+    mufft_assert(mufft_plan_cache_acquire_1d(cache, MUFFT_PLAN_TYPE_C2C, N, MUFFT_FORWARD, flags) == first);
+
+    mufft_plan_2d *plan_2d = mufft_plan_cache_acquire_2d(cache, MUFFT_PLAN_TYPE_R2C, 16, 8, 0, flags);
+    mufft_assert(plan_2d != NULL);
+    mufft_plan_cache_release_2d(cache, plan_2d);
+    mufft_assert(mufft_plan_cache_acquire_2d(cache, MUFFT_PLAN_TYPE_R2C, 16, 8, MUFFT_INVERSE, flags) == plan_2d);
+    mufft_plan_cache_release_2d(cache, plan_2d);
+
+    // Only up to MUFFT_PLAN_CACHE_MAX_IDLE released plans are kept, and handed out again most recently released first.
+    mufft_plan_1d *plans[MUFFT_PLAN_CACHE_MAX_IDLE + 2];
+    for (unsigned i = 0; i < ARRAY_SIZE(plans); i++)
+    {
+        plans[i] = mufft_plan_cache_acquire_1d(cache, MUFFT_PLAN_TYPE_C2C, N, MUFFT_FORWARD, flags);
+        mufft_assert(plans[i] != NULL);
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(plans); i++)
+    {
+        mufft_plan_cache_release_1d(cache, plans[i]);
+    }
+    for (unsigned i = 0; i < MUFFT_PLAN_CACHE_MAX_IDLE; i++)
+    {
+        mufft_assert(mufft_plan_cache_acquire_1d(cache, MUFFT_PLAN_TYPE_C2C, N, MUFFT_FORWARD, flags) ==
+                plans[MUFFT_PLAN_CACHE_MAX_IDLE - 1 - i]);
+    }
+    for (unsigned i = 0; i < MUFFT_PLAN_CACHE_MAX_IDLE; i++)
+    {
+        mufft_plan_cache_release_1d(cache, plans[i]);
+    }
+
+    // Cached plans are regular plans.
+    mufft_plan_1d *muplan = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, flags);
+    mufft_assert(muplan != NULL);
+    mufft_execute_plan_1d(muplan, output, input);
+    mufft_execute_plan_1d(first, output_cached, input);
+    mufft_assert(memcmp(output, output_cached, N * sizeof(cfloat)) == 0);
+
+    mufft_plan_cache_release_1d(cache, first);
+    mufft_plan_cache_release_1d(cache, second);
+    mufft_plan_cache_release_1d(cache, inverse);
+    mufft_free_plan_cache(cache);
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free(output_cached);
+    mufft_free_plan_1d(muplan);
+}
+
+struct counting_allocator
+{
+    unsigned allocations;
+    unsigned frees;
+};
+
+static void *counting_alloc(void *userdata, size_t size, size_t alignment)
+{
+    struct counting_allocator *counter = userdata;
+    unsigned char *ptr = malloc(size + alignment + sizeof(void*));
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+
+    uintptr_t addr = ((uintptr_t)ptr + sizeof(void*) + alignment) & ~(uintptr_t)(alignment - 1);
+    ((void**)addr)[-1] = ptr;
+    counter->allocations++;
+    return (void*)addr;
+}
+
+static void counting_free(void *userdata, void *ptr)
+{
+    struct counting_allocator *counter = userdata;
+    mufft_assert(ptr != NULL);
+    counter->frees++;
+    free(((void**)ptr)[-1]);
+}
+
+static void test_allocator(unsigned N, unsigned flags)
+{
+    struct counting_allocator counter = { 0, 0 };
+    const mufft_allocator allocator = { counting_alloc, counting_free, &counter };
+
+    cfloat *input = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output = mufft_alloc(N * sizeof(cfloat));
+    cfloat *output_allocator = mufft_alloc(N * sizeof(cfloat));
+
+    srand(0);
+    for (unsigned i = 0; i < N; i++)
+    {
+        float real = (float)rand() / RAND_MAX - 0.5f;
+        float imag = (float)rand() / RAND_MAX - 0.5f;
+        input[i] = cfloat_create(real, imag);
+    }
+
+    // Plans from a custom allocator are regular plans.
+    mufft_plan_1d *muplan = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, flags);
+    mufft_plan_1d *plan = mufft_create_plan_1d_c2c_with_allocator(N, MUFFT_FORWARD, flags, &allocator);
+    mufft_assert(muplan != NULL && plan != NULL);
+    mufft_assert(counter.allocations == 1);
+    mufft_execute_plan_1d(muplan, output, input);
+    mufft_execute_plan_1d(plan, output_allocator, input);
+    mufft_assert(memcmp(output, output_allocator, N * sizeof(cfloat)) == 0);
+    mufft_free_plan_1d(plan);
+    mufft_free_plan_1d(muplan);
+
+    mufft_plan_1d *r2c = mufft_create_plan_1d_r2c_with_allocator(2 * N, flags, &allocator);
+    mufft_plan_1d *c2r = mufft_create_plan_1d_c2r_with_allocator(2 * N, flags, &allocator);
+    mufft_plan_conv *conv = mufft_create_plan_conv_with_allocator(2 * N, flags, MUFFT_CONV_METHOD_FLAG_MONO_MONO, &allocator);
+    mufft_plan_2d *plan_2d = mufft_create_plan_2d_c2c_with_allocator(N, 4, MUFFT_INVERSE, flags, &allocator);
+    mufft_plan_2d *r2c_2d = mufft_create_plan_2d_r2c_with_allocator(2 * N, 4, flags, &allocator);
+    mufft_plan_2d *c2r_2d = mufft_create_plan_2d_c2r_with_allocator(2 * N, 4, flags, &allocator);
+    const unsigned dims[3] = { 2 * N, 4, 2 };
+    mufft_plan_nd *plan_nd = mufft_create_plan_nd_c2c_with_allocator(3, dims, MUFFT_FORWARD, flags, &allocator);
+    mufft_plan_nd *r2c_nd = mufft_create_plan_nd_r2c_with_allocator(3, dims, flags, &allocator);
+    mufft_plan_nd *c2r_nd = mufft_create_plan_nd_c2r_with_allocator(3, dims, flags, &allocator);
+    mufft_assert(r2c != NULL && c2r != NULL && conv != NULL);
+    mufft_assert(plan_2d != NULL && r2c_2d != NULL && c2r_2d != NULL);
+    mufft_assert(plan_nd != NULL && r2c_nd != NULL && c2r_nd != NULL);
+    mufft_free_plan_1d(r2c);
+    mufft_free_plan_1d(c2r);
+    mufft_free_plan_conv(conv);
+    mufft_free_plan_2d(plan_2d);
+    mufft_free_plan_2d(r2c_2d);
+    mufft_free_plan_2d(c2r_2d);
+    mufft_free_plan_nd(plan_nd);
+    mufft_free_plan_nd(r2c_nd);
+    mufft_free_plan_nd(c2r_nd);
+    mufft_assert(counter.allocations > 1 && counter.allocations == counter.frees);
+
+    // Plan variants which grow their scratch after planning grow it with the same allocator.
+    counter.allocations = counter.frees = 0;
+    mufft_plan_1d *zero_pad = mufft_create_plan_1d_c2c_zero_pad_with_allocator(N, MUFFT_FORWARD, flags, 1, &allocator);
+    mufft_plan_1d *r2c_zero_pad = mufft_create_plan_1d_r2c_zero_pad_with_allocator(2 * N, flags, 3, &allocator);
+    mufft_plan_1d *pruned = mufft_create_plan_1d_c2c_pruned_with_allocator(N, MUFFT_FORWARD, flags, 1, N - 1, &allocator);
+    mufft_plan_2d *pitched = mufft_create_plan_2d_c2c_pitched_with_allocator(N, 4, MUFFT_FORWARD, flags,
+            N + 4, N + 8, &allocator);
+    mufft_plan_2d *r2c_pitched = mufft_create_plan_2d_r2c_pitched_with_allocator(2 * N, 4,
+            flags | MUFFT_FLAG_COMPACT_R2C, 2 * N, N + 1, &allocator);
+    mufft_plan_2d *c2r_pitched = mufft_create_plan_2d_c2r_pitched_with_allocator(2 * N, 4, flags, 2 * N, 2 * N, &allocator);
+    mufft_assert(zero_pad != NULL && r2c_zero_pad != NULL && pruned != NULL);
+    mufft_assert(pitched != NULL && r2c_pitched != NULL && c2r_pitched != NULL);
+    mufft_assert(counter.allocations - counter.frees == 6);
+    mufft_free_plan_1d(zero_pad);
+    mufft_free_plan_1d(r2c_zero_pad);
+    mufft_free_plan_1d(pruned);
+    mufft_free_plan_2d(pitched);
+    mufft_free_plan_2d(r2c_pitched);
+    mufft_free_plan_2d(c2r_pitched);
+    mufft_assert(counter.allocations == counter.frees);
+
+    mufft_free(input);
+    mufft_free(output);
+    mufft_free(output_allocator);
+
+    // Plans, their twiddle factors and plan caches remember their allocator across changes of the global allocator.
+    counter.allocations = counter.frees = 0;
+    muplan = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, flags);
+    mufft_plan_cache *cache = mufft_create_plan_cache();
+    mufft_assert(muplan != NULL && cache != NULL);
+    mufft_set_allocator(&allocator);
+    void *ptr = mufft_alloc(N);
+    mufft_assert(ptr != NULL && ((uintptr_t)ptr & (MUFFT_ALIGNMENT - 1)) == 0);
+    mufft_free(ptr);
+    mufft_plan_1d *cached = mufft_plan_cache_acquire_1d(cache, MUFFT_PLAN_TYPE_C2C, N, MUFFT_FORWARD, flags);
+    mufft_assert(cached != NULL);
+    mufft_plan_cache_release_1d(cache, cached);
+    mufft_free_plan_1d(muplan);
+    mufft_free_plan_cache(cache);
+    mufft_assert(counter.allocations == counter.frees);
+    unsigned custom_allocations = counter.allocations;
+
+    // The other way around, plans created with the custom global allocator are freed with it after it is replaced.
+    muplan = mufft_create_plan_1d_c2c(2 * N, MUFFT_INVERSE, flags);
+    mufft_assert(muplan != NULL && counter.allocations > custom_allocations);
+    mufft_set_allocator(NULL);
+    mufft_free_plan_1d(muplan);
+    mufft_assert(counter.allocations == counter.frees);
+}
+
+// Gets the NUMA node the calling thread runs on, and the node a page of its own ended up on.
+// Both are -1 if they cannot be queried.
+static void get_numa_nodes(int *cpu_node, int *page_node)
+{
+    *cpu_node = -1;
+    *page_node = -1;
+#if defined(__linux__) && defined(SYS_getcpu) && defined(SYS_get_mempolicy) && defined(MPOL_F_NODE)
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    {
+        *cpu_node = (int)node;
+    }
+
+    void *page = mufft_alloc(4096);
+    mufft_assert(page != NULL);
+    memset(page, 0, 4096);
+    int page_node_;
+    if (syscall(SYS_get_mempolicy, &page_node_, NULL, 0, page, MPOL_F_NODE | MPOL_F_ADDR) == 0)
+    {
+        *page_node = page_node_;
+    }
+    mufft_free(page);
+#endif
+}
+
+// NUMA local plans must report the node of the thread which created them.
+static void test_numa_node(unsigned N)
+{
+    int before, after, page_node;
+    get_numa_nodes(&before, &page_node);
+    mufft_plan_1d *plan_1d = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, MUFFT_FLAG_NUMA_LOCAL);
+    mufft_plan_2d *plan_2d = mufft_create_plan_2d_r2c(N, 16, MUFFT_FLAG_NUMA_LOCAL | MUFFT_FLAG_HUGE_PAGES);
+    mufft_plan_3d *plan_3d = mufft_create_plan_3d_c2c(16, N, 4, MUFFT_INVERSE, MUFFT_FLAG_NUMA_LOCAL);
+    mufft_plan_conv *conv = mufft_create_plan_conv(N, MUFFT_FLAG_NUMA_LOCAL, MUFFT_CONV_METHOD_FLAG_MONO_MONO);
+    mufft_plan_1d *plain = mufft_create_plan_1d_c2c(N, MUFFT_FORWARD, 0);
+    get_numa_nodes(&after, &page_node);
+    mufft_assert(plan_1d != NULL && plan_2d != NULL && plan_3d != NULL && conv != NULL && plain != NULL);
+
+    // Without placement queries, or if the thread moved while planning, only the plain plan can be checked.
+    if (page_node >= 0 && before >= 0 && before == after)
+    {
+        mufft_assert(mufft_get_numa_node_plan_1d(plan_1d) == before);
+        mufft_assert(mufft_get_numa_node_plan_2d(plan_2d) == before);
+        mufft_assert(mufft_get_numa_node_plan_3d(plan_3d) == before);
+        mufft_assert(mufft_get_numa_node_plan_conv(conv) == before);
+    }
+    mufft_assert(mufft_get_numa_node_plan_1d(plain) == -1);
+
+    mufft_free_plan_1d(plan_1d);
+    mufft_free_plan_2d(plan_2d);
+    mufft_free_plan_3d(plan_3d);
+    mufft_free_plan_conv(conv);
+    mufft_free_plan_1d(plain);
+}
+
+// Gets the number of mappings of the process, or 0 if it cannot be queried.
+static unsigned count_mappings(void)
+{
+    unsigned count = 0;
+#if defined(__linux__)
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (maps == NULL)
+    {
+        return 0;
+    }
+
+    int c;
+    while ((c = fgetc(maps)) != EOF)
+    {
+        if (c == '\n')
+        {
+            count++;
+        }
+    }
+    fclose(maps);
+#endif
+    return count;
+}
+
+// Freeing NUMA local plans must hand their memory back without a policy of its own,
+// or every plan would leave split mappings behind in the heap until mmap() starts failing.
+static void test_numa_mappings(void)
+{
+    void *unrelated[4096];
+    unsigned before = count_mappings();
+    for (unsigned i = 0; i < ARRAY_SIZE(unrelated); i++)
+    {
+        mufft_plan_1d *plan = mufft_create_plan_1d_c2c(64 << (i & 7), MUFFT_FORWARD, MUFFT_FLAG_NUMA_LOCAL);
+        mufft_assert(plan != NULL);
+        // Unrelated allocations live on in the heap the plans came from.
+        unrelated[i] = malloc(64 + (i & 255) * 16);
+        mufft_assert(unrelated[i] != NULL);
+        mufft_free_plan_1d(plan);
+    }
+    unsigned after = count_mappings();
+    for (unsigned i = 0; i < ARRAY_SIZE(unrelated); i++)
+    {
+        free(unrelated[i]);
+    }
+    mufft_assert(after <= before + 16);
+}
+
+static void test_alloc_huge(void)
+{
+    const size_t huge_page_size = 2 * 1024 * 1024;
+
+    // Small allocations are not padded out to a huge page.
+    float *small = mufft_alloc_huge(1024);
+    mufft_assert(small != NULL && ((uintptr_t)small & (MUFFT_ALIGNMENT - 1)) == 0);
+    small[255] = 1.0f;
+    mufft_free(small);
+
+    float *large = mufft_alloc_huge(huge_page_size + 1);
+    mufft_assert(large != NULL && ((uintptr_t)large & (MUFFT_ALIGNMENT - 1)) == 0);
+    large[huge_page_size / sizeof(float)] = 1.0f;
+    mufft_free(large);
+}
+
+// Gets a column height at which the two tiles of the narrowest vertical pass no longer fit in the L2 cache,
+// which is when the planner transposes columns into rows instead.
+static unsigned test_tall_ny(void)
+{
+    mufft_cpu_info info;
+    mufft_get_cpu_info(&info);
+    size_t cache_size = info.l2_cache_size != 0 ? info.l2_cache_size : 256 * 1024;
+
+    unsigned Ny = 2;
+    while (2 * 8 * (size_t)Ny * sizeof(cfloat) <= cache_size)
+    {
+        Ny <<= 1;
+    }
+    return Ny;
+}
+
+// Tall transforms transpose, short ones keep the vertical pass.
+static void test_transpose_heuristic(unsigned Nx, unsigned tall_ny, unsigned flags)
+{
+    mufft_plan_2d *tall = mufft_create_plan_2d_c2c(Nx, tall_ny, MUFFT_FORWARD, flags);
+    mufft_plan_2d *short_plan = mufft_create_plan_2d_c2c(Nx, tall_ny / 2, MUFFT_FORWARD, flags);
+    mufft_assert(tall != NULL && short_plan != NULL);
+    mufft_assert(mufft_plan_2d_uses_transpose(tall));
+    mufft_assert(!mufft_plan_2d_uses_transpose(short_plan));
+    mufft_free_plan_2d(tall);
+    mufft_free_plan_2d(short_plan);
+}
+
+static void test_cpu_info(void)
+{
+    mufft_cpu_info info;
+    mufft_get_cpu_info(&info);
+    printf("    L1 %zu, L2 %zu, L3 %zu bytes, %u byte lines, %u logical / %u physical cores.\n",
+            info.l1_cache_size, info.l2_cache_size, info.l3_cache_size,
+            info.cache_line_size, info.logical_cores, info.physical_cores);
+
+    mufft_assert((info.flags & ~(MUFFT_CPU_HAS_AVX | MUFFT_CPU_HAS_SSE3 | MUFFT_CPU_HAS_SSE)) == 0);
+    mufft_assert((info.cache_line_size & (info.cache_line_size - 1)) == 0);
+    mufft_assert(info.physical_cores <= info.logical_cores);
+    mufft_assert(info.l2_cache_size == 0 || info.l1_cache_size <= info.l2_cache_size);
+
+    // Detection only runs once, so every call agrees.
+    mufft_cpu_info again;
+    mufft_get_cpu_info(&again);
+    mufft_assert(info.flags == again.flags && info.l1_cache_size == again.l1_cache_size &&
+            info.l2_cache_size == again.l2_cache_size && info.l3_cache_size == again.l3_cache_size &&
+            info.cache_line_size == again.cache_line_size && info.logical_cores == again.logical_cores &&
+            info.physical_cores == again.physical_cores);
+
+    // MUFFT_CPU can only take instruction sets away.
+    const char *tier = getenv("MUFFT_CPU");
+    if (tier != NULL && strcmp(tier, "c") == 0)
+    {
+        mufft_assert(info.flags == 0);
+    }
+    else if (tier != NULL && strcmp(tier, "sse") == 0)
+    {
+        mufft_assert((info.flags & (MUFFT_CPU_HAS_AVX | MUFFT_CPU_HAS_SSE3)) == 0);
+    }
+    else if (tier != NULL && strcmp(tier, "sse3") == 0)
+    {
+        mufft_assert((info.flags & MUFFT_CPU_HAS_AVX) == 0);
+    }
+}
+
 static void convolve_float(float *output, const float *a, const float *b, unsigned N)
 {
     for (unsigned i = 0; i < 2 * N; i++)
@@ -500,6 +1620,34 @@ int main(void)
             printf("Testing 1D inverse transform size %u, flags = %u.\n", N, flags);
             test_fft_1d(N, +1, flags);
             printf("    ... Passed\n");
+
+            printf("Testing 1D output pruned transform size %u, flags = %u.\n", N, flags);
+            test_fft_1d_pruned(N, -1, flags);
+            test_fft_1d_pruned(N, +1, flags);
+            printf("    ... Passed\n");
+
+            printf("Testing 1D input pruned transform size %u, flags = %u.\n", N, flags);
+            test_fft_1d_zero_pad(N, -1, flags);
+            test_fft_1d_zero_pad(N, +1, flags);
+            printf("    ... Passed\n");
+
+            printf("Testing 1D transform with compact twiddle factors size %u, flags = %u.\n", N, flags);
+            test_fft_1d(N, -1, flags | MUFFT_FLAG_COMPACT_TWIDDLES);
+            test_fft_1d(N, +1, flags | MUFFT_FLAG_COMPACT_TWIDDLES);
+            test_fft_1d_zero_pad(N, -1, flags | MUFFT_FLAG_COMPACT_TWIDDLES);
+            printf("    ... Passed\n");
+
+            printf("Testing 1D normalized transform size %u, flags = %u.\n", N, flags);
+            test_fft_1d_normalize(N, flags);
+            printf("    ... Passed\n");
+
+            printf("Testing plan cache size %u, flags = %u.\n", N, flags);
+            test_plan_cache(N, flags);
+            printf("    ... Passed\n");
+
+            printf("Testing custom allocator size %u, flags = %u.\n", N, flags);
+            test_allocator(N, flags);
+            printf("    ... Passed\n");
             fflush(stdout);
         }
     }
@@ -516,13 +1664,82 @@ int main(void)
             test_fft_1d_r2c_half(N, flags);
             printf("    ... Passed\n");
 
+            printf("Testing 1D input pruned real-to-complex transform size %u, flags = %u.\n", N, flags);
+            test_fft_1d_r2c_zero_pad(N, flags);
+            printf("    ... Passed\n");
+
             printf("Testing 1D complex-to-real transform size %u, flags = %u.\n", N, flags);
             test_fft_1d_c2r(N, flags);
             printf("    ... Passed\n");
+
+            printf("Testing 1D real transforms with compact twiddle factors size %u, flags = %u.\n", N, flags);
+            test_fft_1d_r2c(N, flags | MUFFT_FLAG_COMPACT_TWIDDLES);
+            test_fft_1d_c2r(N, flags | MUFFT_FLAG_COMPACT_TWIDDLES);
+            printf("    ... Passed\n");
             fflush(stdout);
         }
     }
 
+    printf("Testing CPU information.\n");
+    test_cpu_info();
+    printf("    ... Passed\n");
+
+    printf("Testing huge page allocation.\n");
+    test_alloc_huge();
+    printf("    ... Passed\n");
+
+    // Large enough for the plans, scratch buffers and twiddle factors to be backed by huge pages.
+    printf("Testing huge page backed transforms.\n");
+    test_fft_1d(256 * 1024, -1, MUFFT_FLAG_HUGE_PAGES);
+    test_fft_1d_r2c(512 * 1024, MUFFT_FLAG_HUGE_PAGES);
+    test_fft_1d_c2r(512 * 1024, MUFFT_FLAG_HUGE_PAGES);
+    test_fft_2d(512, 512, +1, MUFFT_FLAG_HUGE_PAGES);
+    printf("    ... Passed\n");
+    fflush(stdout);
+
+    // Every thread is on node 0 on single node machines, but the replicated twiddle factors are still exercised.
+    printf("Testing NUMA local transforms.\n");
+    for (unsigned N = 4; N <= 4096; N <<= 2)
+    {
+        test_fft_1d(N, -1, MUFFT_FLAG_NUMA_LOCAL);
+        test_fft_1d(N, +1, MUFFT_FLAG_NUMA_LOCAL | MUFFT_FLAG_COMPACT_TWIDDLES);
+        test_fft_1d_r2c(N, MUFFT_FLAG_NUMA_LOCAL);
+        test_fft_1d_c2r(N, MUFFT_FLAG_NUMA_LOCAL | MUFFT_FLAG_HUGE_PAGES);
+        test_fft_2d(N, 16, -1, MUFFT_FLAG_NUMA_LOCAL);
+        test_fft_3d(16, N, 4, +1, MUFFT_FLAG_NUMA_LOCAL);
+        test_numa_node(N);
+    }
+    test_numa_mappings();
+    printf("    ... Passed\n");
+    fflush(stdout);
+
+    // The last step writes its output with non-temporal stores once it is larger than the L3 cache of the host,
+    // so lower the threshold to cover them on any host.
+    printf("Testing 1D transforms with streaming stores.\n");
+#if defined(__linux__)
+    setenv("MUFFT_STREAM_BYTES", "1048576", 1);
+#endif
+    test_fft_1d(8 * 1024 * 1024, -1, 0);
+    test_fft_1d(8 * 1024 * 1024, +1, MUFFT_FLAG_CPU_NO_AVX);
+    test_fft_1d_normalize(8 * 1024 * 1024, 0);
+    test_fft_1d(256 * 1024, -1, 0);
+    // Pruned plans go back to regular stores, the partial DFT reads the output of the last step right away.
+    test_fft_1d_pruned(256 * 1024, -1, 0);
+#if defined(__linux__)
+    unsetenv("MUFFT_STREAM_BYTES");
+#endif
+    printf("    ... Passed\n");
+    fflush(stdout);
+
+    // Large enough for the generic vertical steps to prefetch their input.
+    printf("Testing 2D and 3D transforms with software prefetching.\n");
+    test_fft_2d(2048, 2048, -1, 0);
+    test_fft_2d(2048, 2048, +1, MUFFT_FLAG_CPU_NO_AVX);
+    test_fft_2d_r2c(4096, 2048, 0);
+    test_fft_3d(64, 64, 2048, -1, 0);
+    printf("    ... Passed\n");
+    fflush(stdout);
+
     for (unsigned N = 4; N < 32 * 1024; N <<= 1)
     {
         for (unsigned flags = 0; flags < 8; flags++)
@@ -551,6 +1768,22 @@ int main(void)
                 printf("Testing 2D inverse transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
                 test_fft_2d(Nx, Ny, +1, flags);
                 printf("    ... Passed\n");
+
+                printf("Testing 2D zero-padded transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
+                test_fft_2d(Nx, Ny, -1, flags | MUFFT_FLAG_ZERO_PAD_UPPER_HALF | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+                test_fft_2d(Nx, Ny, -1, flags | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+                test_fft_2d(Nx, Ny, +1, flags | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+                printf("    ... Passed\n");
+
+                printf("Testing 2D transpose-based transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
+                test_fft_2d(Nx, Ny, -1, flags | MUFFT_FLAG_2D_TRANSPOSE);
+                test_fft_2d(Nx, Ny, +1, flags | MUFFT_FLAG_2D_TRANSPOSED_OUTPUT);
+                test_fft_2d(Nx, Ny, -1, flags | MUFFT_FLAG_2D_TRANSPOSE | MUFFT_FLAG_ZERO_PAD_UPPER_HALF | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+                printf("    ... Passed\n");
+
+                printf("Testing 2D normalized transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
+                test_fft_2d_normalize(Nx, Ny, flags);
+                printf("    ... Passed\n");
                 fflush(stdout);
             }
         }
@@ -566,6 +1799,10 @@ int main(void)
                 test_fft_2d_r2c(Nx, Ny, flags);
                 printf("    ... Passed\n");
 
+                printf("Testing 2D zero-padded real-to-complex transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
+                test_fft_2d_r2c(Nx, Ny, flags | MUFFT_FLAG_ZERO_PAD_UPPER_HALF | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+                printf("    ... Passed\n");
+
                 printf("Testing 2D complex-to-real transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
                 test_fft_2d_c2r(Nx, Ny, flags);
                 printf("    ... Passed\n");
@@ -574,6 +1811,94 @@ int main(void)
         }
     }
 
+    // Tall enough for the planner to pick the transpose-based engine on this host.
+    unsigned tall_ny = test_tall_ny();
+    for (unsigned flags = 0; flags < 8; flags++)
+    {
+        printf("Testing 2D tall transform size 16-by-%u, flags = %u.\n", tall_ny, flags);
+        test_transpose_heuristic(16, tall_ny, flags);
+        test_fft_2d(16, tall_ny, -1, flags);
+        test_fft_2d(16, tall_ny, +1, flags | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+        printf("    ... Passed\n");
+        fflush(stdout);
+    }
+
+    for (unsigned Ny = 2; Ny <= 256; Ny <<= 1)
+    {
+        for (unsigned Nx = 2; Nx <= 256; Nx <<= 1)
+        {
+            for (unsigned flags = 0; flags < 8; flags++)
+            {
+                printf("Testing 2D pitched transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
+                test_fft_2d_pitched(Nx, Ny, -1, flags);
+                test_fft_2d_pitched(Nx, Ny, +1, flags);
+                test_fft_2d_pitched(Nx, Ny, -1, flags | MUFFT_FLAG_ZERO_PAD_UPPER_HALF | MUFFT_FLAG_ZERO_PAD_UPPER_HALF_Y);
+                if (Nx >= 4)
+                {
+                    test_fft_2d_r2c_pitched(Nx, Ny, flags, 1);
+                    test_fft_2d_c2r_pitched(Nx, Ny, flags, 1);
+                }
+                printf("    ... Passed\n");
+
+                if (Nx >= 4)
+                {
+                    printf("Testing 2D compact real-to-complex and complex-to-real transform size %u-by-%u, flags = %u.\n", Nx, Ny, flags);
+                    test_fft_2d_r2c_pitched(Nx, Ny, flags | MUFFT_FLAG_COMPACT_R2C, 0);
+                    test_fft_2d_c2r_pitched(Nx, Ny, flags | MUFFT_FLAG_COMPACT_R2C, 0);
+                    test_fft_2d_r2c_pitched(Nx, Ny, flags | MUFFT_FLAG_COMPACT_R2C, 1);
+                    test_fft_2d_c2r_pitched(Nx, Ny, flags | MUFFT_FLAG_COMPACT_R2C, 1);
+                    printf("    ... Passed\n");
+                }
+                fflush(stdout);
+            }
+        }
+    }
+
+    for (unsigned Nz = 2; Nz <= 32; Nz <<= 1)
+    {
+        for (unsigned Ny = 2; Ny <= 32; Ny <<= 1)
+        {
+            for (unsigned Nx = 2; Nx <= 32; Nx <<= 1)
+            {
+                for (unsigned flags = 0; flags < 8; flags++)
+                {
+                    printf("Testing 3D forward transform size %u-by-%u-by-%u, flags = %u.\n", Nx, Ny, Nz, flags);
+                    test_fft_3d(Nx, Ny, Nz, -1, flags);
+                    printf("    ... Passed\n");
+
+                    printf("Testing 3D inverse transform size %u-by-%u-by-%u, flags = %u.\n", Nx, Ny, Nz, flags);
+                    test_fft_3d(Nx, Ny, Nz, +1, flags);
+                    printf("    ... Passed\n");
+
+                    if (Nx >= 4)
+                    {
+                        printf("Testing 3D real-to-complex transform size %u-by-%u-by-%u, flags = %u.\n", Nx, Ny, Nz, flags);
+                        test_fft_3d_r2c(Nx, Ny, Nz, flags);
+                        printf("    ... Passed\n");
+
+                        printf("Testing 3D complex-to-real transform size %u-by-%u-by-%u, flags = %u.\n", Nx, Ny, Nz, flags);
+                        test_fft_3d_c2r(Nx, Ny, Nz, flags);
+                        printf("    ... Passed\n");
+                    }
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+
+    // Large enough that the slowest axis is transformed in several column blocks.
+    for (unsigned flags = 0; flags < 8; flags++)
+    {
+        printf("Testing blocked 3D transforms size 128-by-64-by-64, flags = %u.\n", flags);
+        test_fft_3d(128, 64, 64, -1, flags);
+        test_fft_3d_r2c(128, 64, 64, flags);
+        test_fft_3d_c2r(128, 64, 64, flags);
+        test_fft_3d_r2c(256, 2, 256, flags);
+        test_fft_3d_c2r(256, 2, 256, flags);
+        printf("    ... Passed\n");
+        fflush(stdout);
+    }
+
     fftwf_cleanup();
     printf("All tests passed!\n");
 }
@@ -0,0 +1,126 @@
+/* Copyright (C) 2015 Hans-Kristian Arntzen <maister@archlinux.us>
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Build time generator for the static twiddle factor tables used with MUFFT_STATIC_TWIDDLES.
+// The tables are filled in with the same routines fft.c uses at runtime, so plans behave identically either way.
+
+#include "fft_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int is_power_of_two(unsigned N)
+{
+    return N != 0 && (N & (N - 1)) == 0;
+}
+
+static const char *direction_name(int direction)
+{
+    return direction == MUFFT_FORWARD ? "forward" : "inverse";
+}
+
+static void emit_table(FILE *file, const char *kind, int direction, unsigned N, const cfloat *twiddles)
+{
+    fprintf(file, "static MUFFT_STATIC_ALIGN const cfloat static_twiddles_%s_%s_%u[%u] = {\n",
+            kind, direction_name(direction), N, N);
+    for (unsigned i = 0; i < N; i++)
+    {
+        fprintf(file, "    { %.8ef, %.8ef },\n", twiddles[i].real, twiddles[i].imag);
+    }
+    fprintf(file, "};\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "Usage: %s <output> <min size> <max size>\n", argv[0]);
+        return 1;
+    }
+
+    unsigned min_size = strtoul(argv[2], NULL, 0);
+    unsigned max_size = strtoul(argv[3], NULL, 0);
+    if (!is_power_of_two(min_size) || !is_power_of_two(max_size) || min_size < 4 || min_size > max_size)
+    {
+        fprintf(stderr, "Sizes must be powers of two, with 4 <= min size <= max size.\n");
+        return 1;
+    }
+
+    cfloat *twiddles = malloc(max_size * sizeof(cfloat));
+    if (twiddles == NULL)
+    {
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Failed to open %s for writing.\n", argv[1]);
+        free(twiddles);
+        return 1;
+    }
+
+    static const int directions[] = { MUFFT_FORWARD, MUFFT_INVERSE };
+
+    fprintf(file, "// Generated by twiddle_gen.c, do not edit.\n\n");
+
+    // A table for the largest size serves every smaller transform, see acquire_twiddles().
+    for (unsigned d = 0; d < ARRAY_SIZE(directions); d++)
+    {
+        // The padding entry for p == 2 is never read, but keep it deterministic.
+        for (unsigned i = 0; i < max_size; i++)
+        {
+            twiddles[i] = cfloat_create(0.0f, 0.0f);
+        }
+        fill_twiddles(twiddles, max_size, directions[d]);
+        emit_table(file, "fft", directions[d], max_size, twiddles);
+    }
+
+    // R2C twiddle factors are specific to the transform size, which is twice the size of the complex transform.
+    for (unsigned d = 0; d < ARRAY_SIZE(directions); d++)
+    {
+        for (unsigned N = min_size / 2; N <= max_size / 2; N <<= 1)
+        {
+            fill_r2c_twiddles(twiddles, directions[d], N);
+            emit_table(file, "r2c", directions[d], N, twiddles);
+        }
+    }
+
+    fprintf(file, "static const struct mufft_static_twiddle_table static_twiddle_tables[] = {\n");
+    for (unsigned d = 0; d < ARRAY_SIZE(directions); d++)
+    {
+        fprintf(file, "    { static_twiddles_fft_%s_%u, %u, %d, false },\n",
+                direction_name(directions[d]), max_size, max_size, directions[d]);
+    }
+    for (unsigned d = 0; d < ARRAY_SIZE(directions); d++)
+    {
+        for (unsigned N = min_size / 2; N <= max_size / 2; N <<= 1)
+        {
+            fprintf(file, "    { static_twiddles_r2c_%s_%u, %u, %d, true },\n",
+                    direction_name(directions[d]), N, N, directions[d]);
+        }
+    }
+    fprintf(file, "};\n");
+
+    int ret = ferror(file) ? 1 : 0;
+    if (fclose(file) != 0)
+    {
+        ret = 1;
+    }
+    free(twiddles);
+    return ret;
+}
@@ -49,6 +49,7 @@
 #define loadu_ps(addr) _mm256_loadu_ps((const float*)(addr))
 #define store_ps(addr, x) _mm256_store_ps((float*)(addr), x)
 #define storeu_ps(addr, x) _mm256_storeu_ps((float*)(addr), x)
+#define stream_ps(addr, x) _mm256_stream_ps((float*)(addr), x)
 #define splat_const_complex(real, imag) _mm256_set_ps(imag, real, imag, real, imag, real, imag, real)
 #define splat_const_dual_complex(a, b, real, imag) _mm256_set_ps(imag, real, b, a, imag, real, b, a)
 #define splat_complex(addr) (_mm256_castpd_ps(_mm256_broadcast_sd((const double*)(addr))))
@@ -66,6 +67,7 @@
 #define loadu_ps(addr) _mm_loadu_ps((const float*)(addr))
 #define store_ps(addr, x) _mm_store_ps((float*)(addr), x)
 #define storeu_ps(addr, x) _mm_storeu_ps((float*)(addr), x)
+#define stream_ps(addr, x) _mm_stream_ps((float*)(addr), x)
 #define splat_const_complex(real, imag) _mm_set_ps(imag, real, imag, real)
 #define splat_const_dual_complex(a, b, real, imag) _mm_set_ps(imag, real, b, a)
 
@@ -129,6 +131,39 @@ void MANGLE(mufft_convolve)(void *output, const void *input_a, const void *input
 	MANGLE(mufft_convolve_inner)(output, input_a, input_b, normalization, samples);
 }
 
+// Reverses the order of the complex samples in v and conjugates them.
+static inline MM MANGLE(conj_reverse)(MM v)
+{
+    const MM flip_signs = splat_const_complex(0.0f, -0.0f);
+    v = permute_ps(xor_ps(v, flip_signs), _MM_SHUFFLE(1, 0, 3, 2));
+#if VSIZE == 4
+    v = _mm256_permute2f128_ps(v, v, 1);
+#endif
+    return v;
+}
+
+// Returns complex samples [1, VSIZE] of the concatenation of a and b.
+static inline MM MANGLE(shift_in)(MM a, MM b)
+{
+#if VSIZE == 4
+    MM mid = _mm256_permute2f128_ps(a, b, (2 << 4) | (1 << 0));
+    return _mm256_castpd_ps(_mm256_shuffle_pd(_mm256_castps_pd(a), _mm256_castps_pd(mid), 5));
+#else
+    return _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 3, 2));
+#endif
+}
+
+// Loads input[i] as mufft_resolve_c2r would have written it, so that first pass kernels can skip the resolve pass.
+static inline MM MANGLE(resolve_c2r_load)(const cfloat * MUFFT_RESTRICT input, const cfloat * MUFFT_RESTRICT twiddles,
+        unsigned i, unsigned samples)
+{
+    MM a = load_ps(&input[i]);
+    MM b = MANGLE(conj_reverse)(loadu_ps(&input[samples - i - (VSIZE - 1)]));
+    MM even = add_ps(a, b);
+    MM odd = cmul_ps(sub_ps(a, b), load_ps(&twiddles[i]));
+    return add_ps(even, odd);
+}
+
 void MANGLE(mufft_resolve_c2r)(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned samples)
 {
@@ -213,68 +248,142 @@ void MANGLE(mufft_resolve_r2c)(cfloat * MUFFT_RESTRICT output, const cfloat * MU
     }
 }
 
-void MANGLE(mufft_radix2_p1)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+// Transposes VSIZE-by-VSIZE tiles of complex samples in registers.
+// rows and columns must be multiples of VSIZE.
+void MANGLE(mufft_transpose)(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        unsigned rows, unsigned columns, unsigned output_stride, unsigned input_stride)
 {
-    cfloat *output = output_;
-    const cfloat *input = input_;
-    (void)twiddles;
-    (void)p;
-
-    unsigned half_samples = samples >> 1;
-    for (unsigned i = 0; i < half_samples; i += VSIZE)
+    for (unsigned y = 0; y < rows; y += VSIZE)
     {
-        MM a = load_ps(&input[i]);
-        MM b = load_ps(&input[i + half_samples]);
+        for (unsigned x = 0; x < columns; x += VSIZE)
+        {
+            const cfloat *in = &input[y * input_stride + x];
+            cfloat *out = &output[x * output_stride + y];
 
-        MM r0 = add_ps(a, b);
-        MM r1 = sub_ps(a, b);
-        a = unpacklo_pd(r0, r1);
-        b = unpackhi_pd(r0, r1);
+            MM r0 = load_ps(&in[0 * input_stride]);
+            MM r1 = load_ps(&in[1 * input_stride]);
 #if VSIZE == 4
-        r0 = _mm256_permute2f128_ps(a, b, (2 << 4) | (0 << 0));
-        r1 = _mm256_permute2f128_ps(a, b, (3 << 4) | (1 << 0));
+            MM r2 = load_ps(&in[2 * input_stride]);
+            MM r3 = load_ps(&in[3 * input_stride]);
+
+            // Swap the off-diagonal 2x2 blocks, then transpose the 2x2 blocks within each lane.
+            MM t0 = _mm256_permute2f128_ps(r0, r2, 0x20);
+            MM t1 = _mm256_permute2f128_ps(r1, r3, 0x20);
+            MM t2 = _mm256_permute2f128_ps(r0, r2, 0x31);
+            MM t3 = _mm256_permute2f128_ps(r1, r3, 0x31);
+
+            store_ps(&out[0 * output_stride], unpacklo_pd(t0, t1));
+            store_ps(&out[1 * output_stride], unpackhi_pd(t0, t1));
+            store_ps(&out[2 * output_stride], unpacklo_pd(t2, t3));
+            store_ps(&out[3 * output_stride], unpackhi_pd(t2, t3));
 #else
-        r0 = a;
-        r1 = b;
+            store_ps(&out[0 * output_stride], unpacklo_pd(r0, r1));
+            store_ps(&out[1 * output_stride], unpackhi_pd(r0, r1));
 #endif
-
-        unsigned j = i << 1;
-        store_ps(&output[j + 0 * VSIZE], r0);
-        store_ps(&output[j + 1 * VSIZE], r1);
+        }
     }
 }
 
-void MANGLE(mufft_radix2_half_p1)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
+// Kernels which fold in the C2R resolve or a scale factor take it as an extra argument.
+#define RADIX_EXTRA_ARGS
+
+// Generic kernels read twiddle factors of a level of size P, and step to the next level, through these.
+// Kernels instantiated with RADIX_COMPACT set to 1 read the compact layout, see compact_twiddle().
+#define RADIX_COMPACT 0
+#define RADIX_TWIDDLE(level, P, k) \
+    (RADIX_COMPACT ? MANGLE(load_compact_twiddle)(level, P, k) : load_ps(&(level)[k]))
+#define RADIX_NEXT_LEVEL(level, P) \
+    ((level) + (RADIX_COMPACT ? compact_twiddle_level_size(P) : (P)))
+
+// Generic kernels write their output through RADIX_STORE.
+// Kernels instantiated with RADIX_STREAM set to 1 use non-temporal stores, which do not pull the output into cache.
+// Those stores are weakly ordered, so the kernel fences them before it returns.
+#define RADIX_STREAM 0
+#define RADIX_STORE(addr, x) \
+    do { if (RADIX_STREAM) stream_ps(addr, x); else store_ps(addr, x); } while (0)
+#define RADIX_STREAM_END \
+    do { if (RADIX_STREAM) _mm_sfence(); } while (0)
+
+// Generic vertical kernels read radix input streams which lie far apart in large transforms,
+// more than the hardware prefetchers keep track of at once.
+// Kernels instantiated with RADIX_PREFETCH set to 1 prefetch every stream explicitly, once per cache line.
+#define RADIX_PREFETCH 0
+#define RADIX_PREFETCH_LINE(addr, i) \
+    do { if (RADIX_PREFETCH && ((i) & 7) == 0) _mm_prefetch((const char*)(addr), _MM_HINT_T0); } while (0)
+
+// VSIZE divides MUFFT_COMPACT_TWIDDLE_FINE, so every lane shares the same coarse twiddle factor.
+static inline MM MANGLE(load_compact_twiddle)(const cfloat * MUFFT_RESTRICT level, unsigned P, unsigned k)
 {
-    cfloat *output = output_;
-    const cfloat *input = input_;
-    (void)twiddles;
-    (void)p;
-
-    unsigned half_samples = samples >> 1;
-    for (unsigned i = 0; i < half_samples; i += VSIZE)
+    if (P < MUFFT_COMPACT_TWIDDLE_MINIMUM_LEVEL)
     {
-        MM a = load_ps(&input[i]);
+        return load_ps(&level[k]);
+    }
+
+    MM fine = load_ps(&level[k & (MUFFT_COMPACT_TWIDDLE_FINE - 1)]);
+    MM coarse = splat_complex(&level[MUFFT_COMPACT_TWIDDLE_FINE + (k >> MUFFT_COMPACT_TWIDDLE_FINE_SHIFT)]);
+    return cmul_ps(coarse, fine);
+}
+
+#define RADIX2_P1(name) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
+        const cfloat * MUFFT_RESTRICT twiddles, RADIX_EXTRA_ARGS unsigned p, unsigned samples) \
+{ \
+    cfloat *output = output_; \
+    const cfloat *input = input_; \
+    (void)twiddles; \
+    (void)p; \
+ \
+    unsigned half_samples = samples >> 1; \
+    for (unsigned i = 0; i < half_samples; i += VSIZE) \
+    { \
+        RADIX2_LOAD_FIRST_BUTTERFLY; \
+ \
+        MM a = unpacklo_pd(r0, r1); \
+        MM b = unpackhi_pd(r0, r1); \
+        RADIX2_P1_END; \
+ \
+        unsigned j = i << 1; \
+        store_ps(&output[j + 0 * VSIZE], r0); \
+        store_ps(&output[j + 1 * VSIZE], r1); \
+    } \
+}
 
-        MM r0 = a;
-        MM r1 = a;
-        a = unpacklo_pd(r0, r1);
-        MM b = unpackhi_pd(r0, r1);
 #if VSIZE == 4
-        r0 = _mm256_permute2f128_ps(a, b, (2 << 4) | (0 << 0));
-        r1 = _mm256_permute2f128_ps(a, b, (3 << 4) | (1 << 0));
+#define RADIX2_P1_END \
+    r0 = _mm256_permute2f128_ps(a, b, (2 << 4) | (0 << 0)); \
+    r1 = _mm256_permute2f128_ps(a, b, (3 << 4) | (1 << 0))
 #else
-        r0 = a;
-        r1 = b;
+#define RADIX2_P1_END \
+    r0 = a; \
+    r1 = b
 #endif
 
-        unsigned j = i << 1;
-        store_ps(&output[j + 0 * VSIZE], r0);
-        store_ps(&output[j + 1 * VSIZE], r1);
-    }
-}
+#define RADIX2_LOAD_FIRST_BUTTERFLY \
+        MM x0 = load_ps(&input[i]); \
+        MM x1 = load_ps(&input[i + half_samples]); \
+ \
+        MM r0 = add_ps(x0, x1); \
+        MM r1 = sub_ps(x0, x1)
+RADIX2_P1(radix2_p1)
+#undef RADIX2_LOAD_FIRST_BUTTERFLY
+#define RADIX2_LOAD_FIRST_BUTTERFLY \
+        MM x0 = load_ps(&input[i]); \
+ \
+        MM r0 = x0; \
+        MM r1 = x0
+RADIX2_P1(radix2_half_p1)
+#undef RADIX2_LOAD_FIRST_BUTTERFLY
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS const cfloat * MUFFT_RESTRICT r2c_twiddles,
+#define RADIX2_LOAD_FIRST_BUTTERFLY \
+        MM x0 = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i, samples); \
+        MM x1 = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + half_samples, samples); \
+ \
+        MM r0 = add_ps(x0, x1); \
+        MM r1 = sub_ps(x0, x1)
+RADIX2_P1(c2r_radix2_p1)
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS
 
 #if VSIZE == 4
 #define RADIX2_P2_END \
@@ -316,32 +425,71 @@ void MANGLE(mufft_ ## direction ## _radix2_p2)(void * MUFFT_RESTRICT output_, co
 RADIX2_P2(forward, 0.0f, -0.0f)
 RADIX2_P2(inverse, -0.0f, 0.0f)
 
-void MANGLE(mufft_radix2_generic)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
-{
-    cfloat *output = output_;
-    const cfloat *input = input_;
-
-    unsigned half_samples = samples >> 1;
-
-    for (unsigned i = 0; i < half_samples; i += VSIZE)
-    {
-        unsigned k = i & (p - 1);
-
-        MM w = load_ps(&twiddles[k]);
-        MM a = load_ps(&input[i]);
-        MM b = load_ps(&input[i + half_samples]);
-        b = cmul_ps(b, w);
-
-        MM r0 = add_ps(a, b);
-        MM r1 = sub_ps(a, b);
-
-        unsigned j = (i << 1) - k;
-        store_ps(&output[j + 0], r0);
-        store_ps(&output[j + p], r1);
-    }
+#define RADIX2_GENERIC(name) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
+        const cfloat * MUFFT_RESTRICT twiddles, RADIX_EXTRA_ARGS unsigned p, unsigned samples) \
+{ \
+    cfloat *output = output_; \
+    const cfloat *input = input_; \
+ \
+    unsigned half_samples = samples >> 1; \
+ \
+    for (unsigned i = 0; i < half_samples; i += VSIZE) \
+    { \
+        unsigned k = i & (p - 1); \
+ \
+        MM w = RADIX_TWIDDLE(twiddles, p, k); \
+        RADIX2_LOAD_GENERIC; \
+        b = cmul_ps(b, w); \
+ \
+        MM r0 = add_ps(a, b); \
+        MM r1 = sub_ps(a, b); \
+ \
+        unsigned j = (i << 1) - k; \
+        RADIX_STORE(&output[j + 0], r0); \
+        RADIX_STORE(&output[j + p], r1); \
+    } \
+    RADIX_STREAM_END; \
 }
 
+#undef RADIX2_LOAD_GENERIC
+#define RADIX2_LOAD_GENERIC \
+        MM a = load_ps(&input[i]); \
+        MM b = load_ps(&input[i + half_samples])
+RADIX2_GENERIC(radix2_generic)
+#undef RADIX_STREAM
+#define RADIX_STREAM 1
+RADIX2_GENERIC(radix2_generic_stream)
+#undef RADIX_STREAM
+#define RADIX_STREAM 0
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 1
+RADIX2_GENERIC(radix2_compact)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 0
+#undef RADIX2_LOAD_GENERIC
+// The input is non-zero only for the first samples / p elements, so every butterfly reads a single broadcast value per leg.
+#define RADIX2_LOAD_GENERIC \
+        unsigned line = i / p; \
+        MM a = splat_complex(&input[line]); \
+        MM b = splat_complex(&input[line + half_samples / p])
+RADIX2_GENERIC(radix2_broadcast)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 1
+RADIX2_GENERIC(radix2_broadcast_compact)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 0
+#undef RADIX2_LOAD_GENERIC
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS float scale,
+#define RADIX2_LOAD_GENERIC \
+        const MM s = splat_const_complex(scale, scale); \
+        MM a = mul_ps(load_ps(&input[i]), s); \
+        MM b = mul_ps(load_ps(&input[i + half_samples]), s)
+RADIX2_GENERIC(radix2_generic_scale)
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS
+
 #if VSIZE == 4
 #define RADIX4_P1_END \
     o0 = _mm256_permute2f128_ps(o0o1_lo, o2o3_lo, (2 << 4) | (0 << 0)); \
@@ -358,7 +506,7 @@ void MANGLE(mufft_radix2_generic)(void * MUFFT_RESTRICT output_, const void * MU
 
 #define RADIX4_P1(direction, twiddle_r, twiddle_i) \
 void MANGLE(mufft_ ## direction ## _radix4_p1)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples) \
+        const cfloat * MUFFT_RESTRICT twiddles, RADIX_EXTRA_ARGS unsigned p, unsigned samples) \
 { \
     cfloat *output = output_; \
     const cfloat *input = input_; \
@@ -415,52 +563,112 @@ RADIX4_P1(inverse, -0.0f, 0.0f)
         MM r2 = b; \
         MM r3 = b
 RADIX4_P1(forward_half, 0.0f, -0.0f)
+#undef RADIX4_LOAD_FIRST_BUTTERFLY
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS const cfloat * MUFFT_RESTRICT r2c_twiddles,
+#define RADIX4_LOAD_FIRST_BUTTERFLY \
+        MM a = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i, samples); \
+        MM b = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + quarter_samples, samples); \
+        MM c = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 2 * quarter_samples, samples); \
+        MM d = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 3 * quarter_samples, samples); \
+ \
+        MM r0 = add_ps(a, c); \
+        MM r1 = sub_ps(a, c); \
+        MM r2 = add_ps(b, d); \
+        MM r3 = sub_ps(b, d)
+RADIX4_P1(c2r, -0.0f, 0.0f)
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS
 
-void MANGLE(mufft_radix4_generic)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
-{
-    cfloat *output = output_;
-    const cfloat *input = input_;
-
-    unsigned quarter_samples = samples >> 2;
-
-    for (unsigned i = 0; i < quarter_samples; i += VSIZE)
-    {
-        unsigned k = i & (p - 1);
-
-        MM w = load_ps(&twiddles[k]);
-        MM w0 = load_ps(&twiddles[p + k]);
-        MM w1 = load_ps(&twiddles[2 * p + k]);
-
-        MM a = load_ps(&input[i]);
-        MM b = load_ps(&input[i + quarter_samples]);
-        MM c = load_ps(&input[i + 2 * quarter_samples]);
-        MM d = load_ps(&input[i + 3 * quarter_samples]);
-
-        c = cmul_ps(c, w);
-        d = cmul_ps(d, w);
-
-        MM r0 = add_ps(a, c);
-        MM r1 = sub_ps(a, c);
-        MM r2 = add_ps(b, d);
-        MM r3 = sub_ps(b, d);
-
-        r2 = cmul_ps(r2, w0);
-        r3 = cmul_ps(r3, w1);
-
-        MM o0 = add_ps(r0, r2);
-        MM o1 = sub_ps(r0, r2);
-        MM o2 = add_ps(r1, r3);
-        MM o3 = sub_ps(r1, r3);
-
-        unsigned j = ((i - k) << 2) + k;
-        store_ps(&output[j + 0], o0);
-        store_ps(&output[j + 1 * p], o2);
-        store_ps(&output[j + 2 * p], o1);
-        store_ps(&output[j + 3 * p], o3);
-    }
+#define RADIX4_GENERIC(name) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
+        const cfloat * MUFFT_RESTRICT twiddles, RADIX_EXTRA_ARGS unsigned p, unsigned samples) \
+{ \
+    cfloat *output = output_; \
+    const cfloat *input = input_; \
+ \
+    unsigned quarter_samples = samples >> 2; \
+ \
+    for (unsigned i = 0; i < quarter_samples; i += VSIZE) \
+    { \
+        unsigned k = i & (p - 1); \
+ \
+        const cfloat *twiddles2 = RADIX_NEXT_LEVEL(twiddles, p); \
+        MM w = RADIX_TWIDDLE(twiddles, p, k); \
+        MM w0 = RADIX_TWIDDLE(twiddles2, 2 * p, k); \
+        MM w1 = RADIX_TWIDDLE(twiddles2, 2 * p, p + k); \
+ \
+        RADIX4_LOAD_GENERIC; \
+ \
+        c = cmul_ps(c, w); \
+        d = cmul_ps(d, w); \
+ \
+        MM r0 = add_ps(a, c); \
+        MM r1 = sub_ps(a, c); \
+        MM r2 = add_ps(b, d); \
+        MM r3 = sub_ps(b, d); \
+ \
+        r2 = cmul_ps(r2, w0); \
+        r3 = cmul_ps(r3, w1); \
+ \
+        MM o0 = add_ps(r0, r2); \
+        MM o1 = sub_ps(r0, r2); \
+        MM o2 = add_ps(r1, r3); \
+        MM o3 = sub_ps(r1, r3); \
+ \
+        unsigned j = ((i - k) << 2) + k; \
+        RADIX_STORE(&output[j + 0], o0); \
+        RADIX_STORE(&output[j + 1 * p], o2); \
+        RADIX_STORE(&output[j + 2 * p], o1); \
+        RADIX_STORE(&output[j + 3 * p], o3); \
+    } \
+    RADIX_STREAM_END; \
 }
 
+#undef RADIX4_LOAD_GENERIC
+#define RADIX4_LOAD_GENERIC \
+        MM a = load_ps(&input[i]); \
+        MM b = load_ps(&input[i + quarter_samples]); \
+        MM c = load_ps(&input[i + 2 * quarter_samples]); \
+        MM d = load_ps(&input[i + 3 * quarter_samples])
+RADIX4_GENERIC(radix4_generic)
+#undef RADIX_STREAM
+#define RADIX_STREAM 1
+RADIX4_GENERIC(radix4_generic_stream)
+#undef RADIX_STREAM
+#define RADIX_STREAM 0
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 1
+RADIX4_GENERIC(radix4_compact)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 0
+#undef RADIX4_LOAD_GENERIC
+#define RADIX4_LOAD_GENERIC \
+        unsigned line = i / p; \
+        unsigned line_stride = quarter_samples / p; \
+        MM a = splat_complex(&input[line]); \
+        MM b = splat_complex(&input[line + line_stride]); \
+        MM c = splat_complex(&input[line + 2 * line_stride]); \
+        MM d = splat_complex(&input[line + 3 * line_stride])
+RADIX4_GENERIC(radix4_broadcast)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 1
+RADIX4_GENERIC(radix4_broadcast_compact)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 0
+#undef RADIX4_LOAD_GENERIC
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS float scale,
+#define RADIX4_LOAD_GENERIC \
+        const MM s = splat_const_complex(scale, scale); \
+        MM a = mul_ps(load_ps(&input[i]), s); \
+        MM b = mul_ps(load_ps(&input[i + quarter_samples]), s); \
+        MM c = mul_ps(load_ps(&input[i + 2 * quarter_samples]), s); \
+        MM d = mul_ps(load_ps(&input[i + 3 * quarter_samples]), s)
+RADIX4_GENERIC(radix4_generic_scale)
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS
+
 #if VSIZE == 4
 #define RADIX8_P1_END \
         o0 = _mm256_permute2f128_ps(o0o1_lo, o2o3_lo, (2 << 4) | (0 << 0)); \
@@ -485,7 +693,7 @@ void MANGLE(mufft_radix4_generic)(void * MUFFT_RESTRICT output_, const void * MU
 
 #define RADIX8_P1(direction, twiddle_r, twiddle_i, twiddle8) \
 void MANGLE(mufft_ ## direction ## _radix8_p1)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples) \
+        const cfloat * MUFFT_RESTRICT twiddles, RADIX_EXTRA_ARGS unsigned p, unsigned samples) \
 { \
     cfloat *output = output_; \
     const cfloat *input = input_; \
@@ -585,90 +793,438 @@ RADIX8_P1(inverse, -0.0f, +0.0f, (float)(+M_SQRT1_2))
         MM r6 = d; \
         MM r7 = d
 RADIX8_P1(forward_half, 0.0f, -0.0f, (float)(-M_SQRT1_2))
+#undef RADIX8_LOAD_FIRST_BUTTERFLY
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS const cfloat * MUFFT_RESTRICT r2c_twiddles,
+#define RADIX8_LOAD_FIRST_BUTTERFLY \
+        MM a = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i, samples); \
+        MM b = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + octa_samples, samples); \
+        MM c = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 2 * octa_samples, samples); \
+        MM d = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 3 * octa_samples, samples); \
+        MM e = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 4 * octa_samples, samples); \
+        MM f = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 5 * octa_samples, samples); \
+        MM g = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 6 * octa_samples, samples); \
+        MM h = MANGLE(resolve_c2r_load)(input, r2c_twiddles, i + 7 * octa_samples, samples); \
+ \
+        MM r0 = add_ps(a, e); \
+        MM r1 = sub_ps(a, e); \
+        MM r2 = add_ps(b, f); \
+        MM r3 = sub_ps(b, f); \
+        MM r4 = add_ps(c, g); \
+        MM r5 = sub_ps(c, g); \
+        MM r6 = add_ps(d, h); \
+        MM r7 = sub_ps(d, h)
+RADIX8_P1(c2r, -0.0f, +0.0f, (float)(+M_SQRT1_2))
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS
+
+// Radix-8 butterfly on x[0..7], the same as one iteration of RADIX8_GENERIC.
+// The results replace x in output order.
+static inline void MANGLE(radix8_butterfly)(MM *x, const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned k)
+{
+    const MM w = load_ps(&twiddles[k]);
+    MM a = x[0];
+    MM b = x[1];
+    MM c = x[2];
+    MM d = x[3];
+    MM e = cmul_ps(x[4], w);
+    MM f = cmul_ps(x[5], w);
+    MM g = cmul_ps(x[6], w);
+    MM h = cmul_ps(x[7], w);
+
+    MM r0 = add_ps(a, e);
+    MM r1 = sub_ps(a, e);
+    MM r2 = add_ps(b, f);
+    MM r3 = sub_ps(b, f);
+    MM r4 = add_ps(c, g);
+    MM r5 = sub_ps(c, g);
+    MM r6 = add_ps(d, h);
+    MM r7 = sub_ps(d, h);
+
+    const MM w0 = load_ps(&twiddles[p + k]);
+    const MM w1 = load_ps(&twiddles[2 * p + k]);
+    r4 = cmul_ps(r4, w0);
+    r5 = cmul_ps(r5, w1);
+    r6 = cmul_ps(r6, w0);
+    r7 = cmul_ps(r7, w1);
+
+    a = add_ps(r0, r4);
+    b = add_ps(r1, r5);
+    c = sub_ps(r0, r4);
+    d = sub_ps(r1, r5);
+    e = add_ps(r2, r6);
+    f = add_ps(r3, r7);
+    g = sub_ps(r2, r6);
+    h = sub_ps(r3, r7);
+
+    e = cmul_ps(e, load_ps(&twiddles[3 * p + k]));
+    f = cmul_ps(f, load_ps(&twiddles[3 * p + k + p]));
+    g = cmul_ps(g, load_ps(&twiddles[3 * p + k + 2 * p]));
+    h = cmul_ps(h, load_ps(&twiddles[3 * p + k + 3 * p]));
+
+    x[0] = add_ps(a, e);
+    x[1] = add_ps(b, f);
+    x[2] = add_ps(c, g);
+    x[3] = add_ps(d, h);
+    x[4] = sub_ps(a, e);
+    x[5] = sub_ps(b, f);
+    x[6] = sub_ps(c, g);
+    x[7] = sub_ps(d, h);
+}
 
-void MANGLE(mufft_radix8_generic)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+// Two radix-8 steps in one pass, a step at p followed by a step at 8p, see mufft_radix64_fused_c.
+// Each of the 64 input and output streams is accessed a full cache line at a time,
+// which requires p to be at least 8 so that all lanes share the same block.
+#define RADIX64_LINE (8 / VSIZE)
+void MANGLE(mufft_radix64_fused)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
         const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
+    const cfloat *twiddles_8p = twiddles + 7 * p;
 
-    unsigned octa_samples = samples >> 3;
-    for (unsigned i = 0; i < octa_samples; i += VSIZE)
+    unsigned stride = samples >> 6;
+    for (unsigned i = 0; i < stride; i += 8)
     {
         unsigned k = i & (p - 1);
-        const MM w = load_ps(&twiddles[k]);
-        MM a = load_ps(&input[i]);
-        MM b = load_ps(&input[i + octa_samples]);
-        MM c = load_ps(&input[i + 2 * octa_samples]);
-        MM d = load_ps(&input[i + 3 * octa_samples]);
-        MM e = load_ps(&input[i + 4 * octa_samples]);
-        MM f = load_ps(&input[i + 5 * octa_samples]);
-        MM g = load_ps(&input[i + 6 * octa_samples]);
-        MM h = load_ps(&input[i + 7 * octa_samples]);
-
-        e = cmul_ps(e, w);
-        f = cmul_ps(f, w);
-        g = cmul_ps(g, w);
-        h = cmul_ps(h, w);
-
-        MM r0 = add_ps(a, e);
-        MM r1 = sub_ps(a, e);
-        MM r2 = add_ps(b, f);
-        MM r3 = sub_ps(b, f);
-        MM r4 = add_ps(c, g);
-        MM r5 = sub_ps(c, g);
-        MM r6 = add_ps(d, h);
-        MM r7 = sub_ps(d, h);
-
-        const MM w0 = load_ps(&twiddles[p + k]);
-        const MM w1 = load_ps(&twiddles[2 * p + k]);
-        r4 = cmul_ps(r4, w0);
-        r5 = cmul_ps(r5, w1);
-        r6 = cmul_ps(r6, w0);
-        r7 = cmul_ps(r7, w1);
-
-        a = add_ps(r0, r4);
-        b = add_ps(r1, r5);
-        c = sub_ps(r0, r4);
-        d = sub_ps(r1, r5);
-        e = add_ps(r2, r6);
-        f = add_ps(r3, r7);
-        g = sub_ps(r2, r6);
-        h = sub_ps(r3, r7);
-
-        const MM we = load_ps(&twiddles[3 * p + k]);
-        const MM wf = load_ps(&twiddles[3 * p + k + p]);
-        const MM wg = load_ps(&twiddles[3 * p + k + 2 * p]);
-        const MM wh = load_ps(&twiddles[3 * p + k + 3 * p]);
-        e = cmul_ps(e, we);
-        f = cmul_ps(f, wf);
-        g = cmul_ps(g, wg);
-        h = cmul_ps(h, wh);
-
-        MM o0 = add_ps(a, e);
-        MM o1 = add_ps(b, f);
-        MM o2 = add_ps(c, g);
-        MM o3 = add_ps(d, h);
-        MM o4 = sub_ps(a, e);
-        MM o5 = sub_ps(b, f);
-        MM o6 = sub_ps(c, g);
-        MM o7 = sub_ps(d, h);
-
-        unsigned j = ((i - k) << 3) + k;
-        store_ps(&output[j + 0 * p], o0);
-        store_ps(&output[j + 1 * p], o1);
-        store_ps(&output[j + 2 * p], o2);
-        store_ps(&output[j + 3 * p], o3);
-        store_ps(&output[j + 4 * p], o4);
-        store_ps(&output[j + 5 * p], o5);
-        store_ps(&output[j + 6 * p], o6);
-        store_ps(&output[j + 7 * p], o7);
+        MM x[8][8][RADIX64_LINE];
+
+        for (unsigned s = 0; s < 8; s++)
+        {
+            for (unsigned r = 0; r < 8; r++)
+            {
+                for (unsigned v = 0; v < RADIX64_LINE; v++)
+                {
+                    x[s][r][v] = load_ps(&input[i + v * VSIZE + (s + 8 * r) * stride]);
+                }
+            }
+
+            for (unsigned v = 0; v < RADIX64_LINE; v++)
+            {
+                MM y[8];
+                for (unsigned r = 0; r < 8; r++)
+                {
+                    y[r] = x[s][r][v];
+                }
+                MANGLE(radix8_butterfly)(y, twiddles, p, k + v * VSIZE);
+                for (unsigned r = 0; r < 8; r++)
+                {
+                    x[s][r][v] = y[r];
+                }
+            }
+        }
+
+        unsigned j = ((i - k) << 6) + k;
+        for (unsigned r = 0; r < 8; r++)
+        {
+            for (unsigned v = 0; v < RADIX64_LINE; v++)
+            {
+                MM y[8];
+                for (unsigned s = 0; s < 8; s++)
+                {
+                    y[s] = x[s][r][v];
+                }
+                MANGLE(radix8_butterfly)(y, twiddles_8p, 8 * p, k + r * p + v * VSIZE);
+
+                for (unsigned s = 0; s < 8; s++)
+                {
+                    store_ps(&output[j + v * VSIZE + r * p + s * 8 * p], y[s]);
+                }
+            }
+        }
+    }
+}
+#undef RADIX64_LINE
+
+// Radix-4 butterfly on x[0..3], the same as one iteration of RADIX4_GENERIC.
+// The results replace x in output order.
+static inline void MANGLE(radix4_butterfly)(MM *x, const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned k)
+{
+    const MM w = load_ps(&twiddles[k]);
+    MM a = x[0];
+    MM b = x[1];
+    MM c = cmul_ps(x[2], w);
+    MM d = cmul_ps(x[3], w);
+
+    MM r0 = add_ps(a, c);
+    MM r1 = sub_ps(a, c);
+    MM r2 = cmul_ps(add_ps(b, d), load_ps(&twiddles[p + k]));
+    MM r3 = cmul_ps(sub_ps(b, d), load_ps(&twiddles[2 * p + k]));
+
+    x[0] = add_ps(r0, r2);
+    x[1] = add_ps(r1, r3);
+    x[2] = sub_ps(r0, r2);
+    x[3] = sub_ps(r1, r3);
+}
+
+// Radix-2 butterfly on x[0..1], the same as one iteration of RADIX2_GENERIC.
+static inline void MANGLE(radix2_butterfly)(MM *x, const cfloat * MUFFT_RESTRICT twiddles, unsigned k)
+{
+    MM a = x[0];
+    MM b = cmul_ps(x[1], load_ps(&twiddles[k]));
+    x[0] = add_ps(a, b);
+    x[1] = sub_ps(a, b);
+}
+
+// Iterations [i, i + VSIZE) of the last FFT step, where p == samples / radix.
+// x[r] receives the samples which belong at i + r * p.
+static inline void MANGLE(last_step_butterfly)(MM *x, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned i, unsigned radix)
+{
+    for (unsigned r = 0; r < radix; r++)
+    {
+        x[r] = load_ps(&input[i + r * p]);
+    }
+
+    switch (radix)
+    {
+        case 8:
+            MANGLE(radix8_butterfly)(x, twiddles, p, i);
+            break;
+        case 4:
+            MANGLE(radix4_butterfly)(x, twiddles, p, i);
+            break;
+        default:
+            MANGLE(radix2_butterfly)(x, twiddles, i);
+            break;
+    }
+}
+
+// The last FFT step followed by the R2C resolve, see r2c_last_step_c.
+// Blocks of VSIZE iterations are taken from both ends, [i, i + VSIZE) and [p - i - VSIZE, p - i).
+// Resolving either block also needs the first sample of the neighbouring block on the other end,
+// so the next front block and the previous back block are kept around as well.
+// Requires p >= 2 * VSIZE.
+static inline void MANGLE(r2c_last_step)(cfloat * MUFFT_RESTRICT output, const cfloat * MUFFT_RESTRICT input,
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles,
+        unsigned samples, unsigned radix, int full)
+{
+    const MM half = splat_const_complex(0.5f, 0.5f);
+    unsigned p = samples / radix;
+    unsigned half_p = p >> 1;
+
+    MM x[8];
+    MM front[8][2];
+    MM back[8][2];
+
+    MANGLE(last_step_butterfly)(x, input, twiddles, p, 0, radix);
+    MM dc = x[0];
+    for (unsigned r = 0; r < radix; r++)
+    {
+        front[r][0] = x[r];
+        // The partner of iteration 0 is iteration p, i.e. iteration 0 of the next group of outputs.
+        back[r][1] = x[(r + 1) & (radix - 1)];
+    }
+
+    for (unsigned i = 0; i < half_p; i += VSIZE)
+    {
+        unsigned b = p - i - VSIZE;
+        MANGLE(last_step_butterfly)(x, input, twiddles, p, b, radix);
+        for (unsigned r = 0; r < radix; r++)
+        {
+            back[r][0] = x[r];
+        }
+
+        if (i + VSIZE < half_p)
+        {
+            MANGLE(last_step_butterfly)(x, input, twiddles, p, i + VSIZE, radix);
+        }
+        for (unsigned r = 0; r < radix; r++)
+        {
+            // Iteration p / 2 is the first iteration of the last back block.
+            front[r][1] = i + VSIZE < half_p ? x[r] : back[r][0];
+        }
+
+        for (unsigned r = 0; r < radix; r++)
+        {
+            unsigned m = i + r * p;
+            MM a = front[r][0];
+            MM c = MANGLE(conj_reverse)(MANGLE(shift_in)(back[radix - 1 - r][0], back[radix - 1 - r][1]));
+            MM fe = add_ps(a, c);
+            MM fo = cmul_ps(load_ps(&r2c_twiddles[m]), sub_ps(a, c));
+            store_ps(&output[m], mul_ps(half, add_ps(fe, fo)));
+            if (full)
+            {
+                store_ps(&output[m + samples], mul_ps(half, sub_ps(fe, fo)));
+            }
+
+            m = b + r * p;
+            a = back[r][0];
+            c = MANGLE(conj_reverse)(MANGLE(shift_in)(front[radix - 1 - r][0], front[radix - 1 - r][1]));
+            fe = add_ps(a, c);
+            fo = cmul_ps(load_ps(&r2c_twiddles[m]), sub_ps(a, c));
+            store_ps(&output[m], mul_ps(half, add_ps(fe, fo)));
+            if (full)
+            {
+                store_ps(&output[m + samples], mul_ps(half, sub_ps(fe, fo)));
+            }
+        }
+
+        for (unsigned r = 0; r < radix; r++)
+        {
+            front[r][0] = front[r][1];
+            back[r][1] = back[r][0];
+        }
     }
+
+    cfloat z[VSIZE];
+    storeu_ps(z, dc);
+    cfloat fe = cfloat_real(z[0]);
+    cfloat fo = cfloat_imag(z[0]);
+    output[0] = cfloat_add(fe, fo);
+    output[samples] = cfloat_sub(fe, fo);
+}
+
+#define R2C_LAST_STEP(name, radix, full) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output, const void * MUFFT_RESTRICT input, \
+        const cfloat * MUFFT_RESTRICT twiddles, const cfloat * MUFFT_RESTRICT r2c_twiddles, unsigned p, unsigned samples) \
+{ \
+    (void)p; \
+    MANGLE(r2c_last_step)(output, input, twiddles, r2c_twiddles, samples, radix, full); \
+}
+R2C_LAST_STEP(r2c_radix8_last, 8, 0)
+R2C_LAST_STEP(r2c_radix4_last, 4, 0)
+R2C_LAST_STEP(r2c_radix2_last, 2, 0)
+R2C_LAST_STEP(r2c_full_radix8_last, 8, 1)
+R2C_LAST_STEP(r2c_full_radix4_last, 4, 1)
+R2C_LAST_STEP(r2c_full_radix2_last, 2, 1)
+
+#define RADIX8_GENERIC(name) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
+        const cfloat * MUFFT_RESTRICT twiddles, RADIX_EXTRA_ARGS unsigned p, unsigned samples) \
+{ \
+    cfloat *output = output_; \
+    const cfloat *input = input_; \
+ \
+    unsigned octa_samples = samples >> 3; \
+    for (unsigned i = 0; i < octa_samples; i += VSIZE) \
+    { \
+        unsigned k = i & (p - 1); \
+        const cfloat *twiddles2 = RADIX_NEXT_LEVEL(twiddles, p); \
+        const cfloat *twiddles4 = RADIX_NEXT_LEVEL(twiddles2, 2 * p); \
+        const MM w = RADIX_TWIDDLE(twiddles, p, k); \
+        RADIX8_LOAD_GENERIC; \
+ \
+        e = cmul_ps(e, w); \
+        f = cmul_ps(f, w); \
+        g = cmul_ps(g, w); \
+        h = cmul_ps(h, w); \
+ \
+        MM r0 = add_ps(a, e); \
+        MM r1 = sub_ps(a, e); \
+        MM r2 = add_ps(b, f); \
+        MM r3 = sub_ps(b, f); \
+        MM r4 = add_ps(c, g); \
+        MM r5 = sub_ps(c, g); \
+        MM r6 = add_ps(d, h); \
+        MM r7 = sub_ps(d, h); \
+ \
+        const MM w0 = RADIX_TWIDDLE(twiddles2, 2 * p, k); \
+        const MM w1 = RADIX_TWIDDLE(twiddles2, 2 * p, p + k); \
+        r4 = cmul_ps(r4, w0); \
+        r5 = cmul_ps(r5, w1); \
+        r6 = cmul_ps(r6, w0); \
+        r7 = cmul_ps(r7, w1); \
+ \
+        a = add_ps(r0, r4); \
+        b = add_ps(r1, r5); \
+        c = sub_ps(r0, r4); \
+        d = sub_ps(r1, r5); \
+        e = add_ps(r2, r6); \
+        f = add_ps(r3, r7); \
+        g = sub_ps(r2, r6); \
+        h = sub_ps(r3, r7); \
+ \
+        const MM we = RADIX_TWIDDLE(twiddles4, 4 * p, k); \
+        const MM wf = RADIX_TWIDDLE(twiddles4, 4 * p, k + p); \
+        const MM wg = RADIX_TWIDDLE(twiddles4, 4 * p, k + 2 * p); \
+        const MM wh = RADIX_TWIDDLE(twiddles4, 4 * p, k + 3 * p); \
+        e = cmul_ps(e, we); \
+        f = cmul_ps(f, wf); \
+        g = cmul_ps(g, wg); \
+        h = cmul_ps(h, wh); \
+ \
+        MM o0 = add_ps(a, e); \
+        MM o1 = add_ps(b, f); \
+        MM o2 = add_ps(c, g); \
+        MM o3 = add_ps(d, h); \
+        MM o4 = sub_ps(a, e); \
+        MM o5 = sub_ps(b, f); \
+        MM o6 = sub_ps(c, g); \
+        MM o7 = sub_ps(d, h); \
+ \
+        unsigned j = ((i - k) << 3) + k; \
+        RADIX_STORE(&output[j + 0 * p], o0); \
+        RADIX_STORE(&output[j + 1 * p], o1); \
+        RADIX_STORE(&output[j + 2 * p], o2); \
+        RADIX_STORE(&output[j + 3 * p], o3); \
+        RADIX_STORE(&output[j + 4 * p], o4); \
+        RADIX_STORE(&output[j + 5 * p], o5); \
+        RADIX_STORE(&output[j + 6 * p], o6); \
+        RADIX_STORE(&output[j + 7 * p], o7); \
+    } \
+    RADIX_STREAM_END; \
 }
 
+#undef RADIX8_LOAD_GENERIC
+#define RADIX8_LOAD_GENERIC \
+        MM a = load_ps(&input[i]); \
+        MM b = load_ps(&input[i + octa_samples]); \
+        MM c = load_ps(&input[i + 2 * octa_samples]); \
+        MM d = load_ps(&input[i + 3 * octa_samples]); \
+        MM e = load_ps(&input[i + 4 * octa_samples]); \
+        MM f = load_ps(&input[i + 5 * octa_samples]); \
+        MM g = load_ps(&input[i + 6 * octa_samples]); \
+        MM h = load_ps(&input[i + 7 * octa_samples])
+RADIX8_GENERIC(radix8_generic)
+#undef RADIX_STREAM
+#define RADIX_STREAM 1
+RADIX8_GENERIC(radix8_generic_stream)
+#undef RADIX_STREAM
+#define RADIX_STREAM 0
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 1
+RADIX8_GENERIC(radix8_compact)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 0
+#undef RADIX8_LOAD_GENERIC
+#define RADIX8_LOAD_GENERIC \
+        unsigned line = i / p; \
+        unsigned line_stride = octa_samples / p; \
+        MM a = splat_complex(&input[line]); \
+        MM b = splat_complex(&input[line + line_stride]); \
+        MM c = splat_complex(&input[line + 2 * line_stride]); \
+        MM d = splat_complex(&input[line + 3 * line_stride]); \
+        MM e = splat_complex(&input[line + 4 * line_stride]); \
+        MM f = splat_complex(&input[line + 5 * line_stride]); \
+        MM g = splat_complex(&input[line + 6 * line_stride]); \
+        MM h = splat_complex(&input[line + 7 * line_stride])
+RADIX8_GENERIC(radix8_broadcast)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 1
+RADIX8_GENERIC(radix8_broadcast_compact)
+#undef RADIX_COMPACT
+#define RADIX_COMPACT 0
+#undef RADIX8_LOAD_GENERIC
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS float scale,
+#define RADIX8_LOAD_GENERIC \
+        const MM s = splat_const_complex(scale, scale); \
+        MM a = mul_ps(load_ps(&input[i]), s); \
+        MM b = mul_ps(load_ps(&input[i + octa_samples]), s); \
+        MM c = mul_ps(load_ps(&input[i + 2 * octa_samples]), s); \
+        MM d = mul_ps(load_ps(&input[i + 3 * octa_samples]), s); \
+        MM e = mul_ps(load_ps(&input[i + 4 * octa_samples]), s); \
+        MM f = mul_ps(load_ps(&input[i + 5 * octa_samples]), s); \
+        MM g = mul_ps(load_ps(&input[i + 6 * octa_samples]), s); \
+        MM h = mul_ps(load_ps(&input[i + 7 * octa_samples]), s)
+RADIX8_GENERIC(radix8_generic_scale)
+#undef RADIX_EXTRA_ARGS
+#define RADIX_EXTRA_ARGS
+
 
 void MANGLE(mufft_radix2_p1_vert)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
@@ -676,10 +1232,10 @@ void MANGLE(mufft_radix2_p1_vert)(void * MUFFT_RESTRICT output_, const void * MU
     (void)p;
 
     unsigned half_lines = samples_y >> 1;
-    unsigned half_stride = stride * half_lines;
+    unsigned half_stride = input_stride * half_lines;
 
     for (unsigned line = 0; line < half_lines;
-            line++, input += stride, output += stride << 1)
+            line++, input += input_stride, output += output_stride << 1)
     {
         for (unsigned i = 0; i < samples_x; i += VSIZE)
         {
@@ -690,46 +1246,79 @@ void MANGLE(mufft_radix2_p1_vert)(void * MUFFT_RESTRICT output_, const void * MU
             MM r1 = sub_ps(a, b);
 
             store_ps(&output[i], r0);
-            store_ps(&output[i + 1 * stride], r1);
+            store_ps(&output[i + 1 * output_stride], r1);
         }
     }
 }
 
-void MANGLE(mufft_radix2_generic_vert)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
+void MANGLE(mufft_radix2_half_p1_vert)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y)
 {
     cfloat *output = output_;
     const cfloat *input = input_;
+    (void)twiddles;
+    (void)p;
 
     unsigned half_lines = samples_y >> 1;
-    unsigned half_stride = stride * half_lines;
-    unsigned out_stride = p * stride;
 
     for (unsigned line = 0; line < half_lines;
-            line++, input += stride)
+            line++, input += input_stride, output += output_stride << 1)
     {
-        unsigned k = line & (p - 1);
-        unsigned j = ((line << 1) - k) * stride;
-        const MM w = splat_complex(&twiddles[k]);
-
         for (unsigned i = 0; i < samples_x; i += VSIZE)
         {
             MM a = load_ps(&input[i]);
-            MM b = load_ps(&input[i + half_stride]);
-            b = cmul_ps(b, w);
-
-            MM r0 = add_ps(a, b);
-            MM r1 = sub_ps(a, b);
-
-            store_ps(&output[i + j], r0);
-            store_ps(&output[i + j + 1 * out_stride], r1);
+            store_ps(&output[i], a);
+            store_ps(&output[i + 1 * output_stride], a);
         }
     }
 }
 
+// With RADIX_PREFETCH, the same columns of the next line of every stream are prefetched.
+#define RADIX2_GENERIC_VERT(name) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y) \
+{ \
+    cfloat *output = output_; \
+    const cfloat *input = input_; \
+ \
+    unsigned half_lines = samples_y >> 1; \
+    unsigned half_stride = input_stride * half_lines; \
+    unsigned out_stride = p * output_stride; \
+ \
+    for (unsigned line = 0; line < half_lines; \
+            line++, input += input_stride) \
+    { \
+        unsigned k = line & (p - 1); \
+        unsigned j = ((line << 1) - k) * output_stride; \
+        const MM w = splat_complex(&twiddles[k]); \
+ \
+        for (unsigned i = 0; i < samples_x; i += VSIZE) \
+        { \
+            for (unsigned m = 0; m < 2; m++) \
+                RADIX_PREFETCH_LINE(&input[i + input_stride + m * half_stride], i); \
+            MM a = load_ps(&input[i]); \
+            MM b = load_ps(&input[i + half_stride]); \
+            b = cmul_ps(b, w); \
+ \
+            MM r0 = add_ps(a, b); \
+            MM r1 = sub_ps(a, b); \
+ \
+            store_ps(&output[i + j], r0); \
+            store_ps(&output[i + j + 1 * out_stride], r1); \
+        } \
+    } \
+}
+
+RADIX2_GENERIC_VERT(radix2_generic_vert)
+#undef RADIX_PREFETCH
+#define RADIX_PREFETCH 1
+RADIX2_GENERIC_VERT(radix2_generic_vert_prefetch)
+#undef RADIX_PREFETCH
+#define RADIX_PREFETCH 0
+
 #define RADIX4_P1_VERT(direction, twiddle_r, twiddle_i) \
 void MANGLE(mufft_ ## direction ## _radix4_p1_vert)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y) \
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y) \
 { \
     cfloat *output = output_; \
     const cfloat *input = input_; \
@@ -737,89 +1326,114 @@ void MANGLE(mufft_ ## direction ## _radix4_p1_vert)(void * MUFFT_RESTRICT output
     (void)p; \
  \
     unsigned quarter_lines = samples_y >> 2; \
-    unsigned quarter_stride = stride * quarter_lines; \
+    unsigned quarter_stride = input_stride * quarter_lines; \
     const MM flip_signs = splat_const_complex(twiddle_r, twiddle_i); \
  \
     for (unsigned line = 0; line < quarter_lines; \
-            line++, input += stride, output += stride << 2) \
+            line++, input += input_stride, output += output_stride << 2) \
     { \
         for (unsigned i = 0; i < samples_x; i += VSIZE) \
         { \
+            RADIX4_LOAD_FIRST_BUTTERFLY_VERT; \
+            r3 = xor_ps(permute_ps(r3, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
+ \
+            a = add_ps(r0, r2); \
+            b = add_ps(r1, r3); \
+            c = sub_ps(r0, r2); \
+            d = sub_ps(r1, r3); \
+ \
+            store_ps(&output[i], a); \
+            store_ps(&output[i + 1 * output_stride], b); \
+            store_ps(&output[i + 2 * output_stride], c); \
+            store_ps(&output[i + 3 * output_stride], d); \
+        } \
+    } \
+}
+
+#undef RADIX4_LOAD_FIRST_BUTTERFLY_VERT
+#define RADIX4_LOAD_FIRST_BUTTERFLY_VERT \
             MM a = load_ps(&input[i]); \
             MM b = load_ps(&input[i + quarter_stride]); \
             MM c = load_ps(&input[i + 2 * quarter_stride]); \
             MM d = load_ps(&input[i + 3 * quarter_stride]); \
+ \
+            MM r0 = add_ps(a, c); \
+            MM r1 = sub_ps(a, c); \
+            MM r2 = add_ps(b, d); \
+            MM r3 = sub_ps(b, d)
+RADIX4_P1_VERT(forward, 0.0f, -0.0f)
+RADIX4_P1_VERT(inverse, -0.0f, 0.0f)
+#undef RADIX4_LOAD_FIRST_BUTTERFLY_VERT
+#define RADIX4_LOAD_FIRST_BUTTERFLY_VERT \
+            MM a = load_ps(&input[i]); \
+            MM b = load_ps(&input[i + quarter_stride]); \
+            MM c, d; \
+ \
+            MM r0 = a; \
+            MM r1 = a; \
+            MM r2 = b; \
+            MM r3 = b
+RADIX4_P1_VERT(forward_half, 0.0f, -0.0f)
+
+#define RADIX4_GENERIC_VERT(name) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y) \
+{ \
+    cfloat *output = output_; \
+    const cfloat *input = input_; \
+ \
+    unsigned quarter_lines = samples_y >> 2; \
+    unsigned quarter_stride = input_stride * quarter_lines; \
+    unsigned out_stride = p * output_stride; \
+ \
+    for (unsigned line = 0; line < quarter_lines; line++, input += input_stride) \
+    { \
+        unsigned k = line & (p - 1); \
+        unsigned j = (((line - k) << 2) + k) * output_stride; \
+ \
+        for (unsigned i = 0; i < samples_x; i += VSIZE) \
+        { \
+            for (unsigned m = 0; m < 4; m++) \
+                RADIX_PREFETCH_LINE(&input[i + input_stride + m * quarter_stride], i); \
+            const MM w = splat_complex(&twiddles[k]); \
+            MM a = load_ps(&input[i]); \
+            MM b = load_ps(&input[i + quarter_stride]); \
+            MM c = cmul_ps(load_ps(&input[i + 2 * quarter_stride]), w); \
+            MM d = cmul_ps(load_ps(&input[i + 3 * quarter_stride]), w); \
  \
             MM r0 = add_ps(a, c); \
             MM r1 = sub_ps(a, c); \
             MM r2 = add_ps(b, d); \
             MM r3 = sub_ps(b, d); \
-            r3 = xor_ps(permute_ps(r3, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
+ \
+            MM w0 = splat_complex(&twiddles[p + k]); \
+            MM w1 = splat_complex(&twiddles[p + k + p]); \
+            r2 = cmul_ps(r2, w0); \
+            r3 = cmul_ps(r3, w1); \
  \
             a = add_ps(r0, r2); \
             b = add_ps(r1, r3); \
             c = sub_ps(r0, r2); \
             d = sub_ps(r1, r3); \
  \
-            store_ps(&output[i], a); \
-            store_ps(&output[i + 1 * stride], b); \
-            store_ps(&output[i + 2 * stride], c); \
-            store_ps(&output[i + 3 * stride], d); \
+            store_ps(&output[i + j + 0 * out_stride], a); \
+            store_ps(&output[i + j + 1 * out_stride], b); \
+            store_ps(&output[i + j + 2 * out_stride], c); \
+            store_ps(&output[i + j + 3 * out_stride], d); \
         } \
     } \
 }
-RADIX4_P1_VERT(forward, 0.0f, -0.0f)
-RADIX4_P1_VERT(inverse, -0.0f, 0.0f)
 
-void MANGLE(mufft_radix4_generic_vert)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
-{
-    cfloat *output = output_;
-    const cfloat *input = input_;
-
-    unsigned quarter_lines = samples_y >> 2;
-    unsigned quarter_stride = stride * quarter_lines;
-    unsigned out_stride = p * stride;
-
-    for (unsigned line = 0; line < quarter_lines; line++, input += stride)
-    {
-        unsigned k = line & (p - 1);
-        unsigned j = (((line - k) << 2) + k) * stride;
-
-        for (unsigned i = 0; i < samples_x; i += VSIZE)
-        {
-            const MM w = splat_complex(&twiddles[k]);
-            MM a = load_ps(&input[i]);
-            MM b = load_ps(&input[i + quarter_stride]);
-            MM c = cmul_ps(load_ps(&input[i + 2 * quarter_stride]), w);
-            MM d = cmul_ps(load_ps(&input[i + 3 * quarter_stride]), w);
-
-            MM r0 = add_ps(a, c);
-            MM r1 = sub_ps(a, c);
-            MM r2 = add_ps(b, d);
-            MM r3 = sub_ps(b, d);
-
-            MM w0 = splat_complex(&twiddles[p + k]);
-            MM w1 = splat_complex(&twiddles[p + k + p]);
-            r2 = cmul_ps(r2, w0);
-            r3 = cmul_ps(r3, w1);
-
-            a = add_ps(r0, r2);
-            b = add_ps(r1, r3);
-            c = sub_ps(r0, r2);
-            d = sub_ps(r1, r3);
-
-            store_ps(&output[i + j + 0 * out_stride], a);
-            store_ps(&output[i + j + 1 * out_stride], b);
-            store_ps(&output[i + j + 2 * out_stride], c);
-            store_ps(&output[i + j + 3 * out_stride], d);
-        }
-    }
-}
+RADIX4_GENERIC_VERT(radix4_generic_vert)
+#undef RADIX_PREFETCH
+#define RADIX_PREFETCH 1
+RADIX4_GENERIC_VERT(radix4_generic_vert_prefetch)
+#undef RADIX_PREFETCH
+#define RADIX_PREFETCH 0
 
 #define RADIX8_P1_VERT(direction, twiddle_r, twiddle_i, twiddle8) \
 void MANGLE(mufft_ ## direction ## _radix8_p1_vert)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y) \
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y) \
 { \
     cfloat *output = output_; \
     const cfloat *input = input_; \
@@ -827,16 +1441,55 @@ void MANGLE(mufft_ ## direction ## _radix8_p1_vert)(void * MUFFT_RESTRICT output
     (void)twiddles; \
  \
     unsigned octa_lines = samples_y >> 3; \
-    unsigned octa_stride = stride * octa_lines; \
+    unsigned octa_stride = input_stride * octa_lines; \
     const MM flip_signs = splat_const_complex(twiddle_r, twiddle_i); \
     const MM w_f = splat_const_complex((float)(+M_SQRT1_2), twiddle8); \
     const MM w_h = splat_const_complex((float)(-M_SQRT1_2), twiddle8); \
  \
     for (unsigned line = 0; line < octa_lines; \
-            line++, input += stride, output += stride << 3) \
+            line++, input += input_stride, output += output_stride << 3) \
     { \
         for (unsigned i = 0; i < samples_x; i += VSIZE) \
         { \
+            RADIX8_LOAD_FIRST_BUTTERFLY_VERT; \
+            r5 = xor_ps(permute_ps(r5, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
+            r7 = xor_ps(permute_ps(r7, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
+ \
+            a = add_ps(r0, r4); \
+            b = add_ps(r1, r5); \
+            c = sub_ps(r0, r4); \
+            d = sub_ps(r1, r5); \
+            e = add_ps(r2, r6); \
+            f = add_ps(r3, r7); \
+            g = sub_ps(r2, r6); \
+            h = sub_ps(r3, r7); \
+            f = cmul_ps(f, w_f); \
+            g = xor_ps(permute_ps(g, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
+            h = cmul_ps(h, w_h); \
+ \
+            r0 = add_ps(a, e); \
+            r1 = add_ps(b, f); \
+            r2 = add_ps(c, g); \
+            r3 = add_ps(d, h); \
+            r4 = sub_ps(a, e); \
+            r5 = sub_ps(b, f); \
+            r6 = sub_ps(c, g); \
+            r7 = sub_ps(d, h); \
+ \
+            store_ps(&output[i], r0); \
+            store_ps(&output[i + 1 * output_stride], r1); \
+            store_ps(&output[i + 2 * output_stride], r2); \
+            store_ps(&output[i + 3 * output_stride], r3); \
+            store_ps(&output[i + 4 * output_stride], r4); \
+            store_ps(&output[i + 5 * output_stride], r5); \
+            store_ps(&output[i + 6 * output_stride], r6); \
+            store_ps(&output[i + 7 * output_stride], r7); \
+        } \
+    } \
+}
+
+#undef RADIX8_LOAD_FIRST_BUTTERFLY_VERT
+#define RADIX8_LOAD_FIRST_BUTTERFLY_VERT \
             MM a = load_ps(&input[i]); \
             MM b = load_ps(&input[i + octa_stride]); \
             MM c = load_ps(&input[i + 2 * octa_stride]); \
@@ -845,6 +1498,64 @@ void MANGLE(mufft_ ## direction ## _radix8_p1_vert)(void * MUFFT_RESTRICT output
             MM f = load_ps(&input[i + 5 * octa_stride]); \
             MM g = load_ps(&input[i + 6 * octa_stride]); \
             MM h = load_ps(&input[i + 7 * octa_stride]); \
+ \
+            MM r0 = add_ps(a, e); \
+            MM r1 = sub_ps(a, e); \
+            MM r2 = add_ps(b, f); \
+            MM r3 = sub_ps(b, f); \
+            MM r4 = add_ps(c, g); \
+            MM r5 = sub_ps(c, g); \
+            MM r6 = add_ps(d, h); \
+            MM r7 = sub_ps(d, h)
+RADIX8_P1_VERT(forward, 0.0f, -0.0f, (float)(-M_SQRT1_2))
+RADIX8_P1_VERT(inverse, -0.0f, 0.0f, (float)(+M_SQRT1_2))
+#undef RADIX8_LOAD_FIRST_BUTTERFLY_VERT
+#define RADIX8_LOAD_FIRST_BUTTERFLY_VERT \
+            MM a = load_ps(&input[i]); \
+            MM b = load_ps(&input[i + octa_stride]); \
+            MM c = load_ps(&input[i + 2 * octa_stride]); \
+            MM d = load_ps(&input[i + 3 * octa_stride]); \
+            MM e, f, g, h; \
+ \
+            MM r0 = a; \
+            MM r1 = a; \
+            MM r2 = b; \
+            MM r3 = b; \
+            MM r4 = c; \
+            MM r5 = c; \
+            MM r6 = d; \
+            MM r7 = d
+RADIX8_P1_VERT(forward_half, 0.0f, -0.0f, (float)(-M_SQRT1_2))
+
+#define RADIX8_GENERIC_VERT(name) \
+void MANGLE(mufft_ ## name)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_, \
+        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned input_stride, unsigned output_stride, unsigned samples_y) \
+{ \
+    cfloat *output = output_; \
+    const cfloat *input = input_; \
+ \
+    unsigned octa_lines = samples_y >> 3; \
+    unsigned octa_stride = input_stride * octa_lines; \
+    unsigned out_stride = p * output_stride; \
+ \
+    for (unsigned line = 0; line < octa_lines; line++, input += input_stride) \
+    { \
+        unsigned k = line & (p - 1); \
+        unsigned j = (((line - k) << 3) + k) * output_stride; \
+ \
+        for (unsigned i = 0; i < samples_x; i += VSIZE) \
+        { \
+            for (unsigned m = 0; m < 8; m++) \
+                RADIX_PREFETCH_LINE(&input[i + input_stride + m * octa_stride], i); \
+            const MM w = splat_complex(&twiddles[k]); \
+            MM a = load_ps(&input[i]); \
+            MM b = load_ps(&input[i + octa_stride]); \
+            MM c = load_ps(&input[i + 2 * octa_stride]); \
+            MM d = load_ps(&input[i + 3 * octa_stride]); \
+            MM e = cmul_ps(load_ps(&input[i + 4 * octa_stride]), w); \
+            MM f = cmul_ps(load_ps(&input[i + 5 * octa_stride]), w); \
+            MM g = cmul_ps(load_ps(&input[i + 6 * octa_stride]), w); \
+            MM h = cmul_ps(load_ps(&input[i + 7 * octa_stride]), w); \
  \
             MM r0 = add_ps(a, e); \
             MM r1 = sub_ps(a, e); \
@@ -854,8 +1565,13 @@ void MANGLE(mufft_ ## direction ## _radix8_p1_vert)(void * MUFFT_RESTRICT output
             MM r5 = sub_ps(c, g); \
             MM r6 = add_ps(d, h); \
             MM r7 = sub_ps(d, h); \
-            r5 = xor_ps(permute_ps(r5, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
-            r7 = xor_ps(permute_ps(r7, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
+ \
+            MM w0 = splat_complex(&twiddles[p + k]); \
+            MM w1 = splat_complex(&twiddles[p + k + p]); \
+            r4 = cmul_ps(r4, w0); \
+            r5 = cmul_ps(r5, w1); \
+            r6 = cmul_ps(r6, w0); \
+            r7 = cmul_ps(r7, w1); \
  \
             a = add_ps(r0, r4); \
             b = add_ps(r1, r5); \
@@ -865,9 +1581,11 @@ void MANGLE(mufft_ ## direction ## _radix8_p1_vert)(void * MUFFT_RESTRICT output
             f = add_ps(r3, r7); \
             g = sub_ps(r2, r6); \
             h = sub_ps(r3, r7); \
-            f = cmul_ps(f, w_f); \
-            g = xor_ps(permute_ps(g, _MM_SHUFFLE(2, 3, 0, 1)), flip_signs); \
-            h = cmul_ps(h, w_h); \
+ \
+            e = cmul_ps(e, splat_complex(&twiddles[3 * p + k])); \
+            f = cmul_ps(f, splat_complex(&twiddles[3 * p + k + p])); \
+            g = cmul_ps(g, splat_complex(&twiddles[3 * p + k + 2 * p])); \
+            h = cmul_ps(h, splat_complex(&twiddles[3 * p + k + 3 * p])); \
  \
             r0 = add_ps(a, e); \
             r1 = add_ps(b, f); \
@@ -878,95 +1596,22 @@ void MANGLE(mufft_ ## direction ## _radix8_p1_vert)(void * MUFFT_RESTRICT output
             r6 = sub_ps(c, g); \
             r7 = sub_ps(d, h); \
  \
-            store_ps(&output[i], r0); \
-            store_ps(&output[i + 1 * stride], r1); \
-            store_ps(&output[i + 2 * stride], r2); \
-            store_ps(&output[i + 3 * stride], r3); \
-            store_ps(&output[i + 4 * stride], r4); \
-            store_ps(&output[i + 5 * stride], r5); \
-            store_ps(&output[i + 6 * stride], r6); \
-            store_ps(&output[i + 7 * stride], r7); \
+            store_ps(&output[i + j + 0 * out_stride], r0); \
+            store_ps(&output[i + j + 1 * out_stride], r1); \
+            store_ps(&output[i + j + 2 * out_stride], r2); \
+            store_ps(&output[i + j + 3 * out_stride], r3); \
+            store_ps(&output[i + j + 4 * out_stride], r4); \
+            store_ps(&output[i + j + 5 * out_stride], r5); \
+            store_ps(&output[i + j + 6 * out_stride], r6); \
+            store_ps(&output[i + j + 7 * out_stride], r7); \
         } \
     } \
 }
-RADIX8_P1_VERT(forward, 0.0f, -0.0f, (float)(-M_SQRT1_2))
-RADIX8_P1_VERT(inverse, -0.0f, 0.0f, (float)(+M_SQRT1_2))
 
-void MANGLE(mufft_radix8_generic_vert)(void * MUFFT_RESTRICT output_, const void * MUFFT_RESTRICT input_,
-        const cfloat * MUFFT_RESTRICT twiddles, unsigned p, unsigned samples_x, unsigned stride, unsigned samples_y)
-{
-    cfloat *output = output_;
-    const cfloat *input = input_;
-
-    unsigned octa_lines = samples_y >> 3;
-    unsigned octa_stride = stride * octa_lines;
-    unsigned out_stride = p * stride;
-
-    for (unsigned line = 0; line < octa_lines; line++, input += stride)
-    {
-        unsigned k = line & (p - 1);
-        unsigned j = (((line - k) << 3) + k) * stride;
-
-        for (unsigned i = 0; i < samples_x; i += VSIZE)
-        {
-            const MM w = splat_complex(&twiddles[k]);
-            MM a = load_ps(&input[i]);
-            MM b = load_ps(&input[i + octa_stride]);
-            MM c = load_ps(&input[i + 2 * octa_stride]);
-            MM d = load_ps(&input[i + 3 * octa_stride]);
-            MM e = cmul_ps(load_ps(&input[i + 4 * octa_stride]), w);
-            MM f = cmul_ps(load_ps(&input[i + 5 * octa_stride]), w);
-            MM g = cmul_ps(load_ps(&input[i + 6 * octa_stride]), w);
-            MM h = cmul_ps(load_ps(&input[i + 7 * octa_stride]), w);
-
-            MM r0 = add_ps(a, e);
-            MM r1 = sub_ps(a, e);
-            MM r2 = add_ps(b, f);
-            MM r3 = sub_ps(b, f);
-            MM r4 = add_ps(c, g);
-            MM r5 = sub_ps(c, g);
-            MM r6 = add_ps(d, h);
-            MM r7 = sub_ps(d, h);
-
-            MM w0 = splat_complex(&twiddles[p + k]);
-            MM w1 = splat_complex(&twiddles[p + k + p]);
-            r4 = cmul_ps(r4, w0);
-            r5 = cmul_ps(r5, w1);
-            r6 = cmul_ps(r6, w0);
-            r7 = cmul_ps(r7, w1);
-
-            a = add_ps(r0, r4);
-            b = add_ps(r1, r5);
-            c = sub_ps(r0, r4);
-            d = sub_ps(r1, r5);
-            e = add_ps(r2, r6);
-            f = add_ps(r3, r7);
-            g = sub_ps(r2, r6);
-            h = sub_ps(r3, r7);
-
-            e = cmul_ps(e, splat_complex(&twiddles[3 * p + k]));
-            f = cmul_ps(f, splat_complex(&twiddles[3 * p + k + p]));
-            g = cmul_ps(g, splat_complex(&twiddles[3 * p + k + 2 * p]));
-            h = cmul_ps(h, splat_complex(&twiddles[3 * p + k + 3 * p]));
-
-            r0 = add_ps(a, e);
-            r1 = add_ps(b, f);
-            r2 = add_ps(c, g);
-            r3 = add_ps(d, h);
-            r4 = sub_ps(a, e);
-            r5 = sub_ps(b, f);
-            r6 = sub_ps(c, g);
-            r7 = sub_ps(d, h);
-
-            store_ps(&output[i + j + 0 * out_stride], r0);
-            store_ps(&output[i + j + 1 * out_stride], r1);
-            store_ps(&output[i + j + 2 * out_stride], r2);
-            store_ps(&output[i + j + 3 * out_stride], r3);
-            store_ps(&output[i + j + 4 * out_stride], r4);
-            store_ps(&output[i + j + 5 * out_stride], r5);
-            store_ps(&output[i + j + 6 * out_stride], r6);
-            store_ps(&output[i + j + 7 * out_stride], r7);
-        }
-    }
-}
+RADIX8_GENERIC_VERT(radix8_generic_vert)
+#undef RADIX_PREFETCH
+#define RADIX_PREFETCH 1
+RADIX8_GENERIC_VERT(radix8_generic_vert_prefetch)
+#undef RADIX_PREFETCH
+#define RADIX_PREFETCH 0
 #endif